@@ -0,0 +1,57 @@
+#ifndef STB_ALLOCATOR_HH_
+#define STB_ALLOCATOR_HH_
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace stb
+{
+    /*
+     * Hands out ranges of a linear space of capacity units, for example vertices of a shared
+     * buffer. Free ranges are kept both by offset, so that freed ranges are merged with their
+     * neighbours, and by size, so that allocation takes the smallest range that fits.
+     * The space itself is not owned, only offsets are managed.
+     */
+    class FreeListAllocator
+    {
+    public:
+        static const size_t INVALID_OFFSET = ~static_cast<size_t>(0);
+
+        explicit FreeListAllocator(const size_t capacity);
+
+        /*
+         * Returns offset of size units, or INVALID_OFFSET if no free range is large enough
+         */
+        size_t allocate(const size_t size);
+
+        /*
+         * Returns range given by allocate back, size must be the size it was allocated with
+         */
+        void free(const size_t offset, const size_t size);
+
+        /*
+         * Adds units to the end of space, merging them with free range at the end
+         */
+        void grow(const size_t capacity);
+
+        size_t capacity() const { return m_capacity; }
+        size_t freeUnits() const { return m_freeUnits; }
+        size_t largestFreeRange() const;
+        size_t numberOfFreeRanges() const { return m_byOffset.size(); }
+
+    private:
+        void insertFree(const size_t offset, const size_t size);
+        void eraseFree(const std::map<size_t, size_t>::iterator & range);
+
+        size_t m_capacity;
+        size_t m_freeUnits;
+        // Offset to size
+        std::map<size_t, size_t> m_byOffset;
+        // Size and offset
+        std::set<std::pair<size_t, size_t> > m_bySize;
+    };
+}
+
+#endif
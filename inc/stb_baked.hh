@@ -0,0 +1,252 @@
+#ifndef STB_BAKED_HH_
+#define STB_BAKED_HH_
+
+#include "stb_generator.hh"
+#include "stb_model.hh"
+#include "stb_types.hh"
+#include "stb_util.hh"
+
+#include <cstddef>
+
+/*
+ * Primitive meshes baked into static storage for fixed subdivision levels.
+ * Layout is the same as in generateCube and generateSphere: vertex (3 floats), normal (3 floats)
+ * and uv (2 floats) per element, U32 triangle indices.
+ */
+namespace stb
+{
+namespace baked
+{
+namespace detail
+{
+
+template <size_t... I>
+struct IndexSequence {};
+
+template <typename First, typename Second>
+struct ConcatIndexSequence;
+
+template <size_t... First, size_t... Second>
+struct ConcatIndexSequence<IndexSequence<First...>, IndexSequence<Second...> >
+{
+    typedef IndexSequence<First..., (sizeof...(First) + Second)...> type;
+};
+
+// Halves the sequence on each step, so that template depth stays logarithmic
+template <size_t N>
+struct MakeIndexSequence
+{
+    typedef typename ConcatIndexSequence<
+        typename MakeIndexSequence<N / 2>::type,
+        typename MakeIndexSequence<N - N / 2>::type>::type type;
+};
+
+template <>
+struct MakeIndexSequence<0>
+{
+    typedef IndexSequence<> type;
+};
+
+template <>
+struct MakeIndexSequence<1>
+{
+    typedef IndexSequence<0> type;
+};
+
+/*
+ * Face of the cube as a grid: columns go along columnAxis from column0 to column1,
+ * rows along rowAxis from row0 to row1, and the remaining axis is constant
+ */
+struct CubeFace
+{
+    float normal[3];
+    U columnAxis;
+    float column0, column1;
+    U rowAxis;
+    float row0, row1;
+    U constantAxis;
+    float constant;
+};
+
+constexpr U NUMBER_OF_CUBE_FACES = 6;
+constexpr CubeFace cubeFaces[NUMBER_OF_CUBE_FACES] = {
+    { { 0.0f, 0.0f, 1.0f }, 0, -0.5f, 0.5f, 1, 0.5f, -0.5f, 2, 0.5f }, // Front
+    { { 1.0f, 0.0f, 0.0f }, 2, 0.5f, -0.5f, 1, 0.5f, -0.5f, 0, 0.5f }, // Right
+    { { 0.0f, 0.0f, -1.0f }, 0, 0.5f, -0.5f, 1, 0.5f, -0.5f, 2, -0.5f }, // Back
+    { { -1.0f, 0.0f, 0.0f }, 2, -0.5f, 0.5f, 1, 0.5f, -0.5f, 0, -0.5f }, // Left
+    { { 0.0f, -1.0f, 0.0f }, 2, -0.5f, 0.5f, 0, -0.5f, 0.5f, 1, -0.5f }, // Bottom
+    { { 0.0f, 1.0f, 0.0f }, 2, 0.5f, -0.5f, 0, -0.5f, 0.5f, 1, 0.5f } // Top
+};
+
+constexpr size_t VALUES_PER_ELEMENT = 8;
+
+// Same arithmetic as the runtime generator, so baked values are bit identical
+constexpr float interpolate(const float start, const float end, const U subdivides, const size_t step)
+{
+    return start + (((end - start) / static_cast<float>(subdivides + 1)) * static_cast<float>(step));
+}
+
+constexpr size_t cubeVerticesPerRow(const U subdivides) { return subdivides + 2; }
+constexpr size_t cubeVerticesPerFace(const U subdivides) { return cubeVerticesPerRow(subdivides) * cubeVerticesPerRow(subdivides); }
+constexpr size_t cubeIndicesPerFace(const U subdivides) { return 6 * (subdivides + 1) * (subdivides + 1); }
+
+constexpr float cubeCoordinate(const CubeFace & face, const U subdivides, const size_t row, const size_t column, const U axis)
+{
+    return (axis == face.constantAxis) ? face.constant
+        : ((axis == face.columnAxis) ? interpolate(face.column0, face.column1, subdivides, column)
+        : interpolate(face.row0, face.row1, subdivides, row));
+}
+
+constexpr float cubeValue(const U faceIndex, const U subdivides, const size_t row, const size_t column, const U component)
+{
+    return (component < 3) ? cubeCoordinate(cubeFaces[faceIndex], subdivides, row, column, component)
+        : (component < 6) ? cubeFaces[faceIndex].normal[component - 3]
+        : (component == 6) ? interpolate(static_cast<float>(faceIndex) * (1.0f / 6.0f),
+            static_cast<float>(faceIndex + 1) * (1.0f / 6.0f), subdivides, column)
+        : interpolate(0.0f, 1.0f, subdivides, row);
+}
+
+/*
+ * Value at index i of the flat attribute array
+ */
+constexpr float cubeAttributeValue(const U subdivides, const size_t i)
+{
+    return cubeValue(
+        static_cast<U>(i / VALUES_PER_ELEMENT / cubeVerticesPerFace(subdivides)),
+        subdivides,
+        (i / VALUES_PER_ELEMENT % cubeVerticesPerFace(subdivides)) / cubeVerticesPerRow(subdivides),
+        (i / VALUES_PER_ELEMENT % cubeVerticesPerFace(subdivides)) % cubeVerticesPerRow(subdivides),
+        static_cast<U>(i % VALUES_PER_ELEMENT));
+}
+
+constexpr U32 cubeCornerOffset(const U subdivides, const size_t corner)
+{
+    return static_cast<U32>(((corner == 1) || (corner == 4)) ? cubeVerticesPerRow(subdivides)
+        : ((corner == 2) || (corner == 3)) ? 1
+        : (corner == 5) ? cubeVerticesPerRow(subdivides) + 1
+        : 0);
+}
+
+/*
+ * Index i of the flat index array, each square is tl, bl, tl + 1, tl + 1, bl, bl + 1
+ */
+constexpr U32 cubeIndex(const U subdivides, const size_t i)
+{
+    return static_cast<U32>(
+        (i / cubeIndicesPerFace(subdivides)) * cubeVerticesPerFace(subdivides)
+        + ((i % cubeIndicesPerFace(subdivides)) / 6 / (subdivides + 1)) * cubeVerticesPerRow(subdivides)
+        + ((i % cubeIndicesPerFace(subdivides)) / 6 % (subdivides + 1)))
+        + cubeCornerOffset(subdivides, i % 6);
+}
+
+template <U Subdivides, typename AttributeSequence, typename IndexSequence>
+struct CubeArrays;
+
+template <U Subdivides, size_t... A, size_t... I>
+struct CubeArrays<Subdivides, IndexSequence<A...>, IndexSequence<I...> >
+{
+    static constexpr size_t numberOfElements = sizeof...(A) / VALUES_PER_ELEMENT;
+    static constexpr size_t numberOfIndices = sizeof...(I);
+    static constexpr float attributes[sizeof...(A)] = { cubeAttributeValue(Subdivides, A)... };
+    static constexpr U32 indices[sizeof...(I)] = { cubeIndex(Subdivides, I)... };
+};
+
+template <U Subdivides, size_t... A, size_t... I>
+constexpr size_t CubeArrays<Subdivides, IndexSequence<A...>, IndexSequence<I...> >::numberOfElements;
+
+template <U Subdivides, size_t... A, size_t... I>
+constexpr size_t CubeArrays<Subdivides, IndexSequence<A...>, IndexSequence<I...> >::numberOfIndices;
+
+template <U Subdivides, size_t... A, size_t... I>
+constexpr float CubeArrays<Subdivides, IndexSequence<A...>, IndexSequence<I...> >::attributes[sizeof...(A)];
+
+template <U Subdivides, size_t... A, size_t... I>
+constexpr U32 CubeArrays<Subdivides, IndexSequence<A...>, IndexSequence<I...> >::indices[sizeof...(I)];
+
+constexpr size_t sphereElements(const U subdivides) { return 4 * ((size_t)1 << (2 * subdivides)) + 2; }
+constexpr size_t sphereIndices(const U subdivides) { return 8 * 3 * ((size_t)1 << (2 * subdivides)); }
+
+/*
+ * Views arrays with static storage duration as a model, nothing is copied or freed
+ */
+inline ModelData staticModel(const ModelData::AttributeData & attribute, const U32 * indices, const size_t numberOfIndices)
+{
+    return ModelData(
+        { ModelData::AttributeElement(&attribute, emptyDeleter<ModelData::AttributeData>) },
+        ModelData::DataOwner(),
+        (const char *)indices,
+        sizeof(U32) * numberOfIndices,
+        sizeof(U32),
+        ModelData::TRIANGLE);
+}
+
+}
+
+/*
+ * Cube of generateCube(Subdivides) computed by the compiler,
+ * attributes and indices are constant expressions
+ */
+template <U Subdivides>
+using Cube = detail::CubeArrays<Subdivides,
+    typename detail::MakeIndexSequence<detail::NUMBER_OF_CUBE_FACES * detail::cubeVerticesPerFace(Subdivides) * detail::VALUES_PER_ELEMENT>::type,
+    typename detail::MakeIndexSequence<detail::NUMBER_OF_CUBE_FACES * detail::cubeIndicesPerFace(Subdivides)>::type>;
+
+/*
+ * Sphere of generateSphere(Subdivides) with the default radius. Normalizing needs sqrt,
+ * which is not a constant expression, so arrays are static but filled on first use.
+ */
+template <U Subdivides>
+struct Sphere
+{
+    static constexpr size_t numberOfElements = detail::sphereElements(Subdivides);
+    static constexpr size_t numberOfIndices = detail::sphereIndices(Subdivides);
+
+    static const float * attributes() { return storage().attributes; }
+    static const U32 * indices() { return storage().indices; }
+
+private:
+    struct Storage
+    {
+        Storage() { generateSphereInto(Subdivides, .5f, attributes, indices); }
+
+        float attributes[numberOfElements * detail::VALUES_PER_ELEMENT];
+        U32 indices[numberOfIndices];
+    };
+
+    static const Storage & storage()
+    {
+        static const Storage baked;
+        return baked;
+    }
+};
+
+template <U Subdivides>
+constexpr size_t Sphere<Subdivides>::numberOfElements;
+
+template <U Subdivides>
+constexpr size_t Sphere<Subdivides>::numberOfIndices;
+
+template <U Subdivides>
+ModelData cubeModel()
+{
+    typedef Cube<Subdivides> Baked;
+    static const ModelData::AttributeData attribute(ModelData::DataOwner(),
+        (const char *)Baked::attributes, sizeof(Baked::attributes),
+        { 3, 3, 2 }, sizeof(float) * detail::VALUES_PER_ELEMENT, ModelData::FLOAT);
+    return detail::staticModel(attribute, Baked::indices, Baked::numberOfIndices);
+}
+
+template <U Subdivides>
+ModelData sphereModel()
+{
+    typedef Sphere<Subdivides> Baked;
+    static const ModelData::AttributeData attribute(ModelData::DataOwner(),
+        (const char *)Baked::attributes(), sizeof(float) * detail::VALUES_PER_ELEMENT * Baked::numberOfElements,
+        { 3, 3, 2 }, sizeof(float) * detail::VALUES_PER_ELEMENT, ModelData::FLOAT);
+    return detail::staticModel(attribute, Baked::indices(), Baked::numberOfIndices);
+}
+
+}
+}
+
+#endif
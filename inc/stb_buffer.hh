@@ -48,6 +48,32 @@ private:
     const char * m_data;
     size_t m_size;
 };
+
+/*
+ * Read-only view of a whole file. On Linux the file is memory mapped,
+ * on other platforms it is read into memory owned by the object.
+ * data() is valid for the lifetime of the object.
+ */
+class MappedFile : public Buffer
+{
+public:
+    MappedFile(const char * pathToFile);
+    ~MappedFile();
+
+    bool ready() const { return m_ok; }
+    size_t size() const { return m_size; }
+    void read(char * output) const;
+    const char * data() const { return m_data; }
+
+private:
+    const char * m_data;
+    size_t m_size;
+    bool m_ok;
+    std::string m_storage;
+
+    MappedFile(const MappedFile & /*other*/);
+    MappedFile & operator = (const MappedFile & /*other*/);
+};
 }
 
 }
@@ -0,0 +1,191 @@
+#ifndef STB_CULLING_HH_
+#define STB_CULLING_HH_
+
+#include "stb_types.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace stb
+{
+    class ModelData;
+
+    /*
+     * Axis aligned box, empty when min is greater than max
+     */
+    struct Aabb
+    {
+        Aabb();
+        Aabb(const float minX, const float minY, const float minZ,
+             const float maxX, const float maxY, const float maxZ);
+
+        bool empty() const;
+        void extend(const float x, const float y, const float z);
+
+        float min[3];
+        float max[3];
+    };
+
+    /*
+     * Bounds of positions of model, taken from the first attribute of the first buffer.
+     * Returns empty box and sets error if positions are not at least three floats.
+     */
+    Aabb modelBounds(const ModelData & model);
+
+    /*
+     * Box containing bounds transformed by column major 4x4 matrix, as given by glm::value_ptr.
+     * Matrix must be affine.
+     */
+    Aabb transformBounds(const Aabb & bounds, const float * matrix);
+
+    /*
+     * Planes (a, b, c, d) of view frustum with unit normals pointing inside, a point is inside
+     * plane when a * x + b * y + c * z + d >= 0. Order is left, right, bottom, top, near, far.
+     */
+    struct Frustum
+    {
+        float planes[6][4];
+    };
+
+    /*
+     * Frustum of column major view projection matrix, as given by glm::value_ptr, for OpenGL clip
+     * space. With world matrix given as view projection * model, planes are in model space.
+     */
+    Frustum frustumFromMatrix(const float * viewProjection);
+
+    /*
+     * True if bounds are not completely outside of one of the planes. Boxes near corners of frustum
+     * may be visible even though they are outside, never the other way round.
+     */
+    bool visible(const Frustum & frustum, const Aabb & bounds);
+
+    /*
+     * World space bounds of instances of meshes, in a bounding volume hierarchy of four children
+     * per node whose boxes are tested against frustum four at a time with stb::simd.
+     *
+     * Hierarchy is built by splitting instances at the median of centers of their bounds along the
+     * widest axis. Instances that move are refitted in place on update, which only visits nodes above them.
+     * Instances added after the hierarchy is built are tested one by one until enough of them are
+     * added, or enough are removed or refitted boxes have grown enough, for update to rebuild it.
+     * Rebuilding costs about as much as sorting the instances, so registering a whole scene at
+     * once and moving instances afterwards is the fast path.
+     *
+     * Instances are indices, those of removed instances are given to instances added later.
+     */
+    class InstanceRegistry
+    {
+    public:
+        typedef U32 Instance;
+
+        InstanceRegistry();
+
+        /*
+         * localBounds are those of the mesh drawn by instance, for example from modelBounds.
+         * transform is column major world matrix of instance.
+         */
+        Instance add(const Aabb & localBounds, const float * transform);
+        void move(const Instance instance, const float * transform);
+        void remove(const Instance instance);
+
+        bool contains(const Instance instance) const;
+        size_t numberOfInstances() const { return m_numberOfInstances; }
+        const Aabb & worldBounds(const Instance instance) const { return m_instances[instance].world; }
+
+        /*
+         * Refits or rebuilds hierarchy after changes, called by cull when needed
+         */
+        void update();
+
+        /*
+         * Replaces visible with instances whose bounds are visible in frustum, in no particular order
+         */
+        void cull(const Frustum & frustum, std::vector<Instance> & visible);
+
+        size_t numberOfRebuilds() const { return m_numberOfRebuilds; }
+
+    private:
+        // Four boxes as centers and half extents, an empty lane has negative extents
+        struct Boxes
+        {
+            float center[3][4];
+            float extent[3][4];
+        };
+
+        struct Packet
+        {
+            Boxes boxes;
+            // ~0 in empty lanes
+            Instance instances[4];
+            U32 leaf;
+        };
+
+        struct Node
+        {
+            Boxes boxes;
+            // Index of child node, of leaf when LEAF_BIT is set, or EMPTY
+            U32 children[4];
+            U32 parent;
+            U32 lane;
+        };
+
+        struct Leaf
+        {
+            U32 firstPacket;
+            U32 numberOfPackets;
+            U32 node;
+            U32 lane;
+            bool dirty;
+        };
+
+        struct Record
+        {
+            Aabb local;
+            Aabb world;
+            // Packet * 4 + lane in hierarchy, or index in m_loose with LOOSE_BIT set
+            U32 place;
+            bool alive;
+        };
+
+        // Center of bounds of instance, kept next to it while building
+        struct BuildItem
+        {
+            float center[3];
+            Instance instance;
+        };
+
+        void rebuild();
+        void refit();
+        U32 buildNode(std::vector<BuildItem> & items, const size_t begin, const size_t end,
+                      const U32 parent, const U32 lane);
+        U32 buildLeaf(const std::vector<BuildItem> & items, const size_t begin, const size_t end,
+                      const U32 parent, const U32 lane);
+        void setPacketLane(const U32 place, const Instance instance);
+        void markDirty(const U32 place);
+        void cullNode(const Frustum & frustum, const U32 node, const U32 planes,
+                      std::vector<Instance> & visible) const;
+        void cullLeaf(const Frustum & frustum, const U32 leaf, const U32 planes,
+                      std::vector<Instance> & visible) const;
+        void addSubtree(const U32 child, std::vector<Instance> & visible) const;
+
+        std::vector<Record> m_instances;
+        std::vector<Instance> m_free;
+        std::vector<Instance> m_loose;
+        std::vector<Packet> m_packets;
+        std::vector<Leaf> m_leaves;
+        std::vector<Node> m_nodes;
+        std::vector<U32> m_dirtyLeaves;
+        std::vector<U8> m_dirtyNodes;
+        size_t m_numberOfInstances;
+        size_t m_instancesInTree;
+        size_t m_removedFromTree;
+        // Sum of surface areas of leaves when built and now, tells how much refitting has grown them
+        double m_builtLeafArea;
+        double m_leafArea;
+        size_t m_numberOfRebuilds;
+
+        InstanceRegistry(const InstanceRegistry & /*other*/);
+        InstanceRegistry & operator = (const InstanceRegistry & /*other*/);
+    };
+}
+
+#endif
@@ -3,12 +3,45 @@
 
 #include "stb_types.hh"
 
+#include <cstddef>
+
 namespace stb
 {
 class ModelData;
 
-stb::ModelData generateCube(const U subdivides);
-stb::ModelData generateSphere(const U subdivides, const float radius = .5f);
+/*
+ * Shapes are generated by numberOfThreads workers, 0 means all hardware threads.
+ * Each worker writes its own part of the output, so the result does not depend on number of threads.
+ */
+stb::ModelData generateCube(const U subdivides, const U numberOfThreads = 1);
+stb::ModelData generateSphere(const U subdivides, const float radius = .5f, const U numberOfThreads = 1);
+
+/*
+ * Size of a generated shape. Each element is vertex (3 floats), normal (3 floats) and uv (2 floats),
+ * indices are U32 triangles.
+ */
+struct GeneratedSize
+{
+    size_t numberOfElements;
+    size_t numberOfIndices;
+
+    size_t sizeOfElement() const { return sizeof(float) * 8; }
+    size_t attributeBytes() const { return numberOfElements * sizeOfElement(); }
+    size_t indiceBytes() const { return numberOfIndices * sizeof(U32); }
+};
+
+GeneratedSize queryCubeSize(const U subdivides);
+GeneratedSize querySphereSize(const U subdivides);
+
+/*
+ * Write shape straight into caller memory, such as a mapped buffer or an arena, sized by the query above.
+ * Output is written only, never read back. baseVertex is added to every index,
+ * so several shapes can share one buffer.
+ */
+void generateCubeInto(const U subdivides, float * attributeOut, U32 * indexOut, const U32 baseVertex = 0,
+    const U numberOfThreads = 1);
+void generateSphereInto(const U subdivides, const float radius, float * attributeOut, U32 * indexOut,
+    const U32 baseVertex = 0, const U numberOfThreads = 1);
 
 }
 
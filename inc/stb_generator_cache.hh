@@ -0,0 +1,77 @@
+#ifndef STB_GENERATOR_CACHE_HH_
+#define STB_GENERATOR_CACHE_HH_
+
+#include "stb_model.hh"
+#include "stb_types.hh"
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace stb
+{
+    enum class GeneratedShape
+    {
+        Cube,
+        Sphere
+    };
+
+    /*
+     * Keeps generated models, least recently used ones are dropped when their total size
+     * exceeds the budget. Returned models share data with the cache, so getting a cached model
+     * does not copy anything. If directory is given, generated models are also written there
+     * in .sm format and read from there before generating, so they survive between runs.
+     * Models are generated with numberOfThreads workers. Not thread safe.
+     */
+    class GeneratorCache
+    {
+    public:
+        GeneratorCache(const size_t budgetInBytes, const std::string & directory = std::string(),
+            const U numberOfThreads = 1);
+
+        /*
+         * Returns model from cache, from directory or generates it, in this order.
+         * Radius is ignored for cube. If a file in directory can not be read or written,
+         * error is set but the generated model is returned anyway.
+         */
+        ModelData get(const GeneratedShape shape, const U subdivides, const float radius = .5f);
+
+        size_t sizeInBytes() const { return m_sizeInBytes; }
+        size_t numberOfModels() const { return m_models.size(); }
+        void clear();
+
+    private:
+        struct Key
+        {
+            GeneratedShape shape;
+            U subdivides;
+            U32 radiusBits;
+
+            bool operator < (const Key & other) const;
+        };
+
+        struct Entry
+        {
+            Key key;
+            ModelData model;
+            size_t size;
+        };
+        typedef std::list<Entry> Entries;
+
+        std::string pathOf(const Key & key) const;
+        ModelData load(const Key & key, const float radius) const;
+
+        const size_t m_budgetInBytes;
+        const std::string m_directory;
+        const U m_numberOfThreads;
+        // Most recently used first
+        Entries m_models;
+        std::map<Key, Entries::iterator> m_index;
+        size_t m_sizeInBytes;
+
+        GeneratorCache(const GeneratorCache & /*other*/);
+        GeneratorCache & operator = (const GeneratorCache & /*other*/);
+    };
+}
+
+#endif
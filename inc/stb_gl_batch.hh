@@ -0,0 +1,65 @@
+#ifndef STB_GL_BATCH_HH_
+#define STB_GL_BATCH_HH_
+
+#include "stb_types.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace stb
+{
+    struct PooledMesh;
+
+    /*
+     * Collects draws of meshes sharing the bound vao and submits them with one call:
+     * glMultiDrawElementsIndirect from a buffer of commands if ARB_multi_draw_indirect is supported
+     * and allowed, glMultiDrawElementsBaseVertex otherwise. Draws are kept between submits, so a batch
+     * of static meshes is built once and submitted every frame.
+     */
+    class DrawBatch
+    {
+    public:
+        explicit DrawBatch(const bool allowIndirect = true);
+        ~DrawBatch();
+
+        void add(const size_t numberOfIndices, const size_t firstIndex, const GL_I baseVertex);
+        void add(const PooledMesh & mesh);
+        void clear();
+
+        /*
+         * Draws every added range from the bound vao, indiceElementSizeGlEnum being
+         * GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+         */
+        void submit(const GL_I typeOfData, const GL_I indiceElementSizeGlEnum);
+
+        size_t numberOfDraws() const { return m_counts.size(); }
+        bool indirect() const { return m_indirect; }
+
+    private:
+        struct IndirectCommand
+        {
+            GL_U count;
+            GL_U instanceCount;
+            GL_U firstIndex;
+            GL_I baseVertex;
+            GL_U baseInstance;
+        };
+
+        bool m_indirect;
+        // Set when draws change, commands are uploaded and offsets calculated again on submit
+        bool m_changed;
+        std::vector<GL_I> m_counts;
+        std::vector<size_t> m_firstIndices;
+        std::vector<GL_I> m_baseVertices;
+        // Byte offsets of first indices, for indices of type m_offsetsIndiceType
+        std::vector<const void *> m_offsets;
+        GL_I m_offsetsIndiceType;
+        std::vector<IndirectCommand> m_commands;
+        GL_U m_indirectBuffer;
+
+        DrawBatch(const DrawBatch & /*other*/);
+        DrawBatch & operator = (const DrawBatch & /*other*/);
+    };
+}
+
+#endif
@@ -1,14 +1,29 @@
 #ifndef STB_GL_OBJECT_HH_
 #define STB_GL_OBJECT_HH_
 
+#include "stb_model.hh"
 #include "stb_types.hh"
+#include <cstddef>
 #include <vector>
 
 namespace stb
 {
-    class ModelData;
     typedef std::vector<I> ShaderAttributeLayoutInfo;
     #define STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT 5
+    #define STB_GL_OBJECT_MAX_STREAM_FRAMES_IN_FLIGHT 4
+
+    namespace BufferUsage {
+        enum Type
+        {
+            // Uploaded once
+            Static,
+            // Updated now and then, for example by edits
+            Dynamic,
+            // Rewritten every frame
+            Stream
+        };
+    }
+    typedef std::vector<BufferUsage::Type> BufferUsages;
 
     struct VertexArrayObject
     {
@@ -20,19 +35,216 @@ namespace stb
         GL_I numberOfIndicesElements;
         GL_I indiceElementSizeGlEnum;
         GL_U vbo[STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT];
+        GL_I vboUsage[STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT];
+        size_t vboSize[STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT];
+        GL_I indiceBufferUsage;
+        size_t indiceBufferSize;
+        GL_I instanceBufferIndex;
+        GL_U instanceDivisor;
+        GL_I numberOfInstances;
 
         friend class VaoAccess;
     };
 
+    /*
+     * Byte ranges of model changed since it was uploaded, collected over a frame
+     * and uploaded together by updateVao
+     */
+    struct VaoChanges
+    {
+        struct Range
+        {
+            size_t offset;
+            size_t size;
+        };
+        typedef std::vector<Range> Ranges;
+
+        void attributesChanged(const size_t attributeBufferIndex, const size_t offset, const size_t size);
+        void indicesChanged(const size_t offset, const size_t size);
+        bool empty() const;
+        void clear();
+
+        Ranges m_attributes[STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT];
+        Ranges m_indices;
+    };
+
+    /*
+     * All buffers are static
+     */
     void initVao(VertexArrayObject & vao,
                  const stb::ModelData & model,
                  const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo
                  );
+
+    /*
+     * Usage of attribute buffer i is attributeUsages[i], static if there are less usages than buffers
+     */
+    void initVao(VertexArrayObject & vao,
+                 const stb::ModelData & model,
+                 const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                 const BufferUsages & attributeUsages,
+                 const BufferUsage::Type indiceUsage
+                 );
+
+    /*
+     * Vao drawing model from buffers that already hold its data, for example buffers uploaded
+     * in a shared context by AsyncUploader. Vao takes ownership of the buffers, usages are the ones
+     * the buffers were created with.
+     */
+    void initVaoFromBuffers(VertexArrayObject & vao,
+                            const stb::ModelData & model,
+                            const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                            const std::vector<GL_U> & attributeBuffers,
+                            const GL_U indiceBuffer,
+                            const BufferUsages & attributeUsages = BufferUsages(),
+                            const BufferUsage::Type indiceUsage = BufferUsage::Static
+                            );
+
+    /*
+     * Uploads changed ranges of model, which has the same layout as the model vao was initialized from.
+     * Ranges of a buffer are sorted and merged when they overlap or are close, a single merged range is
+     * uploaded with glBufferSubData and several with one mapping of the span covering them.
+     * Buffers that changed size are re-specified whole with their usage. Clears changes.
+     * Returns number of bytes uploaded.
+     */
+    size_t updateVao(VertexArrayObject & vao,
+                     const stb::ModelData & model,
+                     VaoChanges & changes
+                     );
+
+    /*
+     * Updates vao initialized from resident model to contain updated model.
+     * Only blocks that differ are uploaded, buffers that changed size are re-specified.
+     * Returns false, leaving vao untouched, if attribute layouts of the models differ;
+     * vao needs to be released and initialized again then.
+     */
+    bool reloadVao(VertexArrayObject & vao,
+                   const stb::ModelData & resident,
+                   const stb::ModelData & updated
+                   );
     void bindAndDraw(VertexArrayObject & vao);
     void bindAndDraw(VertexArrayObject & vao, const GL_I customDataType);
+    /*
+     * Draws numberOfIndices indices starting from firstIndex,
+     * for example one level of detail of a terrain chunk
+     */
+    void bindAndDrawRange(VertexArrayObject & vao, const size_t firstIndex, const size_t numberOfIndices);
     void draw(VertexArrayObject & vao);
     void draw(VertexArrayObject & vao, const GL_I customDataType);
+
+    /*
+     * Adds per instance attributes to vao initialized with initVao, in a buffer of its own.
+     * Attributes are described as for models, wider ones such as matrices as several attributes
+     * of at most four values. Each element is used by divisor instances.
+     * Returns false and sets error if instanced arrays are not supported, vao has no free buffer
+     * or size of element is zero.
+     */
+    bool initInstances(VertexArrayObject & vao,
+                       const ModelData::AttributeData & instances,
+                       const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                       const GL_U divisor = 1
+                       );
+
+    /*
+     * Replaces instance data, number of instances follows size of data, layout must not change.
+     * Returns false and sets error if vao has no instances or size of element is zero.
+     */
+    bool updateInstances(VertexArrayObject & vao, const ModelData::AttributeData & instances);
+
+    /*
+     * Draws all instances with a single call
+     */
+    void bindAndDrawInstanced(VertexArrayObject & vao);
+    void drawInstanced(VertexArrayObject & vao, const size_t numberOfInstances);
     void releaseVao(VertexArrayObject & vao);
+
+    /*
+     * What bindAndDraw or bindAndDrawInstanced of vao would draw, for submitting the draw later
+     */
+    struct VaoDrawInfo
+    {
+        GL_U vao;
+        GL_I typeOfData;
+        GL_I numberOfIndices;
+        GL_I indiceElementSizeGlEnum;
+        // Zero when vao has no instances
+        GL_I numberOfInstances;
+    };
+    VaoDrawInfo drawInfo(VertexArrayObject & vao);
+
+    /*
+     * Ring of vertex and index memory for geometry that is rebuilt every frame, such as particles,
+     * debug lines and text. Memory is split in one segment per frame in flight. Each frame writes into
+     * its own segment through unsynchronized mapping, and a fence keeps the segment from being written
+     * again until the GPU has drawn from it. If the GPU is still using the segment when its turn comes,
+     * both buffers are orphaned instead of waiting.
+     */
+    struct StreamBuffer
+    {
+        StreamBuffer();
+    private:
+        GL_U vao;
+        GL_U vertexBuffer;
+        GL_U indiceBuffer;
+        GL_I indiceElementSizeGlEnum;
+        size_t sizeOfVertex;
+        size_t sizeOfIndice;
+        size_t vertexBytesPerFrame;
+        size_t indiceBytesPerFrame;
+        size_t framesInFlight;
+        size_t frame;
+        size_t vertexOffset;
+        size_t indiceOffset;
+        size_t numberOfOrphans;
+        void * fences[STB_GL_OBJECT_MAX_STREAM_FRAMES_IN_FLIGHT];
+
+        friend class StreamBufferAccess;
+    };
+
+    /*
+     * Vertices and indices written into stream buffer, drawable until the next beginStreamFrame
+     */
+    struct StreamRange
+    {
+        size_t firstIndex;
+        size_t numberOfIndices;
+        GL_I baseVertex;
+    };
+
+    /*
+     * Vertices are interleaved floats, valuesPerAttribute giving the number of floats in each attribute.
+     * Indices are 2 or 4 bytes. Each frame can write up to verticesPerFrame vertices and indicesPerFrame indices.
+     */
+    void initStreamBuffer(StreamBuffer & stream,
+                          const std::vector<size_t> & valuesPerAttribute,
+                          const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                          const size_t sizeOfIndice,
+                          const size_t verticesPerFrame,
+                          const size_t indicesPerFrame,
+                          const size_t framesInFlight = 3
+                          );
+
+    /*
+     * Moves to the segment of a new frame, call once per frame before writing.
+     * Draws issued since the previous call are fenced.
+     */
+    void beginStreamFrame(StreamBuffer & stream);
+
+    /*
+     * Copies vertices and indices into the segment of current frame. Indices refer to the given
+     * vertices starting from zero, range carries the offsets needed for drawing them.
+     * Returns false and sets error if they do not fit in what is left of the segment.
+     */
+    bool writeStream(StreamBuffer & stream,
+                     const void * vertices, const size_t numberOfVertices,
+                     const void * indices, const size_t numberOfIndices,
+                     StreamRange & range
+                     );
+    void drawStream(StreamBuffer & stream, const StreamRange & range);
+    void drawStream(StreamBuffer & stream, const StreamRange & range, const GL_I customDataType);
+    // Number of times the GPU was behind and buffers were orphaned, frames in flight can be raised if this grows
+    size_t numberOfStreamOrphans(const StreamBuffer & stream);
+    void releaseStreamBuffer(StreamBuffer & stream);
 }
 
 #endif
@@ -0,0 +1,85 @@
+#ifndef STB_GL_POOL_HH_
+#define STB_GL_POOL_HH_
+
+#include "stb_allocator.hh"
+#include "stb_gl_object.hh"
+#include "stb_types.hh"
+
+#include <vector>
+
+namespace stb
+{
+    class ModelData;
+
+    /*
+     * Place of one model in geometry pool, drawn with base vertex from the shared buffers
+     */
+    struct PooledMesh
+    {
+        PooledMesh();
+        bool valid() const { return numberOfIndices != 0; }
+
+        size_t firstVertex;
+        size_t numberOfVertices;
+        size_t firstIndex;
+        size_t numberOfIndices;
+        GL_I typeOfData;
+    };
+
+    /*
+     * Many models of the same vertex format suballocated from one vertex and one index buffer,
+     * drawn through a single vao. Vertices are interleaved floats, valuesPerAttribute giving the number
+     * of floats in each attribute, and indices are stored as U32. Buffers start with room for the given
+     * number of vertices and indices and double when they run out. GL objects are created on construction
+     * and released on destruction, so the pool must not outlive the GL context.
+     */
+    class GeometryPool
+    {
+    public:
+        GeometryPool(const std::vector<size_t> & valuesPerAttribute,
+                     const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                     const size_t initialVertices = 65536,
+                     const size_t initialIndices = 196608);
+        ~GeometryPool();
+
+        /*
+         * Copies model into the pool. Returns invalid mesh and sets error if model is not
+         * a single buffer of the pool's vertex format.
+         */
+        PooledMesh add(const ModelData & model);
+        void remove(PooledMesh & mesh);
+
+        /*
+         * Binds the vao of the pool, meshes are then drawn with draw without rebinding
+         */
+        void bind();
+        void draw(const PooledMesh & mesh);
+        void draw(const PooledMesh & mesh, const GL_I customDataType);
+
+        GL_U vao() const { return m_vao; }
+        size_t numberOfMeshes() const { return m_numberOfMeshes; }
+        size_t usedVertices() const { return m_vertices.capacity() - m_vertices.freeUnits(); }
+        size_t usedIndices() const { return m_indices.capacity() - m_indices.freeUnits(); }
+
+    private:
+        bool sameFormat(const ModelData & model) const;
+        void growVertices(const size_t atLeast);
+        void growIndices(const size_t atLeast);
+        void setAttributePointers();
+
+        std::vector<size_t> m_valuesPerAttribute;
+        ShaderAttributeLayoutInfo m_shaderAttributeIndexInfo;
+        size_t m_sizeOfVertex;
+        GL_U m_vao;
+        GL_U m_vertexBuffer;
+        GL_U m_indiceBuffer;
+        FreeListAllocator m_vertices;
+        FreeListAllocator m_indices;
+        size_t m_numberOfMeshes;
+
+        GeometryPool(const GeometryPool & /*other*/);
+        GeometryPool & operator = (const GeometryPool & /*other*/);
+    };
+}
+
+#endif
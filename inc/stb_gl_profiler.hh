@@ -0,0 +1,140 @@
+#ifndef STB_GL_PROFILER_HH_
+#define STB_GL_PROFILER_HH_
+
+#include "stb_types.hh"
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace stb
+{
+    #define STB_GL_PROFILER_HISTORY 64
+
+    /*
+     * GPU time of one scope name over the last STB_GL_PROFILER_HISTORY frames that used it.
+     * Time of a frame is the sum of every scope of the name in that frame.
+     */
+    struct GpuScopeStatistics
+    {
+        GpuScopeStatistics();
+
+        std::string name;
+        double lastMs;
+        double averageMs;
+        double minMs;
+        double maxMs;
+        size_t callsInLastFrame;
+        size_t frames;
+        double history[STB_GL_PROFILER_HISTORY];
+    };
+
+    /*
+     * Measures GPU time of named scopes with timestamp queries (ARB_timer_query). Queries come from
+     * a pool and are read back framesOfLatency frames later, a frame whose queries are not yet
+     * available waits for the next endFrame instead of stalling. Scopes may nest, each frame is also
+     * measured as scope "frame". At most maxScopesPerFrame scopes are measured per frame, the rest
+     * are counted as dropped.
+     *
+     * Without ARB_timer_query supported() is false and scopes cost nothing. GL objects are created
+     * on construction and released on destruction, so the profiler must not outlive the GL context.
+     */
+    class GpuProfiler
+    {
+    public:
+        explicit GpuProfiler(const size_t framesOfLatency = 3, const size_t maxScopesPerFrame = 1024);
+        ~GpuProfiler();
+
+        bool supported() const { return m_supported; }
+
+        void beginFrame();
+        void endFrame();
+
+        /*
+         * name must stay valid while the profiler is used, string literals are meant.
+         * Returns handle for endScope, or -1 if the scope is not measured.
+         */
+        I beginScope(const char * name);
+        void endScope(const I scope);
+
+        /*
+         * Statistics of every scope measured so far, ordered by name
+         */
+        std::vector<GpuScopeStatistics> statistics() const;
+        const GpuScopeStatistics * statistics(const std::string & name) const;
+        size_t droppedScopes() const { return m_droppedScopes; }
+
+    private:
+        struct Scope
+        {
+            size_t name;
+            GL_U begin;
+            GL_U end;
+        };
+
+        struct Frame
+        {
+            size_t number;
+            std::vector<Scope> scopes;
+        };
+
+        size_t nameIndex(const char * name);
+        GL_U takeQuery();
+        bool collect(Frame & frame);
+
+        bool m_supported;
+        size_t m_framesOfLatency;
+        size_t m_maxScopesPerFrame;
+        size_t m_frameNumber;
+        bool m_inFrame;
+        I m_frameScope;
+        Frame m_current;
+        std::deque<Frame> m_pending;
+        std::vector<GL_U> m_freeQueries;
+        std::vector<GL_U> m_allQueries;
+        std::map<const char *, size_t> m_namesByPointer;
+        std::map<std::string, size_t> m_namesByString;
+        std::vector<GpuScopeStatistics> m_statistics;
+        size_t m_droppedScopes;
+
+        GpuProfiler(const GpuProfiler & /*other*/);
+        GpuProfiler & operator = (const GpuProfiler & /*other*/);
+    };
+
+    /*
+     * Profiler measuring scopes of stb itself, such as bindAndDraw and renderText.
+     * None by default, set to zero to stop measuring.
+     */
+    void setActiveGpuProfiler(GpuProfiler * profiler);
+    GpuProfiler * activeGpuProfiler();
+
+    /*
+     * Measures GPU time until end of the C++ scope, does nothing if profiler is zero
+     */
+    class GpuScope
+    {
+    public:
+        GpuScope(GpuProfiler * profiler, const char * name)
+        : m_profiler(profiler),
+        m_scope(profiler ? profiler->beginScope(name) : -1)
+        {}
+
+        ~GpuScope()
+        {
+            if (m_profiler) {
+                m_profiler->endScope(m_scope);
+            }
+        }
+
+    private:
+        GpuProfiler * m_profiler;
+        I m_scope;
+
+        GpuScope(const GpuScope & /*other*/);
+        GpuScope & operator = (const GpuScope & /*other*/);
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef STB_GL_STATE_HH_
+#define STB_GL_STATE_HH_
+
+#include "stb_types.hh"
+#include <cstddef>
+
+namespace stb
+{
+    #define STB_GL_STATE_MAX_TEXTURE_UNITS 32
+
+    /*
+     * Shadow of the GL state set through stb: current program, vao, buffer and texture bindings,
+     * active texture unit and blend, depth and cull state. A call setting a value that is already set
+     * is not passed to GL and is counted as elided. Everything starts as unknown, so the first call for
+     * each value always reaches GL.
+     *
+     * The shadow follows one context, the one current on the thread rendering with stb. Code changing
+     * the same state with plain GL calls, or switching contexts, must call invalidate afterwards.
+     * Objects must be deleted through the delete functions here, GL reuses names of deleted objects.
+     */
+    namespace glstate
+    {
+        namespace Counter {
+            enum Type
+            {
+                Program,
+                VertexArray,
+                Buffer,
+                ActiveTexture,
+                Texture,
+                Capability,
+                BlendFunc,
+                DepthFunc,
+                DepthMask,
+                CullFace,
+                NumberOfCounters
+            };
+        }
+
+        struct Counters
+        {
+            Counters();
+
+            size_t issued[Counter::NumberOfCounters];
+            size_t elided[Counter::NumberOfCounters];
+        };
+
+        void useProgram(const GL_U program);
+        void bindVertexArray(const GL_U vao);
+
+        /*
+         * Element array binding belongs to the vao, it is forgotten whenever another vao is bound.
+         * Targets not shadowed are passed to GL as is.
+         */
+        void bindBuffer(const GL_I target, const GL_U buffer);
+
+        /*
+         * unit is the index of the unit, not GL_TEXTURE0 + index
+         */
+        void activeTexture(const GL_U unit);
+        void bindTexture(const GL_I target, const GL_U texture);
+        void bindTexture(const GL_U unit, const GL_I target, const GL_U texture);
+
+        /*
+         * GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST and GL_PROGRAM_POINT_SIZE are shadowed,
+         * other capabilities are passed to GL as is
+         */
+        void enable(const GL_I capability);
+        void disable(const GL_I capability);
+        void blendFunc(const GL_I sourceFactor, const GL_I destinationFactor);
+        void depthFunc(const GL_I function);
+        void depthMask(const bool write);
+        void cullFace(const GL_I face);
+
+        void deletePrograms(const size_t count, const GL_U * programs);
+        void deleteVertexArrays(const size_t count, const GL_U * vaos);
+        void deleteBuffers(const size_t count, const GL_U * buffers);
+        void deleteTextures(const size_t count, const GL_U * textures);
+
+        /*
+         * Forgets every shadowed value, counters are kept
+         */
+        void invalidate();
+
+        const Counters & counters();
+        void resetCounters();
+    }
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef STB_GL_UPLOADER_HH_
+#define STB_GL_UPLOADER_HH_
+
+#include "stb_gl_object.hh"
+#include "stb_model.hh"
+#include "stb_types.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace stb
+{
+    namespace UploadState {
+        enum Type
+        {
+            // Queued, being uploaded or not yet finished by the GPU
+            Pending,
+            // Taken by this call, owned by the caller from now on
+            Done,
+            // Loader could not upload, or ticket is unknown
+            Failed
+        };
+    }
+
+    /*
+     * 2D texture to upload, pixels are rows of width * bytesPerPixel bytes without padding
+     */
+    struct TextureUpload
+    {
+        TextureUpload();
+
+        size_t width;
+        size_t height;
+        size_t bytesPerPixel;
+        GL_I internalFormat;
+        GL_I format;
+        GL_I type;
+        GL_I minFilter;
+        GL_I magFilter;
+        GL_I wrap;
+        bool mipmaps;
+        // Pixels stay valid while owner is held
+        std::shared_ptr<const void> owner;
+        const void * pixels;
+    };
+
+    /*
+     * Uploads models and textures on a loader thread with a GL context of its own, shared with the
+     * render context, so that large uploads do not stall rendering. makeCurrent is called on the
+     * loader thread to make the shared context current there and doneCurrent when the thread exits.
+     *
+     * Each upload ends with a fence. The render thread takes finished uploads with takeModel and
+     * takeTexture, which only test the fence and never wait. Vaos are not shared between contexts, so
+     * takeModel creates the vao on the render thread around buffers made by the loader. Textures are
+     * staged through a pixel unpack buffer of stagingSize bytes, larger ones are copied in bands of rows.
+     *
+     * Loader thread uses plain GL calls, glstate follows the render context only. Uploads not taken
+     * when uploader is destroyed are released.
+     */
+    class AsyncUploader
+    {
+    public:
+        typedef std::function<bool ()> MakeCurrent;
+        typedef std::function<void ()> DoneCurrent;
+        // Zero is never a valid ticket
+        typedef size_t Ticket;
+
+        AsyncUploader(const MakeCurrent & makeCurrent,
+                      const DoneCurrent & doneCurrent,
+                      const size_t stagingSize = 4 * 1024 * 1024);
+        ~AsyncUploader();
+
+        /*
+         * False if context of loader could not be made current, uploads then fail
+         */
+        bool ready();
+
+        /*
+         * Data of model must stay valid until its upload is taken
+         */
+        Ticket uploadModel(const ModelData & model);
+        Ticket uploadTexture(const TextureUpload & texture);
+
+        UploadState::Type takeModel(const Ticket ticket,
+                                    VertexArrayObject & vao,
+                                    const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo);
+        UploadState::Type takeTexture(const Ticket ticket, GL_U & texture);
+
+        size_t numberOfPending();
+
+    private:
+        struct Job
+        {
+            Ticket ticket;
+            std::vector<ModelData> model;
+            TextureUpload texture;
+        };
+
+        struct Finished
+        {
+            Ticket ticket;
+            bool failed;
+            void * fence;
+            std::vector<ModelData> model;
+            std::vector<GL_U> buffers;
+            GL_U texture;
+        };
+
+        void run();
+        void loadModel(const ModelData & model, Finished & finished);
+        void loadTexture(const TextureUpload & texture, Finished & finished);
+        bool takeFinished(const Ticket ticket, Finished & finished, UploadState::Type & state);
+
+        MakeCurrent m_makeCurrent;
+        DoneCurrent m_doneCurrent;
+        size_t m_stagingSize;
+        GL_U m_stagingBuffer;
+        Ticket m_nextTicket;
+        // -1 until loader has tried to make its context current, then 0 or 1
+        I m_ready;
+        bool m_stop;
+        std::mutex m_lock;
+        std::condition_variable m_changed;
+        std::deque<Job> m_jobs;
+        // Tickets submitted and not yet taken
+        std::set<Ticket> m_pending;
+        std::vector<Finished> m_finished;
+        std::thread m_thread;
+
+        AsyncUploader(const AsyncUploader & /*other*/);
+        AsyncUploader & operator = (const AsyncUploader & /*other*/);
+    };
+}
+
+#endif
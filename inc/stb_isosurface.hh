@@ -0,0 +1,57 @@
+#ifndef STB_ISOSURFACE_HH_
+#define STB_ISOSURFACE_HH_
+
+#include "stb_model.hh"
+#include "stb_types.hh"
+
+#include <functional>
+
+namespace stb
+{
+    /*
+     * Signed distance (or any other scalar field) at world position (x, y, z).
+     * Called from several threads at once.
+     */
+    typedef std::function<float (const float x, const float y, const float z)> DistanceFunction;
+
+    struct IsosurfaceSettings
+    {
+        // Samples along each axis, at least 2
+        U samplesX;
+        U samplesY;
+        U samplesZ;
+        // World position of sample (0, 0, 0)
+        float originX;
+        float originY;
+        float originZ;
+        // Distance between neighbouring samples in world units
+        float spacing;
+        // Values below this are inside of the surface
+        float isoLevel;
+    };
+
+    /*
+     * Extracts surface where field crosses isoLevel with surface nets, a form of dual contouring:
+     * every cell of eight samples the surface passes through gets one vertex at the mean of the crossings
+     * on its edges, and every crossed edge between samples gets a quad joining the four cells around it.
+     * Model has vertex (3 floats) and normal (3 floats) per element, U32 triangle indices, triangles
+     * facing outside. Normals are gradients of the field over the cell. Surface is closed unless it reaches
+     * the outermost samples.
+     *
+     * Volume is split into slabs of cells processed by numberOfThreads workers, 0 meaning all
+     * hardware threads. Each slab keeps its own vertices sorted by cell, slabs are then merged into one
+     * model by prefix sums of their sizes. Result does not depend on number of workers.
+     * Returns invalid model and sets error if settings are not valid.
+     */
+    ModelData generateIsosurface(const DistanceFunction & distance, const IsosurfaceSettings & settings,
+        const U numberOfThreads = 0);
+
+    /*
+     * As above, but field is taken from a dense grid of samplesX * samplesY * samplesZ values,
+     * x running fastest. Volume is read in place, not copied.
+     */
+    ModelData generateIsosurface(const float * volume, const IsosurfaceSettings & settings,
+        const U numberOfThreads = 0);
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef STB_JSON_HH_
+#define STB_JSON_HH_
+
+#include "stb_types.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace stb
+{
+namespace json
+{
+    enum Type
+    {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    static const U32 NO_NODE = 0xffffffff;
+
+    /*
+     * Node of a parsed document. Strings and keys point to the parsed text,
+     * which must outlive the document; escape sequences are not resolved.
+     */
+    struct Node
+    {
+        Type type;
+        double number; // Number, or 1 / 0 for boolean
+        const char * text; // String without quotes
+        size_t textLength;
+        const char * key; // Key when node is a member of an object
+        size_t keyLength;
+        U32 numberOfChildren;
+        U32 firstChild;
+        U32 nextSibling;
+    };
+
+    /*
+     * All nodes of a document in a single container, root is the first node
+     */
+    struct Document
+    {
+        std::vector<Node> nodes;
+
+        const Node & root(void) const { return nodes[0]; }
+    };
+
+    /*
+     * Parses text into document, on failure sets error and returns false
+     */
+    bool parse(const char * text, const size_t size, Document & document);
+
+    /*
+     * Returns member of an object with given key or 0 if there is no such member
+     */
+    const Node * member(const Document & document, const Node & object, const char * key);
+
+    /*
+     * Returns element of an array at index or 0 if index is out of range
+     */
+    const Node * element(const Document & document, const Node & array, const size_t index);
+
+    /*
+     * Returns number of a member or defaultValue if member is not a number
+     */
+    double numberMember(const Document & document, const Node & object, const char * key, const double defaultValue);
+
+    /*
+     * Returns true if node is a string equal to value
+     */
+    bool equals(const Node * node, const char * value);
+}
+}
+
+#endif
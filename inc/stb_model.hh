@@ -18,20 +18,28 @@ namespace stb
         enum AttributeBufferDataType { FLOAT, UINT32 };
         typedef std::vector<size_t> ValuesPerAttributeContainer;
 
+        typedef std::shared_ptr<const void> DataOwner;
+
         struct AttributeData
         {
+            // Copies attribute data
             AttributeData(const char * attrBufferData,
                 const size_t attrBufferDataSize,
                 const ValuesPerAttributeContainer & valuesPerAttr,
                 const size_t sizeOfAttrElement,
-                const AttributeBufferDataType attrDataType)
-            : m_attributeData(attrBufferData, attrBufferDataSize),
-            m_valuesPerAttribute(valuesPerAttr),
-            m_sizeOfAttributeElement(sizeOfAttrElement),
-            m_dataType(attrDataType)
-            {}
-
-            std::string m_attributeData;
+                const AttributeBufferDataType attrDataType);
+
+            // References attribute data without copying, owner keeps the data alive
+            AttributeData(const DataOwner & owner,
+                const char * attrBufferData,
+                const size_t attrBufferDataSize,
+                const ValuesPerAttributeContainer & valuesPerAttr,
+                const size_t sizeOfAttrElement,
+                const AttributeBufferDataType attrDataType);
+
+            DataOwner m_owner;
+            const char * m_attributeData;
+            size_t m_attributeDataSize;
             ValuesPerAttributeContainer m_valuesPerAttribute;
             size_t m_sizeOfAttributeElement;
             AttributeBufferDataType m_dataType;
@@ -40,6 +48,7 @@ namespace stb
         typedef std::shared_ptr<const AttributeData> AttributeElement;
         typedef std::vector<AttributeElement> AttributeElementContainer;
 
+        // Copies indices
         ModelData(AttributeElementContainer attrDataBuffers,
             const char * indicesBuffer,
             const size_t indicesBufferSize,
@@ -47,6 +56,15 @@ namespace stb
             const AttributeDataMode modeOfAttrData
             );
 
+        // References indices without copying, owner keeps the indices alive
+        ModelData(AttributeElementContainer attrDataBuffers,
+            const DataOwner & indicesOwner,
+            const char * indicesBuffer,
+            const size_t indicesBufferSize,
+            const size_t indiceElementSize,
+            const AttributeDataMode modeOfAttrData
+            );
+
         ModelData(const ModelData & other);
         ModelData();
 
@@ -61,10 +79,12 @@ namespace stb
         size_t numberOfAttributes() const { return m_numberAttributes; }
         size_t pointerToDataInBuffer(const size_t attributeBufferIndex, const size_t attrIndex) const;
 
-        size_t indicesDataSize(void) const { return m_indicesBuffer.size(); }
-        const char * indicesData(void) const { return m_indicesBuffer.c_str(); }
+        size_t indicesDataSize(void) const { return m_indicesDataSize; }
+        const char * indicesData(void) const { return m_indicesData; }
         size_t sizeOfIndiceElement(void) const { return m_indiceElementSize; }
         AttributeDataMode attributeDataMode(void) const { return m_modeOfAttributeData; }
+        // Keeps indices alive, empty if indices are not owned by model
+        const DataOwner & indicesOwner(void) const { return m_indicesOwner; }
 
         bool valid() const {
             return (m_numberAttributes != 0)
@@ -76,7 +96,9 @@ namespace stb
         AttributeElementContainer m_attrDataBuffers;
         U32 m_numberAttributes;
 
-        const std::string m_indicesBuffer;
+        const DataOwner m_indicesOwner;
+        const char * const m_indicesData;
+        const size_t m_indicesDataSize;
         const size_t m_indiceElementSize;
         const AttributeDataMode m_modeOfAttributeData;
 
@@ -88,7 +110,42 @@ namespace stb
         void  operator = (const ModelData & /*other*/) {}
     };
 
+    /*
+     * Reads model from .sm data, version 1 ("vn" format) and version 2 are supported
+     */
     ModelData readModel(const char * buffer, const size_t size);
+
+    /*
+     * Size of model serialized in .sm format, 0 if model can not be serialized
+     */
+    size_t writtenModelSize(const ModelData & model);
+
+    /*
+     * Serializes model, with all attribute buffers, indices and mode, in .sm version 2 format.
+     * Model data is written piece by piece straight from model's buffers without
+     * assembling a copy of the whole output. On failure error is set and false returned.
+     */
+    bool writeModel(const ModelData & model, FILE * stream);
+
+    /*
+     * As above, but into a new file at path. On Linux data is written with vectored writes.
+     */
+    bool writeModel(const ModelData & model, const char * path);
+
+    /*
+     * As above, but into memory, fails if outputSize is less than writtenModelSize(model)
+     */
+    bool writeModel(const ModelData & model, char * output, const size_t outputSize);
+
+    /*
+     * Reads first primitive of first mesh from binary glTF (.glb).
+     * Each of POSITION, NORMAL, TEXCOORD_0, TANGENT and COLOR_0 attributes found (in this order)
+     * becomes its own attribute buffer and, like indices, references buffer without copying.
+     * Owner, if given, is kept alive by the model, otherwise buffer must outlive the model.
+     */
+    ModelData readGlbModel(const char * buffer, const size_t size,
+        const ModelData::DataOwner & owner = ModelData::DataOwner());
+
     void dumpModel(const stb::ModelData & model, FILE * stream);
 
 }
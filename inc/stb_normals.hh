@@ -0,0 +1,25 @@
+#ifndef STB_NORMALS_HH_
+#define STB_NORMALS_HH_
+
+#include "stb_types.hh"
+
+namespace stb
+{
+    class ModelData;
+
+    /*
+     * Builds model with vertex (3 floats), normal (3 floats), uv (2 floats) and tangent (4 floats)
+     * per element from indexed triangles of model. Positions are taken from the first attribute of the
+     * first buffer and uv from the first attribute with two values in it, uv is zero if there is none.
+     *
+     * Normals are sums of face normals weighted by face area. Tangents are sums of per face tangents
+     * from uv derivatives, orthogonalized against normal, with handedness of bitangent in w
+     * as in MikkTSpace; vertices are not split, so seams need to exist in the input already.
+     * Indices are shared with model. Triangles are processed by numberOfThreads workers,
+     * 0 meaning all hardware threads, last bits of the result may depend on number of workers.
+     * Returns invalid model and sets error if model is not indexed triangles with float attributes.
+     */
+    ModelData generateNormalsAndTangents(const ModelData & model, const U numberOfThreads = 0);
+}
+
+#endif
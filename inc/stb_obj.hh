@@ -0,0 +1,38 @@
+#ifndef STB_OBJ_HH_
+#define STB_OBJ_HH_
+
+#include "stb_types.hh"
+
+#include <cstddef>
+#include <cstdio>
+
+namespace stb
+{
+    class ModelData;
+
+    /*
+     * Parses a decimal floating point number from [begin, end), independent of locale.
+     * Returns pointer to the first character after the number, or 0 if no number was found.
+     */
+    const char * parseFloat(const char * begin, const char * end, float & value);
+
+    /*
+     * Converts Wavefront .obj data into the layout of .sm "vn" format:
+     * a single attribute buffer with vertex (4 floats) and normal (3 floats),
+     * triangles welded so that equal vertex-normal pairs share an indice.
+     * Faces with more than three points are triangulated as fans.
+     * Lines are parsed in parallel chunks, numberOfThreads 0 means all hardware threads.
+     */
+    ModelData convertObj(const char * buffer, const size_t size, const U numberOfThreads = 0);
+
+    /*
+     * Reads Wavefront .obj from stream in fixed size blocks and builds model with
+     * a single attribute buffer of vertex (3 floats), normal (3 floats) and uv (2 floats),
+     * same layout as used by generators. Corners with equal v/vt/vn indices share an indice,
+     * polygons are triangulated as fans. Vertices without normal get smooth normal
+     * calculated from the faces they belong to.
+     */
+    ModelData readObjModel(FILE * stream);
+}
+
+#endif
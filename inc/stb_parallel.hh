@@ -0,0 +1,64 @@
+#ifndef STB_PARALLEL_HH_
+#define STB_PARALLEL_HH_
+
+#include "stb_types.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace stb
+{
+
+/*
+ * Resolves requested number of worker threads,
+ * zero means one thread per hardware thread
+ */
+inline U numberOfWorkers(const U requested)
+{
+    if (requested != 0) {
+        return requested;
+    }
+    const U hardwareThreads = std::thread::hardware_concurrency();
+    return (hardwareThreads != 0) ? hardwareThreads : 1;
+}
+
+/*
+ * Calls func(taskIndex) for every task in [0, numberOfTasks).
+ * Tasks are pulled by workers from a shared counter, so the order in which
+ * they complete is not defined; output of each task should go to its own range.
+ * Calling thread acts as one of the workers.
+ */
+template <typename Func>
+void parallelFor(const size_t numberOfTasks, const U numberOfThreads, Func func)
+{
+    const size_t workers = std::min<size_t>(numberOfWorkers(numberOfThreads), numberOfTasks);
+    if (workers <= 1) {
+        for (size_t i = 0; i < numberOfTasks; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> nextTask(0);
+    auto worker = [&]() {
+        for (size_t i = nextTask++; i < numberOfTasks; i = nextTask++) {
+            func(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t i = 1; i < workers; ++i) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::thread & t : threads) {
+        t.join();
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef STB_RADIX_SORT_HH_
+#define STB_RADIX_SORT_HH_
+
+#include "stb_types.hh"
+
+#include <vector>
+
+namespace stb
+{
+    /*
+     * Stable least significant digit radix sort of keys, values following their keys.
+     * Sorts a byte per pass, passes in which every key has the same byte are skipped, so keys
+     * using only a few of their bits cost only those passes. Scratch vectors are resized as
+     * needed, keeping them between calls avoids reallocating.
+     */
+    void radixSort(std::vector<U64> & keys,
+                   std::vector<U32> & values,
+                   std::vector<U64> & scratchKeys,
+                   std::vector<U32> & scratchValues
+                   );
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef STB_RENDER_QUEUE_HH_
+#define STB_RENDER_QUEUE_HH_
+
+#include "stb_gl_object.hh"
+#include "stb_types.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace stb
+{
+    /*
+     * Key for draws of opaque geometry: pass, then program, texture and vao so that draws sharing
+     * state are submitted together, then depth front to back. Names only order draws, names
+     * wider than their field share a place with others but are still bound correctly.
+     * depth is normalized view depth, 0 near and 1 far.
+     */
+    U64 makeSortKey(const U pass, const GL_U program, const GL_U texture, const GL_U vao, const float depth);
+
+    /*
+     * Key for draws blended over earlier ones: pass, then depth back to front, then state
+     */
+    U64 makeDepthSortKey(const U pass, const float depth, const GL_U program, const GL_U texture, const GL_U vao);
+
+    /*
+     * Everything needed to draw once, plain data so that it can be recorded on any thread and
+     * copied freely. Indices are drawn from the element buffer of vao, firstIndex counting indices.
+     */
+    struct RenderCommand
+    {
+        RenderCommand();
+
+        U64 key;
+        GL_U program;
+        GL_U vao;
+        // Bound to GL_TEXTURE_2D of textureUnit when not zero
+        GL_U texture;
+        GL_U textureUnit;
+        GL_I typeOfData;
+        GL_I indiceElementSizeGlEnum;
+        GL_I numberOfIndices;
+        GL_U firstIndex;
+        GL_I baseVertex;
+        // Zero draws without instancing
+        GL_I numberOfInstances;
+        // Set as mat4 uniform when location is not -1
+        GL_I matrixLocation;
+        float matrix[16];
+    };
+
+    /*
+     * Command drawing vao as bindAndDraw or bindAndDrawInstanced would
+     */
+    RenderCommand makeRenderCommand(const U64 key, const GL_U program, VertexArrayObject & vao);
+
+    typedef std::vector<RenderCommand> RenderCommands;
+
+    /*
+     * Draws recorded into any number of command buffers, then sorted by key and executed together.
+     * Each buffer must be recorded by at most one thread at a time, giving each recording thread or
+     * task a buffer of its own lets draws be recorded in parallel without locking. Commands with equal
+     * keys keep the order of their buffers and of recording. Sorting and executing happen on the thread
+     * of the GL context, state is set through glstate so repeated state between commands is elided.
+     */
+    class RenderQueue
+    {
+    public:
+        explicit RenderQueue(const size_t numberOfBuffers = 1);
+
+        void setNumberOfBuffers(const size_t numberOfBuffers);
+        size_t numberOfBuffers() const { return m_buffers.size(); }
+        RenderCommands & buffer(const size_t index) { return m_buffers[index]; }
+
+        /*
+         * Empties all buffers, keeping their memory for the next frame
+         */
+        void clear();
+
+        /*
+         * Merges buffers and sorts their commands by key, returns number of commands
+         */
+        size_t sort();
+        size_t numberOfCommands() const { return m_order.size(); }
+        const RenderCommand & sortedCommand(const size_t index) const;
+
+        /*
+         * Sorts and draws every command. Commands stay recorded, so an unchanged frame can be
+         * executed again.
+         */
+        void execute();
+
+    private:
+        std::vector<RenderCommands> m_buffers;
+        // Index of first command of each buffer among all commands, and total as last element
+        std::vector<size_t> m_firstOfBuffer;
+        std::vector<U64> m_keys;
+        std::vector<U32> m_order;
+        std::vector<U64> m_scratchKeys;
+        std::vector<U32> m_scratchOrder;
+    };
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef STB_SIMD_HH_
+#define STB_SIMD_HH_
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define STB_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace stb
+{
+/*
+ * Four floats processed at once. Maps to SSE where available and to plain loops elsewhere,
+ * operations are exactly rounded in both, so results do not depend on the path taken.
+ */
+namespace simd
+{
+
+#if defined(STB_SIMD_SSE)
+
+typedef __m128 Float4;
+
+inline Float4 load(const float * p) { return _mm_loadu_ps(p); }
+inline void store(float * p, const Float4 a) { _mm_storeu_ps(p, a); }
+inline Float4 set1(const float a) { return _mm_set1_ps(a); }
+inline Float4 add(const Float4 a, const Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 sub(const Float4 a, const Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 mul(const Float4 a, const Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 div(const Float4 a, const Float4 b) { return _mm_div_ps(a, b); }
+inline Float4 min(const Float4 a, const Float4 b) { return _mm_min_ps(a, b); }
+inline Float4 max(const Float4 a, const Float4 b) { return _mm_max_ps(a, b); }
+inline Float4 sqrt(const Float4 a) { return _mm_sqrt_ps(a); }
+// Bit i set when lane i of a is less than lane i of b
+inline int lessMask(const Float4 a, const Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+
+#else
+
+struct Float4
+{
+    float v[4];
+};
+
+#define STB_SIMD_FOR_EACH(expression) \
+    Float4 r; \
+    for (int i = 0; i < 4; ++i) { r.v[i] = (expression); } \
+    return r
+
+inline Float4 load(const float * p) { STB_SIMD_FOR_EACH(p[i]); }
+inline void store(float * p, const Float4 a) { for (int i = 0; i < 4; ++i) { p[i] = a.v[i]; } }
+inline Float4 set1(const float a) { STB_SIMD_FOR_EACH(a); }
+inline Float4 add(const Float4 a, const Float4 b) { STB_SIMD_FOR_EACH(a.v[i] + b.v[i]); }
+inline Float4 sub(const Float4 a, const Float4 b) { STB_SIMD_FOR_EACH(a.v[i] - b.v[i]); }
+inline Float4 mul(const Float4 a, const Float4 b) { STB_SIMD_FOR_EACH(a.v[i] * b.v[i]); }
+inline Float4 div(const Float4 a, const Float4 b) { STB_SIMD_FOR_EACH(a.v[i] / b.v[i]); }
+inline Float4 min(const Float4 a, const Float4 b) { STB_SIMD_FOR_EACH((b.v[i] < a.v[i]) ? b.v[i] : a.v[i]); }
+inline Float4 max(const Float4 a, const Float4 b) { STB_SIMD_FOR_EACH((a.v[i] < b.v[i]) ? b.v[i] : a.v[i]); }
+inline Float4 sqrt(const Float4 a) { STB_SIMD_FOR_EACH(std::sqrt(a.v[i])); }
+
+inline int lessMask(const Float4 a, const Float4 b)
+{
+    int mask = 0;
+    for (int i = 0; i < 4; ++i) { mask |= (a.v[i] < b.v[i]) ? (1 << i) : 0; }
+    return mask;
+}
+
+#undef STB_SIMD_FOR_EACH
+
+#endif
+
+}
+}
+
+#endif
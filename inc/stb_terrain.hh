@@ -0,0 +1,141 @@
+#ifndef STB_TERRAIN_HH_
+#define STB_TERRAIN_HH_
+
+#include "stb_model.hh"
+#include "stb_types.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stb
+{
+    /*
+     * Height of terrain at world position (x, z). Called from the streaming thread.
+     */
+    typedef std::function<float (const float x, const float z)> HeightFunction;
+
+    /*
+     * Bilinearly interpolated height from a row major heightmap whose samples are spacing apart,
+     * sample (0, 0) being at world origin. Positions outside of the map are clamped to its border.
+     */
+    float sampleHeightmap(const float * heights, const U width, const U depth, const float spacing,
+        const float x, const float z);
+
+    /*
+     * Sum of octaves of smoothly interpolated value noise, roughly in [-1, 1].
+     * Each octave doubles the frequency and halves the amplitude of the previous.
+     */
+    float fractalNoise(const float x, const float z, const U octaves, const U32 seed);
+
+    struct TerrainSettings
+    {
+        // Quads along a side of chunk, must be divisible by 2^(levelsOfDetail - 1)
+        U resolution;
+        // Length of a side of chunk in world units
+        float chunkSize;
+        // Level l draws every 2^l:th vertex of the chunk
+        U levelsOfDetail;
+        // How far below the edges skirts reach to hide cracks between chunks of different levels
+        float skirtDepth;
+    };
+
+    struct TerrainChunkCoordinate
+    {
+        I x;
+        I z;
+
+        bool operator < (const TerrainChunkCoordinate & other) const
+        {
+            return (x < other.x) || ((x == other.x) && (z < other.z));
+        }
+        bool operator == (const TerrainChunkCoordinate & other) const
+        {
+            return (x == other.x) && (z == other.z);
+        }
+    };
+
+    /*
+     * Range of indices drawing one level of detail of chunk, skirts included
+     */
+    struct TerrainLod
+    {
+        size_t firstIndex;
+        size_t numberOfIndices;
+    };
+
+    struct TerrainChunk
+    {
+        TerrainChunkCoordinate coordinate;
+        ModelData model;
+        std::vector<TerrainLod> lods;
+    };
+
+    /*
+     * Builds chunk covering [x * chunkSize, (x + 1) * chunkSize] along both axes.
+     * Model has the same layout as generated shapes: vertex (3 floats), normal (3 floats) and uv (2 floats)
+     * per element, U32 triangle indices. All levels of detail share the vertices and each has its own
+     * range of indices, draw them with bindAndDrawRange. Normals are calculated from neighbouring heights,
+     * also across chunk borders, so that neighbouring chunks match seamlessly.
+     * Returns invalid model and sets error if settings are not valid.
+     */
+    ModelData generateTerrainChunk(const TerrainSettings & settings, const HeightFunction & height,
+        const TerrainChunkCoordinate & coordinate, std::vector<TerrainLod> & lods);
+
+    TerrainChunkCoordinate terrainChunkAt(const TerrainSettings & settings, const float x, const float z);
+
+    /*
+     * Level of detail for chunk, growing with distance in chunks from the chunk at camera
+     */
+    U selectTerrainLod(const TerrainSettings & settings, const TerrainChunkCoordinate & coordinate,
+        const float cameraX, const float cameraZ);
+
+    /*
+     * Keeps chunks within radius (in chunks) of camera generated. Missing chunks are generated
+     * in a background thread nearest first, only chunks around camera are ever held in memory.
+     */
+    class TerrainStreamer
+    {
+    public:
+        TerrainStreamer(const TerrainSettings & settings, const HeightFunction & height, const U radius);
+        ~TerrainStreamer();
+
+        /*
+         * Requests chunks around camera. Chunks that have been taken earlier but are now more than
+         * one chunk outside of the radius are appended to evicted, and will be generated again if needed.
+         */
+        void update(const float cameraX, const float cameraZ, std::vector<TerrainChunkCoordinate> & evicted);
+
+        /*
+         * Appends chunks generated since last call to chunks.
+         * Returns false if there were none.
+         */
+        bool takeReady(std::vector<TerrainChunk> & chunks);
+
+    private:
+        enum ChunkState { QUEUED, GENERATING, READY, TAKEN };
+
+        void run();
+
+        const TerrainSettings m_settings;
+        const HeightFunction m_height;
+        const I m_radius;
+        std::map<TerrainChunkCoordinate, ChunkState> m_chunks;
+        std::deque<TerrainChunkCoordinate> m_requests;
+        std::vector<TerrainChunk> m_ready;
+        std::atomic<bool> m_stop;
+        std::mutex m_lock;
+        std::condition_variable m_wakeUp;
+        std::thread m_thread;
+
+        TerrainStreamer(const TerrainStreamer & /*other*/);
+        TerrainStreamer & operator = (const TerrainStreamer & /*other*/);
+    };
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef STB_WATCH_HH_
+#define STB_WATCH_HH_
+
+#include "stb_model.hh"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stb
+{
+    /*
+     * Watches a model file and re-reads it with loader in a background thread
+     * whenever the file has been written or replaced. Directory of the file is watched,
+     * so editors that save through rename are noticed too. Only Linux (inotify) is supported,
+     * elsewhere watcher is never ready.
+     */
+    class ModelWatcher
+    {
+    public:
+        typedef std::function<ModelData (const std::string & path)> Loader;
+
+        ModelWatcher(const std::string & pathToFile, const Loader & loader);
+        ~ModelWatcher();
+
+        bool ready() const { return m_ready; }
+
+        /*
+         * Moves the latest reloaded model into models (replacing previous content).
+         * Returns false if file has not been reloaded since last call.
+         * Invalid models returned by loader are dropped.
+         */
+        bool takeReloaded(std::vector<ModelData> & models);
+
+    private:
+        void run();
+
+        std::string m_path;
+        std::string m_fileName;
+        Loader m_loader;
+        I m_inotify;
+        bool m_ready;
+        std::atomic<bool> m_stop;
+        std::mutex m_lock;
+        std::vector<ModelData> m_reloaded;
+        std::thread m_thread;
+
+        ModelWatcher(const ModelWatcher & /*other*/);
+        ModelWatcher & operator = (const ModelWatcher & /*other*/);
+    };
+}
+
+#endif
@@ -15,7 +15,7 @@ fi
 
 cd "$folder"
 mkdir -p "$target"
-lua LoadGen.lua -spec=gl -version=3.2 "$target"/stb
+lua LoadGen.lua -spec=gl -version=3.2 -ext=ARB_instanced_arrays -ext=ARB_draw_indirect -ext=ARB_multi_draw_indirect -ext=ARB_timer_query "$target"/stb
 
 echo "Gl installation done"
 echo "Files generated to $target"
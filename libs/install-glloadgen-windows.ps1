@@ -19,6 +19,6 @@ if (!(Test-Path "$folder")) {
 rm  -Recurse -Force "$target" -ea SilentlyContinue
 cd "$folder"
 mkdir -Force "$target"
-lua5.1 LoadGen.lua "-spec=gl" "-version=3.2" $target/stb
+lua5.1 LoadGen.lua "-spec=gl" "-version=3.2" "-ext=ARB_instanced_arrays" "-ext=ARB_draw_indirect" "-ext=ARB_multi_draw_indirect" "-ext=ARB_timer_query" $target/stb
 
 echo "Gl installation done to $target"
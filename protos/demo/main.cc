@@ -1,5 +1,6 @@
 #define STB_DEFAULT_TIMER_TYPES
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
 #include "stb_log_boost.hh"
 #include "stb_util.hh"
 #include "stb_game.hh"
@@ -8,7 +9,7 @@
 #include "stb_gl_shader.hh"
 #include "stb_error.hh"
 #include "stb_model.hh"
-#include "stb_generator.hh"
+#include "stb_baked.hh"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -81,7 +82,7 @@ public:
             }
         }
         {
-            const stb::ModelData cube = stb::generateCube(2);
+            const stb::ModelData cube = stb::baked::cubeModel<2>();
             GL_I layoutPosition = -1;
 
             if ((layoutPosition = glGetAttribLocation(stb::glRef(m_shader), "position")) == -1) {
@@ -121,10 +122,10 @@ public:
                                                       glm::vec3(0.0f, 0.0f, 0.0f),
                                                       glm::vec3(0.0f, 1.0f, 0.0f));
 
-            glUseProgram(stb::glRef(m_shader));
+            stb::glstate::useProgram(stb::glRef(m_shader));
             glUniformMatrix4fv(c, 1, GL_FALSE, glm::value_ptr(projection));
             glUniformMatrix4fv(v, 1, GL_FALSE, glm::value_ptr(view));
-            glUseProgram(0);
+            stb::glstate::useProgram(0);
         }
         {
             int b = 0, s = 0;
@@ -167,11 +168,10 @@ public:
         glUniformMatrix4fv(m_modelMatrix, 1, GL_FALSE, glm::value_ptr(model));
         stb::bindAndDraw(m_vao);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glUseProgram(0);
+        stb::glstate::bindTexture(GL_TEXTURE_2D, 0);
+        stb::glstate::bindVertexArray(0);
+        stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+        stb::glstate::useProgram(0);
         SDL_GL_SwapWindow(m_window);
     }
 
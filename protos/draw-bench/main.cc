@@ -0,0 +1,352 @@
+#include "stb_culling.hh"
+#include "stb_gl.hh"
+#include "stb_gl_batch.hh"
+#include "stb_gl_object.hh"
+#include "stb_gl_pool.hh"
+#include "stb_gl_profiler.hh"
+#include "stb_gl_shader.hh"
+#include "stb_gl_state.hh"
+#include "stb_parallel.hh"
+#include "stb_render_queue.hh"
+#include "stb_buffer.hh"
+#include "stb_error.hh"
+#include "stb_generator.hh"
+#include "stb_model.hh"
+
+#include <boost/program_options.hpp>
+#include <SDL2/SDL.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Compares CPU cost of submitting many small meshes: one vao per mesh, one pool with a draw
+ * call per mesh, and one pool with a batched multi-draw, indirect when supported. Draws alternating
+ * between two programs are submitted as issued and through a render queue recorded on all cores.
+ * Meshes laid on a grid are drawn after culling them against a camera, and culling alone is
+ * measured for a larger number of instances.
+ * Runs in a hidden window, for headless Mesa use SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1.
+ */
+
+static const char * vertexShader =
+"#version 150\n \
+in vec3 position;\n \
+void main()\n \
+{\n \
+    gl_Position = vec4(position * 0.01, 1);\n \
+}\n";
+
+static const char * fragmentShader =
+"#version 150\n \
+out vec4 color; \
+void main() \
+{ \
+    color = vec4(1.0); \
+}";
+
+class Parameters
+{
+public:
+    Parameters(void) : numberOfMeshes(5000), numberOfFrames(100), subdivides(1), numberOfCulled(1000000) {}
+
+    U numberOfMeshes;
+    U numberOfFrames;
+    U subdivides;
+    U numberOfCulled;
+};
+
+bool parseParameters(int argc, char * argv[], Parameters & params)
+{
+    namespace po = boost::program_options;
+
+    po::options_description options("Benchmarks draw submission of many meshes");
+
+    options.add_options()
+        ("help", "Show help, this print")
+        ("m", po::value<U>(&params.numberOfMeshes), "Number of meshes")
+        ("f", po::value<U>(&params.numberOfFrames), "Number of frames per path")
+        ("s", po::value<U>(&params.subdivides), "Subdivides of each sphere")
+        ("c", po::value<U>(&params.numberOfCulled), "Number of instances culled without drawing")
+        ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(options).run(), vm);
+        if (vm.count("help")) {
+            std::cout << options << "\n";
+            return false;
+        }
+        po::notify(vm);
+    } catch (std::exception & e) {
+        std::cout << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Runs submit for every frame, printing time spent submitting, time until the GPU is done
+ * and GPU time of the frame when timer queries are supported
+ */
+static void measure(const char * name, const U numberOfFrames, const std::function<void ()> & submit)
+{
+    typedef std::chrono::steady_clock Clock;
+    stb::GpuProfiler profiler;
+    stb::clearError();
+    glFinish();
+    Clock::duration submitting(0);
+    const Clock::time_point start = Clock::now();
+    for (U frame = 0; frame < numberOfFrames; ++frame) {
+        profiler.beginFrame();
+        glClear(GL_COLOR_BUFFER_BIT);
+        const Clock::time_point before = Clock::now();
+        submit();
+        submitting += Clock::now() - before;
+        profiler.endFrame();
+        glFinish();
+    }
+    const Clock::duration total = Clock::now() - start;
+
+    std::cout << name << ": submit "
+        << std::chrono::duration_cast<std::chrono::microseconds>(submitting).count() / numberOfFrames
+        << "us, frame "
+        << std::chrono::duration_cast<std::chrono::microseconds>(total).count() / numberOfFrames << "us";
+    const stb::GpuScopeStatistics * gpu = profiler.statistics("frame");
+    if ((gpu != 0) && (gpu->frames != 0)) {
+        std::cout << ", gpu " << static_cast<U>(gpu->averageMs * 1000.0) << "us";
+    }
+    std::cout << "\n";
+}
+
+/*
+ * GL objects of the benchmark are released here, before the context is
+ */
+static bool compile(stb::Shader & shader)
+{
+    stb::buffer::StaticMemory vs(vertexShader, strlen(vertexShader));
+    stb::buffer::StaticMemory fs(fragmentShader, strlen(fragmentShader));
+    stb::compileShader({stb::ShaderSource(&vs, stb::ShaderType::Vertex),
+                stb::ShaderSource(&fs, stb::ShaderType::Fragment)},
+        shader);
+    if (stb::isError()) {
+        std::cerr << "Compiling shader failed, stb error: " << stb::getErrorDescription() << "\n";
+        return false;
+    }
+    return true;
+}
+
+static void printStateChanges()
+{
+    const stb::glstate::Counters & counters = stb::glstate::counters();
+    std::cout << "  program switches " << counters.issued[stb::glstate::Counter::Program]
+        << ", vao binds " << counters.issued[stb::glstate::Counter::VertexArray] << "\n";
+    stb::glstate::resetCounters();
+}
+
+/*
+ * World matrix of instance i of count on a square grid in xz plane, 4 units apart
+ */
+static glm::mat4 gridTransform(const size_t i, const size_t count)
+{
+    const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    const float half = 2.0f * static_cast<float>(side);
+    return glm::translate(glm::mat4(1.0f),
+        glm::vec3(4.0f * static_cast<float>(i % side) - half, 0.0f, 4.0f * static_cast<float>(i / side) - half));
+}
+
+/*
+ * Camera above the middle of the grid looking along it towards -z, seeing part of it
+ */
+static stb::Frustum gridFrustum(const size_t count)
+{
+    const float side = 4.0f * std::sqrt(static_cast<float>(count));
+    const glm::mat4 projection = glm::perspective<float>(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 0.5f * side);
+    const glm::mat4 view = glm::lookAt<float>(glm::vec3(0.0f, 10.0f, 0.0f),
+                                              glm::vec3(0.0f, 0.0f, -0.25f * side),
+                                              glm::vec3(0.0f, 1.0f, 0.0f));
+    return stb::frustumFromMatrix(glm::value_ptr(projection * view));
+}
+
+/*
+ * Times building the hierarchy of many instances, refitting it after a tenth of them moved and
+ * culling them, without drawing anything
+ */
+static void measureCulling(const U numberOfInstances, const stb::Aabb & bounds)
+{
+    typedef std::chrono::steady_clock Clock;
+    stb::InstanceRegistry registry;
+    for (U i = 0; i < numberOfInstances; ++i) {
+        registry.add(bounds, glm::value_ptr(gridTransform(i, numberOfInstances)));
+    }
+    Clock::time_point before = Clock::now();
+    registry.update();
+    const Clock::duration building = Clock::now() - before;
+
+    const stb::Frustum frustum = gridFrustum(numberOfInstances);
+    std::vector<stb::InstanceRegistry::Instance> visible;
+    Clock::duration refitting(0);
+    Clock::duration culling(0);
+    const U numberOfFrames = 10;
+    for (U frame = 0; frame < numberOfFrames; ++frame) {
+        for (U i = frame; i < numberOfInstances; i += numberOfFrames) {
+            const glm::mat4 transform = glm::translate(gridTransform(i, numberOfInstances),
+                glm::vec3(0.0f, 0.1f * static_cast<float>(frame + 1), 0.0f));
+            registry.move(i, glm::value_ptr(transform));
+        }
+        before = Clock::now();
+        registry.update();
+        refitting += Clock::now() - before;
+        before = Clock::now();
+        registry.cull(frustum, visible);
+        culling += Clock::now() - before;
+    }
+
+    std::cout << "culling " << numberOfInstances << " instances: build "
+        << std::chrono::duration_cast<std::chrono::microseconds>(building).count()
+        << "us, refit of a tenth moved "
+        << std::chrono::duration_cast<std::chrono::microseconds>(refitting).count() / numberOfFrames
+        << "us, cull " << std::chrono::duration_cast<std::chrono::microseconds>(culling).count() / numberOfFrames
+        << "us, visible " << visible.size() << "\n";
+}
+
+static bool runBenchmarks(const Parameters & params)
+{
+    stb::Shader shader;
+    stb::Shader otherShader;
+    if (!compile(shader) || !compile(otherShader)) {
+        return false;
+    }
+    const GL_I layoutPosition = glGetAttribLocation(stb::glRef(shader), "position");
+    const stb::ShaderAttributeLayoutInfo layoutInfo = { layoutPosition, -1, -1 };
+    stb::activateShader(shader);
+
+    const stb::ModelData sphere = stb::generateSphere(params.subdivides);
+    std::vector<stb::VertexArrayObject> vaos(params.numberOfMeshes);
+    stb::GeometryPool pool({ 3, 3, 2 }, layoutInfo);
+    std::vector<stb::PooledMesh> meshes;
+    stb::DrawBatch multiDraw(false);
+    stb::DrawBatch indirectDraw(true);
+    for (U i = 0; i < params.numberOfMeshes; ++i) {
+        stb::initVao(vaos[i], sphere, layoutInfo);
+        meshes.push_back(pool.add(sphere));
+        multiDraw.add(meshes.back());
+        indirectDraw.add(meshes.back());
+    }
+
+    measure("vao per mesh", params.numberOfFrames, [&]() {
+        for (stb::VertexArrayObject & vao : vaos) {
+            stb::bindAndDraw(vao);
+        }
+    });
+    measure("pool, call per mesh", params.numberOfFrames, [&]() {
+        pool.bind();
+        for (const stb::PooledMesh & mesh : meshes) {
+            pool.draw(mesh);
+        }
+    });
+    measure("pool, multi-draw", params.numberOfFrames, [&]() {
+        pool.bind();
+        multiDraw.submit(GL_TRIANGLES, GL_UNSIGNED_INT);
+    });
+    if (indirectDraw.indirect()) {
+        measure("pool, indirect multi-draw", params.numberOfFrames, [&]() {
+            pool.bind();
+            indirectDraw.submit(GL_TRIANGLES, GL_UNSIGNED_INT);
+        });
+    } else {
+        std::cout << "pool, indirect multi-draw: ARB_multi_draw_indirect not supported\n";
+    }
+
+    // Both programs use the same attribute locations, shaders are linked from the same sources
+    const GL_U programs[] = { stb::glRef(shader), stb::glRef(otherShader) };
+    stb::glstate::resetCounters();
+    measure("vao per mesh, two programs as issued", params.numberOfFrames, [&]() {
+        for (size_t i = 0; i < vaos.size(); ++i) {
+            stb::glstate::useProgram(programs[i % 2]);
+            stb::bindAndDraw(vaos[i]);
+        }
+    });
+    printStateChanges();
+
+    const size_t meshesPerTask = 256;
+    const size_t numberOfTasks = (vaos.size() + meshesPerTask - 1) / meshesPerTask;
+    stb::RenderQueue queue(numberOfTasks);
+    measure("vao per mesh, two programs through render queue", params.numberOfFrames, [&]() {
+        queue.clear();
+        stb::parallelFor(numberOfTasks, 0, [&](const size_t task) {
+            stb::RenderCommands & commands = queue.buffer(task);
+            const size_t end = std::min(vaos.size(), (task + 1) * meshesPerTask);
+            for (size_t i = task * meshesPerTask; i < end; ++i) {
+                const GL_U program = programs[i % 2];
+                const U64 key = stb::makeSortKey(0, program, 0, stb::drawInfo(vaos[i]).vao, 0.0f);
+                commands.push_back(stb::makeRenderCommand(key, program, vaos[i]));
+            }
+        });
+        queue.execute();
+    });
+    printStateChanges();
+
+    const stb::Aabb sphereBounds = stb::modelBounds(sphere);
+    stb::InstanceRegistry registry;
+    for (size_t i = 0; i < vaos.size(); ++i) {
+        registry.add(sphereBounds, glm::value_ptr(gridTransform(i, vaos.size())));
+    }
+    const stb::Frustum frustum = gridFrustum(vaos.size());
+    std::vector<stb::InstanceRegistry::Instance> visible;
+    measure("vao per mesh, culled", params.numberOfFrames, [&]() {
+        registry.cull(frustum, visible);
+        for (const stb::InstanceRegistry::Instance instance : visible) {
+            stb::bindAndDraw(vaos[instance]);
+        }
+    });
+    std::cout << "  visible " << visible.size() << " of " << vaos.size() << "\n";
+    measureCulling(params.numberOfCulled, sphereBounds);
+
+    for (stb::VertexArrayObject & vao : vaos) {
+        stb::releaseVao(vao);
+    }
+    stb::releaseShader(shader);
+    stb::releaseShader(otherShader);
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    Parameters params;
+    if (!parseParameters(argc, argv, params)) {
+        return 1;
+    }
+
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_Window * window = SDL_CreateWindow("SToolbox - draw-bench", 0, 0, 64, 64, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+    if (window == 0) {
+        std::cerr << "CreateWindow failed, SDL error: " << SDL_GetError() << "\n";
+        return 1;
+    }
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    if ((context == 0) || !stb::initGl()) {
+        std::cerr << "Creating OpenGL context failed, SDL error: " << SDL_GetError() << "\n";
+        return 1;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << ", meshes: " << params.numberOfMeshes << "\n";
+
+    const bool succeeded = runBenchmarks(params);
+
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return succeeded ? 0 : 1;
+}
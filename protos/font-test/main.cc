@@ -1,6 +1,7 @@
 #define STB_DEFAULT_TIMER_TYPES
 #include "stb_text_hud.hh"
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
 #include "stb_log_boost.hh"
 #include "stb_util.hh"
 #include "stb_game.hh"
@@ -123,11 +124,10 @@ public:
         stb::renderText(m_hud, str.c_str(), str.length(), glm::vec2(.4f, .4f), glm::vec2(.1f, .6f));
         stb::renderText(m_hud, specialChars.c_str(), specialChars.length(), glm::vec2(.1f, .1f), glm::vec2(.3f, .35f));
 
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glUseProgram(0);
+        stb::glstate::bindTexture(GL_TEXTURE_2D, 0);
+        stb::glstate::bindVertexArray(0);
+        stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+        stb::glstate::useProgram(0);
         SDL_GL_SwapWindow(m_window);
     }
 
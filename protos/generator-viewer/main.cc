@@ -1,10 +1,12 @@
 #include "stb_game.hh"
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
 #include "stb_log_boost.hh"
 #include "stb_gl_shader.hh"
 #include "stb_gl_object.hh"
 #include "stb_model.hh"
 #include "stb_generator.hh"
+#include "stb_generator_cache.hh"
 #include "stb_buffer.hh"
 #include "stb_error.hh"
 
@@ -14,6 +16,7 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <algorithm>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -89,6 +92,7 @@ public:
     U w;
     U h;
     float pointSize;
+    std::string cacheDirectory;
 };
 
 struct ShaderVars
@@ -116,6 +120,7 @@ bool parseParameters(int argc, char * argv[], Parameters & params)
     options.add_options()
         ("help", "Show help, this print")
         ("p", po::value<float>(&params.pointSize), "point size")
+        ("cache", po::value<std::string>(&params.cacheDirectory), "directory for keeping generated models between runs")
         //        ("w", po::value<unsigned>(&params.w), "Window width")
         //        ("h", po::value<unsigned>(&params.h), "Window height")
         ;
@@ -186,10 +191,10 @@ bool initShader(stb::Shader & shader, ShaderVars & shaderVars, const Parameters
     const float fovy = glm::radians(50.f);
     const glm::mat4 projectionMatrix = glm::perspective<float>(fovy, static_cast<float>(params.w) / static_cast<float>(params.h), 0.1f, 10.0f);
 
-    glUseProgram(stb::glRef(shader));
+    stb::glstate::useProgram(stb::glRef(shader));
     glUniformMatrix4fv(shaderVars.projection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
     glUniform1f(pointSize, params.pointSize);
-    glUseProgram(0);
+    stb::glstate::useProgram(0);
     return true;
 }
 
@@ -220,6 +225,9 @@ void logModelData(const stb::ModelData & model, stb::Log & log)
 
 }
 
+// Generated models are kept while they fit in this, so stepping back through levels does not generate again
+static const size_t GENERATOR_CACHE_BUDGET = 512 * 1024 * 1024;
+
 class Impl
 {
 public:
@@ -290,13 +298,14 @@ public:
             return false;
         }
 
-        glEnable(GL_PROGRAM_POINT_SIZE);
-        glEnable(GL_CULL_FACE);
+        stb::glstate::enable(GL_PROGRAM_POINT_SIZE);
+        stb::glstate::enable(GL_CULL_FACE);
 
         if (!initShader(m_shader, m_shaderVars, params, m_log)) {
             return false;
         }
 
+        m_generatorCache.reset(new stb::GeneratorCache(GENERATOR_CACHE_BUDGET, params.cacheDirectory, 0));
         return generateModel();
     }
 
@@ -317,17 +326,18 @@ public:
         }
         stb::ShaderAttributeLayoutInfo layoutInfo = { layoutPos, layoutNormal, layoutUv };
 
+        stb::releaseVao(m_vao);
         switch (m_generatedEntity) {
         case 0:
         {
-            stb::ModelData model = stb::generateSphere(m_subdivides);
+            stb::ModelData model = m_generatorCache->get(stb::GeneratedShape::Sphere, m_subdivides);
             logModelData(model, m_log);
             stb::initVao(m_vao, model, layoutInfo);
             break;
         }
         case 1:
         {
-            stb::ModelData model = stb::generateCube(m_subdivides);
+            stb::ModelData model = m_generatorCache->get(stb::GeneratedShape::Cube, m_subdivides);
             logModelData(model, m_log);
             stb::initVao(m_vao, model, layoutInfo);
             break;
@@ -359,7 +369,7 @@ public:
     void setRenderingType()
     {
 
-        glUseProgram(stb::glRef(m_shader));
+        stb::glstate::useProgram(stb::glRef(m_shader));
         switch (m_visualizationType)
         {
         default:
@@ -389,7 +399,7 @@ public:
             glUniform1ui(m_shaderVars.visualizeMappingU, 0);
             glUniform1ui(m_shaderVars.visualizeMappingV, 0);
         }
-        glUseProgram(0);
+        stb::glstate::useProgram(0);
     }
 
     U32 handleInput()
@@ -454,7 +464,7 @@ public:
         glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(stb::glRef(m_shader));
+        stb::glstate::useProgram(stb::glRef(m_shader));
         glm::mat4 viewMatrix(m_viewMatrix);
         viewMatrix = glm::translate(viewMatrix, glm::vec3(0.0f, 0.0f, m_cameraDistance));
 
@@ -475,7 +485,7 @@ public:
             break;
         }
 
-        glUseProgram(0);
+        stb::glstate::useProgram(0);
         SDL_GL_SwapWindow(m_window);
     }
 
@@ -484,6 +494,7 @@ private:
     SDL_Window * m_window = 0;
     stb::Shader m_shader;
     stb::VertexArrayObject m_vao;
+    std::unique_ptr<stb::GeneratorCache> m_generatorCache;
     ShaderVars m_shaderVars;
     RenderType m_renderType;
 
@@ -1,11 +1,15 @@
 #define STB_DEFAULT_TIMER_TYPES
 #include "stb_game.hh"
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
 #include "stb_log_boost.hh"
 #include "stb_gl_shader.hh"
 #include "stb_gl_object.hh"
+#include "stb_gl_uploader.hh"
 #include "stb_model.hh"
 #include "stb_generator.hh"
+#include "stb_obj.hh"
+#include "stb_watch.hh"
 #include "stb_buffer.hh"
 #include "stb_error.hh"
 #include "stb_util.hh"
@@ -17,6 +21,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <memory>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -115,7 +120,7 @@ bool parseParameters(int argc, char * argv[], Parameters & params)
     options.add_options()
         ("help", "Show help, this print")
         ("p", po::value<float>(&params.pointSize), "point size")
-        ("f", po::value<std::string>(&params.pathModelFile)->required(), "Path to model file")
+        ("f", po::value<std::string>(&params.pathModelFile)->required(), "Path to model file (.sm, .obj or .glb)")
         ;
 
     po::variables_map vm;
@@ -180,10 +185,10 @@ bool initShader(stb::Shader & shader, ShaderVars & shaderVars, const Parameters
     const glm::mat4 projectionMatrix =
         glm::perspective<float>(fovy, static_cast<float>(params.w) / static_cast<float>(params.h), 0.1f, 100.0f);
 
-    glUseProgram(stb::glRef(shader));
+    stb::glstate::useProgram(stb::glRef(shader));
     glUniformMatrix4fv(shaderVars.projection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
     glUniform1f(pointSize, params.pointSize);
-    glUseProgram(0);
+    stb::glstate::useProgram(0);
     return true;
 }
 
@@ -241,6 +246,11 @@ public:
 
     ~Impl()
     {
+        // Loader thread releases its context before the contexts are deleted
+        m_uploader.reset();
+        if (m_loaderContext) {
+            SDL_GL_DeleteContext(m_loaderContext);
+        }
         if (m_glContext) {
             SDL_GL_DeleteContext(m_glContext);
         }
@@ -277,6 +287,13 @@ public:
             return false;
         }
 
+        // Models replaced by reloads are uploaded in a context shared with the render context
+        SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+        if ((m_loaderContext = SDL_GL_CreateContext(m_window)) == 0) {
+            LogWarn(m_log) << "Creating loader context failed, models are uploaded while rendering: " << SDL_GetError();
+        }
+        SDL_GL_MakeCurrent(m_window, m_glContext);
+
         if (SDL_SetRelativeMouseMode(SDL_TRUE) != 0) {
             LogWarn(m_log) << "SetRelativeMouseMode failed: " << SDL_GetError();
         }
@@ -286,32 +303,182 @@ public:
             return false;
         }
 
-        glEnable(GL_PROGRAM_POINT_SIZE);
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
+        stb::glstate::enable(GL_PROGRAM_POINT_SIZE);
+        stb::glstate::enable(GL_CULL_FACE);
+        stb::glstate::enable(GL_DEPTH_TEST);
 
         if (!initShader(m_shader, m_shaderVars, params, m_log)) {
             return false;
         }
 
-        return loadModel();
+        if (m_loaderContext) {
+            m_uploader.reset(new stb::AsyncUploader(
+                [this]() { return SDL_GL_MakeCurrent(m_window, m_loaderContext) == 0; },
+                [this]() { SDL_GL_MakeCurrent(m_window, 0); }));
+            if (!m_uploader->ready()) {
+                LogWarn(m_log) << "Loader context could not be made current, models are uploaded while rendering";
+                m_uploader.reset();
+            }
+        }
+
+        if (!loadModel()) {
+            return false;
+        }
+
+        m_watcher.reset(new stb::ModelWatcher(m_pathModelFile, [this](const std::string & /*path*/) -> stb::ModelData {
+            // Error state is shared with render thread, so it is left alone here
+            const stb::ModelData model = readModelFile();
+            if (!model.valid()) {
+                LogWarn(m_log) << "Reloading model failed";
+            }
+            return model;
+        }));
+        if (!m_watcher->ready()) {
+            LogWarn(m_log) << "Watching model file failed, press R to reload";
+        }
+        return true;
     }
 
-    bool loadModel()
+    static bool hasExtension(const std::string & path, const std::string & extension)
     {
+        return (path.size() >= extension.size())
+            && (path.compare(path.size() - extension.size(), extension.size(), extension) == 0);
+    }
+
+    stb::ModelData readModelFile()
+    {
+        if (hasExtension(m_pathModelFile, ".glb")) {
+            // Model references read data directly. File is not mapped, as rewriting it
+            // would change the resident model that reloads are compared against
+            stb::buffer::InputFile f(m_pathModelFile.c_str());
+            if (!f.ready()) {
+                LogWarn(m_log) << "Failed to open model file " << m_pathModelFile;
+                return stb::ModelData();
+            }
+            std::shared_ptr<std::string> data = std::make_shared<std::string>(f.size(), ' ');
+            f.read(&(*data)[0]);
+            return stb::readGlbModel(data->data(), data->size(), data);
+        }
+
+        if (hasExtension(m_pathModelFile, ".obj")) {
+            FILE * stream = fopen(m_pathModelFile.c_str(), "rb");
+            if (stream == 0) {
+                LogWarn(m_log) << "Failed to open model file " << m_pathModelFile;
+                return stb::ModelData();
+            }
+            const stb::ModelData model = stb::readObjModel(stream);
+            fclose(stream);
+            return model;
+        }
+
         stb::buffer::InputFile f(m_pathModelFile.c_str());
         if (!f.ready()) {
-            return false;
+            LogWarn(m_log) << "Failed to open model file " << m_pathModelFile;
+            return stb::ModelData();
         }
         std::string modelData(f.size(), ' ');
         f.read(&modelData[0]);
+        return stb::readModel(modelData.c_str(), modelData.size());
+    }
 
-        stb::ModelData model = stb::readModel(modelData.c_str(), modelData.size());
+    bool loadModel()
+    {
+        stb::ModelData model = readModelFile();
         if (stb::isError()) {
+            LogWarn(m_log) << "Reading model failed, stb error: " << stb::getErrorDescription();
+            stb::clearError();
+            return false;
+        }
+        if (!model.valid()) {
             return false;
         }
         logModelData(model, m_log);
+        return uploadModel(model);
+    }
 
+    bool uploadModel(const stb::ModelData & model)
+    {
+        if (m_uploadTicket != 0) {
+            // Newer model replaces the one still uploading
+            m_discardedTickets.push_back(m_uploadTicket);
+            m_uploadTicket = m_uploader->uploadModel(model);
+            m_uploadingModel.clear();
+            m_uploadingModel.push_back(model);
+            return true;
+        }
+        if (!m_residentModel.empty()) {
+            if (stb::reloadVao(m_vao, m_residentModel[0], model)) {
+                LogInfo(m_log) << "Changed parts of model uploaded";
+                m_residentModel.clear();
+                m_residentModel.push_back(model);
+                return true;
+            }
+            if (m_uploader) {
+                // Current model is drawn until the new one has been uploaded
+                m_uploadTicket = m_uploader->uploadModel(model);
+                m_uploadingModel.clear();
+                m_uploadingModel.push_back(model);
+                return true;
+            }
+            stb::releaseVao(m_vao);
+            m_vao = stb::VertexArrayObject();
+            m_residentModel.clear();
+        }
+
+        stb::ShaderAttributeLayoutInfo layoutInfo;
+        if (!attributeLayout(layoutInfo)) {
+            return false;
+        }
+
+        // Model is reloaded when its file changes, so buffers are kept where updating them is cheap
+        stb::initVao(m_vao, model, layoutInfo,
+                     stb::BufferUsages(model.numberOfAttrBuffers(), stb::BufferUsage::Dynamic), stb::BufferUsage::Dynamic);
+        m_residentModel.push_back(model);
+        return true;
+    }
+
+    void takeUploadedModel()
+    {
+        stb::ShaderAttributeLayoutInfo layoutInfo;
+        if (((m_uploadTicket == 0) && m_discardedTickets.empty()) || !attributeLayout(layoutInfo)) {
+            return;
+        }
+        std::vector<stb::AsyncUploader::Ticket> stillPending;
+        for (const stb::AsyncUploader::Ticket ticket : m_discardedTickets) {
+            stb::VertexArrayObject discarded;
+            const stb::UploadState::Type state = m_uploader->takeModel(ticket, discarded, layoutInfo);
+            if (state == stb::UploadState::Done) {
+                stb::releaseVao(discarded);
+            } else if (state == stb::UploadState::Pending) {
+                stillPending.push_back(ticket);
+            }
+        }
+        m_discardedTickets.swap(stillPending);
+        if (m_uploadTicket == 0) {
+            return;
+        }
+
+        stb::VertexArrayObject vao;
+        switch (m_uploader->takeModel(m_uploadTicket, vao, layoutInfo)) {
+        case stb::UploadState::Pending:
+            return;
+        case stb::UploadState::Done:
+            stb::releaseVao(m_vao);
+            m_vao = vao;
+            m_residentModel.clear();
+            m_residentModel.push_back(m_uploadingModel[0]);
+            LogInfo(m_log) << "Uploaded model taken into use";
+            break;
+        case stb::UploadState::Failed:
+            LogWarn(m_log) << "Uploading model failed";
+            break;
+        }
+        m_uploadTicket = 0;
+        m_uploadingModel.clear();
+    }
+
+    bool attributeLayout(stb::ShaderAttributeLayoutInfo & layoutInfo)
+    {
         GLint layoutPos = -1;
         GLint layoutNormal = -1;
         GLint layoutUv = -1;
@@ -325,9 +492,7 @@ public:
         if ((layoutUv = glGetAttribLocation(stb::glRef(m_shader), "uv")) == -1) {
             LogWarn(m_log) << "Failed to find shader attribute uv";
         }
-
-        stb::ShaderAttributeLayoutInfo layoutInfo = { layoutPos, layoutNormal, layoutUv };
-        stb::initVao(m_vao, model, layoutInfo);
+        layoutInfo = { layoutPos, layoutNormal, layoutUv };
         return true;
     }
 
@@ -352,7 +517,7 @@ public:
     void setRenderingType()
     {
 
-        glUseProgram(stb::glRef(m_shader));
+        stb::glstate::useProgram(stb::glRef(m_shader));
         switch (m_visualizationType)
         {
         default:
@@ -382,7 +547,7 @@ public:
             glUniform1ui(m_shaderVars.visualizeMappingU, 0);
             glUniform1ui(m_shaderVars.visualizeMappingV, 0);
         }
-        glUseProgram(0);
+        stb::glstate::useProgram(0);
     }
 
     U32 handleInput()
@@ -424,7 +589,15 @@ public:
 
     void update(const TimeDurationNano /*elapsed*/)
     {
-
+        std::vector<stb::ModelData> reloaded;
+        if (m_watcher && m_watcher->takeReloaded(reloaded)) {
+            LogInfo(m_log) << "Model file changed, reloading";
+            logModelData(reloaded[0], m_log);
+            uploadModel(reloaded[0]);
+        }
+        if (m_uploader) {
+            takeUploadedModel();
+        }
     }
 
     void render()
@@ -432,7 +605,7 @@ public:
         glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(stb::glRef(m_shader));
+        stb::glstate::useProgram(stb::glRef(m_shader));
         glm::mat4 viewMatrix(m_viewMatrix);
         viewMatrix = glm::translate(viewMatrix, glm::vec3(0.0f, 0.0f, m_cameraDistance));
 
@@ -453,12 +626,13 @@ public:
             break;
         }
 
-        glUseProgram(0);
+        stb::glstate::useProgram(0);
         SDL_GL_SwapWindow(m_window);
     }
 
 private:
     SDL_GLContext m_glContext = 0;
+    SDL_GLContext m_loaderContext = 0;
     SDL_Window * m_window = 0;
     stb::Shader m_shader;
     stb::VertexArrayObject m_vao;
@@ -478,6 +652,16 @@ private:
     std::string m_pathModelFile;
     stb::Log m_log;
 
+    // Model currently in m_vao, at most one (ModelData is not assignable)
+    std::vector<stb::ModelData> m_residentModel;
+    std::unique_ptr<stb::ModelWatcher> m_watcher;
+    std::unique_ptr<stb::AsyncUploader> m_uploader;
+    stb::AsyncUploader::Ticket m_uploadTicket = 0;
+    // Model being uploaded, at most one
+    std::vector<stb::ModelData> m_uploadingModel;
+    // Uploads replaced by newer ones before they finished, released when done
+    std::vector<stb::AsyncUploader::Ticket> m_discardedTickets;
+
     Impl(const Impl & ){}
     Impl operator = (const Impl &){ return *this; }
 };
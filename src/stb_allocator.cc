@@ -0,0 +1,95 @@
+#include "stb_allocator.hh"
+
+#include <cassert>
+#include <iterator>
+
+using namespace stb;
+
+const size_t FreeListAllocator::INVALID_OFFSET;
+
+FreeListAllocator::FreeListAllocator(const size_t capacity)
+: m_capacity(capacity),
+m_freeUnits(0)
+{
+    if (capacity != 0) {
+        insertFree(0, capacity);
+    }
+}
+
+void FreeListAllocator::insertFree(const size_t offset, const size_t size)
+{
+    m_byOffset.insert(std::make_pair(offset, size));
+    m_bySize.insert(std::make_pair(size, offset));
+    m_freeUnits += size;
+}
+
+void FreeListAllocator::eraseFree(const std::map<size_t, size_t>::iterator & range)
+{
+    m_bySize.erase(std::make_pair(range->second, range->first));
+    m_freeUnits -= range->second;
+    m_byOffset.erase(range);
+}
+
+size_t FreeListAllocator::allocate(const size_t size)
+{
+    if (size == 0) {
+        return INVALID_OFFSET;
+    }
+
+    const auto best = m_bySize.lower_bound(std::make_pair(size, static_cast<size_t>(0)));
+    if (best == m_bySize.end()) {
+        return INVALID_OFFSET;
+    }
+
+    const size_t offset = best->second;
+    const size_t rangeSize = best->first;
+    eraseFree(m_byOffset.find(offset));
+    if (rangeSize > size) {
+        insertFree(offset + size, rangeSize - size);
+    }
+    return offset;
+}
+
+void FreeListAllocator::free(const size_t offset, const size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    assert(offset + size <= m_capacity);
+
+    size_t begin = offset;
+    size_t end = offset + size;
+
+    auto next = m_byOffset.lower_bound(offset);
+    assert((next == m_byOffset.end()) || (next->first >= end));
+    if ((next != m_byOffset.end()) && (next->first == end)) {
+        end += next->second;
+        const auto merged = next++;
+        eraseFree(merged);
+    }
+    if (next != m_byOffset.begin()) {
+        const auto previous = std::prev(next);
+        assert(previous->first + previous->second <= begin);
+        if (previous->first + previous->second == begin) {
+            begin = previous->first;
+            eraseFree(previous);
+        }
+    }
+    insertFree(begin, end - begin);
+}
+
+void FreeListAllocator::grow(const size_t capacity)
+{
+    if (capacity <= m_capacity) {
+        return;
+    }
+    const size_t added = capacity - m_capacity;
+    const size_t offset = m_capacity;
+    m_capacity = capacity;
+    free(offset, added);
+}
+
+size_t FreeListAllocator::largestFreeRange() const
+{
+    return m_bySize.empty() ? 0 : m_bySize.rbegin()->first;
+}
@@ -3,6 +3,13 @@
 #include <fstream>
 #include <cstring>
 
+#if defined(STB_LINUX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace stb;
 
 namespace stb { namespace buffer
@@ -86,5 +93,70 @@ void StaticMemory::read(char * output) const
     memcpy(output, m_data, m_size);
 }
 
+/******************* MappedFile *******************/
+
+#if defined(STB_LINUX)
+MappedFile::MappedFile(const char * pathToFile)
+: m_data(0),
+m_size(0),
+m_ok(false)
+{
+    const int fd = open(pathToFile, O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        m_size = static_cast<size_t>(info.st_size);
+        if (m_size == 0) {
+            m_ok = true;
+        } else {
+            void * p = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char *>(p);
+                m_ok = true;
+            } else {
+                m_size = 0;
+            }
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != 0) {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+}
+#else
+MappedFile::MappedFile(const char * pathToFile)
+: m_data(0),
+m_size(0),
+m_ok(false)
+{
+    InputFile file(pathToFile);
+    if (file.ready()) {
+        m_storage.assign(file.size(), ' ');
+        if (!m_storage.empty()) {
+            file.read(&m_storage[0]);
+        }
+        m_data = m_storage.data();
+        m_size = m_storage.size();
+        m_ok = true;
+    }
+}
+
+MappedFile::~MappedFile()
+{}
+#endif
+
+void MappedFile::read(char * output) const
+{
+    memcpy(output, m_data, m_size);
+}
+
 }
 }
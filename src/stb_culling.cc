@@ -0,0 +1,596 @@
+#include "stb_culling.hh"
+
+#include "stb_model.hh"
+#include "stb_simd.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+using namespace stb;
+
+static const U32 EMPTY = 0xffffffff;
+static const U32 LEAF_BIT = 0x80000000;
+static const U32 LOOSE_BIT = 0x80000000;
+static const U32 ALL_PLANES = 0x3f;
+static const size_t INSTANCES_PER_LEAF = 8;
+// Instances tested one by one before the hierarchy is rebuilt, in addition to a share of those in it
+static const size_t MIN_LOOSE_INSTANCES = 64;
+static const size_t LOOSE_SHARE = 32;
+// Hierarchy is rebuilt when a quarter of it is removed or its leaves have grown to twice their area
+static const size_t REMOVED_SHARE = 4;
+static const double LEAF_AREA_GROWTH = 2.0;
+static const size_t DIRTY_SHARE = 16;
+
+stb::Aabb::Aabb()
+{
+    min[0] = min[1] = min[2] = FLT_MAX;
+    max[0] = max[1] = max[2] = -FLT_MAX;
+}
+
+stb::Aabb::Aabb(const float minX, const float minY, const float minZ,
+                const float maxX, const float maxY, const float maxZ)
+{
+    min[0] = minX;
+    min[1] = minY;
+    min[2] = minZ;
+    max[0] = maxX;
+    max[1] = maxY;
+    max[2] = maxZ;
+}
+
+bool stb::Aabb::empty() const
+{
+    return (min[0] > max[0]) || (min[1] > max[1]) || (min[2] > max[2]);
+}
+
+void stb::Aabb::extend(const float x, const float y, const float z)
+{
+    min[0] = std::min(min[0], x);
+    min[1] = std::min(min[1], y);
+    min[2] = std::min(min[2], z);
+    max[0] = std::max(max[0], x);
+    max[1] = std::max(max[1], y);
+    max[2] = std::max(max[2], z);
+}
+
+Aabb stb::modelBounds(const ModelData & model)
+{
+    Aabb bounds;
+    if ((model.numberOfAttrBuffers() == 0) || (model.numberOfAttrInBuffer(0) == 0)
+        || (model.attrBufferDataType(0) != ModelData::FLOAT) || (model.valuesPerAttribute(0, 0) < 3)
+        || (model.attrBufferSizeOfElement(0) == 0) || ((model.attrBufferSizeOfElement(0) % sizeof(float)) != 0)) {
+        stb::setError("%s: Model has no float positions", __FUNCTION__);
+        return bounds;
+    }
+
+    const float * positions = reinterpret_cast<const float *>(model.attrBuffer(0) + model.pointerToDataInBuffer(0, 0));
+    const size_t floatsPerElement = model.attrBufferSizeOfElement(0) / sizeof(float);
+    const size_t numberOfElements = model.attrBufferSize(0) / model.attrBufferSizeOfElement(0);
+    for (size_t i = 0; i < numberOfElements; ++i) {
+        const float * position = positions + i * floatsPerElement;
+        bounds.extend(position[0], position[1], position[2]);
+    }
+    return bounds;
+}
+
+Aabb stb::transformBounds(const Aabb & bounds, const float * matrix)
+{
+    if (bounds.empty()) {
+        return bounds;
+    }
+
+    // Center is transformed as a point, half extents by absolute values of the rotation and scale
+    Aabb transformed;
+    for (int row = 0; row < 3; ++row) {
+        float center = matrix[12 + row];
+        float extent = 0.0f;
+        for (int column = 0; column < 3; ++column) {
+            const float value = matrix[column * 4 + row];
+            center += value * 0.5f * (bounds.min[column] + bounds.max[column]);
+            extent += std::fabs(value) * 0.5f * (bounds.max[column] - bounds.min[column]);
+        }
+        transformed.min[row] = center - extent;
+        transformed.max[row] = center + extent;
+    }
+    return transformed;
+}
+
+Frustum stb::frustumFromMatrix(const float * viewProjection)
+{
+    // Clip space x, y and z are within -w and w, planes are the fourth row plus or minus the others
+    const float * m = viewProjection;
+    Frustum frustum;
+    for (int plane = 0; plane < 6; ++plane) {
+        const int row = plane / 2;
+        const float sign = ((plane % 2) == 0) ? 1.0f : -1.0f;
+        for (int column = 0; column < 4; ++column) {
+            frustum.planes[plane][column] = m[column * 4 + 3] + sign * m[column * 4 + row];
+        }
+        const float * p = frustum.planes[plane];
+        const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (length > 0.0f) {
+            for (int column = 0; column < 4; ++column) {
+                frustum.planes[plane][column] /= length;
+            }
+        }
+    }
+    return frustum;
+}
+
+bool stb::visible(const Frustum & frustum, const Aabb & bounds)
+{
+    if (bounds.empty()) {
+        return false;
+    }
+    for (int plane = 0; plane < 6; ++plane) {
+        const float * p = frustum.planes[plane];
+        float distance = p[3];
+        float radius = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            distance += p[axis] * 0.5f * (bounds.min[axis] + bounds.max[axis]);
+            radius += std::fabs(p[axis]) * 0.5f * (bounds.max[axis] - bounds.min[axis]);
+        }
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace
+{
+
+template <typename Boxes>
+void setLane(Boxes & boxes, const U32 lane, const Aabb & bounds)
+{
+    // Empty box is outside of every plane and leaves the union of lanes empty
+    const bool empty = bounds.empty();
+    for (int axis = 0; axis < 3; ++axis) {
+        boxes.center[axis][lane] = empty ? 0.0f : 0.5f * (bounds.min[axis] + bounds.max[axis]);
+        boxes.extent[axis][lane] = empty ? -FLT_MAX : 0.5f * (bounds.max[axis] - bounds.min[axis]);
+    }
+}
+
+template <typename Boxes>
+Aabb laneBounds(const Boxes & boxes, const U32 lane)
+{
+    Aabb bounds;
+    if (boxes.extent[0][lane] >= 0.0f) {
+        for (int axis = 0; axis < 3; ++axis) {
+            bounds.min[axis] = boxes.center[axis][lane] - boxes.extent[axis][lane];
+            bounds.max[axis] = boxes.center[axis][lane] + boxes.extent[axis][lane];
+        }
+    }
+    return bounds;
+}
+
+template <typename Boxes>
+void extendByLanes(Aabb & bounds, const Boxes & boxes)
+{
+    for (U32 lane = 0; lane < 4; ++lane) {
+        if (boxes.extent[0][lane] < 0.0f) {
+            continue;
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            bounds.min[axis] = std::min(bounds.min[axis], boxes.center[axis][lane] - boxes.extent[axis][lane]);
+            bounds.max[axis] = std::max(bounds.max[axis], boxes.center[axis][lane] + boxes.extent[axis][lane]);
+        }
+    }
+}
+
+template <typename Boxes>
+void clearLanes(Boxes & boxes)
+{
+    for (U32 lane = 0; lane < 4; ++lane) {
+        setLane(boxes, lane, Aabb());
+    }
+}
+
+double surfaceArea(const Aabb & bounds)
+{
+    if (bounds.empty()) {
+        return 0.0;
+    }
+    const double x = bounds.max[0] - bounds.min[0];
+    const double y = bounds.max[1] - bounds.min[1];
+    const double z = bounds.max[2] - bounds.min[2];
+    return 2.0 * (x * y + y * z + z * x);
+}
+
+/*
+ * Tests four boxes against the planes in mask. Returns lanes outside of a plane, and for
+ * each plane the lanes crossing it in crossing, so that children test only those planes.
+ */
+template <typename Boxes>
+int testLanes(const Frustum & frustum, const U32 planes, const Boxes & boxes, int * crossing)
+{
+    const simd::Float4 zero = simd::set1(0.0f);
+    const simd::Float4 cx = simd::load(boxes.center[0]);
+    const simd::Float4 cy = simd::load(boxes.center[1]);
+    const simd::Float4 cz = simd::load(boxes.center[2]);
+    const simd::Float4 ex = simd::load(boxes.extent[0]);
+    const simd::Float4 ey = simd::load(boxes.extent[1]);
+    const simd::Float4 ez = simd::load(boxes.extent[2]);
+
+    int outside = 0;
+    for (U32 plane = 0; plane < 6; ++plane) {
+        crossing[plane] = 0;
+        if ((planes & (1u << plane)) == 0) {
+            continue;
+        }
+        const float * p = frustum.planes[plane];
+        const simd::Float4 distance = simd::add(
+            simd::add(simd::mul(cx, simd::set1(p[0])), simd::mul(cy, simd::set1(p[1]))),
+            simd::add(simd::mul(cz, simd::set1(p[2])), simd::set1(p[3])));
+        const simd::Float4 radius = simd::add(
+            simd::add(simd::mul(ex, simd::set1(std::fabs(p[0]))), simd::mul(ey, simd::set1(std::fabs(p[1])))),
+            simd::mul(ez, simd::set1(std::fabs(p[2]))));
+        outside |= simd::lessMask(simd::add(distance, radius), zero);
+        crossing[plane] = simd::lessMask(simd::sub(distance, radius), zero);
+        if (outside == 0xf) {
+            break;
+        }
+    }
+    return outside;
+}
+
+U32 planesOfLane(const int * crossing, const U32 lane)
+{
+    U32 planes = 0;
+    for (U32 plane = 0; plane < 6; ++plane) {
+        planes |= ((crossing[plane] >> lane) & 1) << plane;
+    }
+    return planes;
+}
+
+}
+
+InstanceRegistry::InstanceRegistry()
+: m_numberOfInstances(0),
+m_instancesInTree(0),
+m_removedFromTree(0),
+m_builtLeafArea(0.0),
+m_leafArea(0.0),
+m_numberOfRebuilds(0)
+{}
+
+InstanceRegistry::Instance InstanceRegistry::add(const Aabb & localBounds, const float * transform)
+{
+    Instance instance = 0;
+    if (!m_free.empty()) {
+        instance = m_free.back();
+        m_free.pop_back();
+    } else {
+        instance = static_cast<Instance>(m_instances.size());
+        m_instances.push_back(Record());
+    }
+
+    Record & record = m_instances[instance];
+    record.local = localBounds;
+    record.world = transformBounds(localBounds, transform);
+    record.place = LOOSE_BIT | static_cast<U32>(m_loose.size());
+    record.alive = true;
+    m_loose.push_back(instance);
+    ++m_numberOfInstances;
+    return instance;
+}
+
+void InstanceRegistry::move(const Instance instance, const float * transform)
+{
+    if (!contains(instance)) {
+        stb::setError("%s: Unknown instance %u", __FUNCTION__, instance);
+        return;
+    }
+    Record & record = m_instances[instance];
+    record.world = transformBounds(record.local, transform);
+    if ((record.place & LOOSE_BIT) == 0) {
+        setPacketLane(record.place, instance);
+        markDirty(record.place);
+    }
+}
+
+void InstanceRegistry::remove(const Instance instance)
+{
+    if (!contains(instance)) {
+        stb::setError("%s: Unknown instance %u", __FUNCTION__, instance);
+        return;
+    }
+    Record & record = m_instances[instance];
+    if ((record.place & LOOSE_BIT) != 0) {
+        const U32 index = record.place & ~LOOSE_BIT;
+        m_loose[index] = m_loose.back();
+        m_instances[m_loose[index]].place = LOOSE_BIT | index;
+        m_loose.pop_back();
+    } else {
+        setPacketLane(record.place, EMPTY);
+        markDirty(record.place);
+        ++m_removedFromTree;
+    }
+    record.alive = false;
+    m_free.push_back(instance);
+    --m_numberOfInstances;
+}
+
+bool InstanceRegistry::contains(const Instance instance) const
+{
+    return (instance < m_instances.size()) && m_instances[instance].alive;
+}
+
+void InstanceRegistry::setPacketLane(const U32 place, const Instance instance)
+{
+    Packet & packet = m_packets[place / 4];
+    packet.instances[place % 4] = instance;
+    setLane(packet.boxes, place % 4, (instance != EMPTY) ? m_instances[instance].world : Aabb());
+}
+
+void InstanceRegistry::markDirty(const U32 place)
+{
+    Leaf & leaf = m_leaves[m_packets[place / 4].leaf];
+    if (!leaf.dirty) {
+        leaf.dirty = true;
+        m_dirtyLeaves.push_back(m_packets[place / 4].leaf);
+    }
+}
+
+void InstanceRegistry::update()
+{
+    if (!m_dirtyLeaves.empty()) {
+        refit();
+    }
+    if ((m_loose.size() > MIN_LOOSE_INSTANCES + m_instancesInTree / LOOSE_SHARE)
+        || (m_removedFromTree > m_instancesInTree / REMOVED_SHARE)
+        || (m_leafArea > LEAF_AREA_GROWTH * m_builtLeafArea)) {
+        rebuild();
+    }
+}
+
+void InstanceRegistry::refit()
+{
+    // Many dirty leaves are visited in memory order instead of the order they were moved in
+    if (m_dirtyLeaves.size() > m_leaves.size() / DIRTY_SHARE) {
+        m_dirtyLeaves.clear();
+        for (size_t index = 0; index < m_leaves.size(); ++index) {
+            if (m_leaves[index].dirty) {
+                m_dirtyLeaves.push_back(static_cast<U32>(index));
+            }
+        }
+    }
+
+    for (const U32 index : m_dirtyLeaves) {
+        Leaf & leaf = m_leaves[index];
+        leaf.dirty = false;
+        Aabb bounds;
+        for (U32 packet = leaf.firstPacket; packet < leaf.firstPacket + leaf.numberOfPackets; ++packet) {
+            extendByLanes(bounds, m_packets[packet].boxes);
+        }
+        Node & parent = m_nodes[leaf.node];
+        m_leafArea += surfaceArea(bounds) - surfaceArea(laneBounds(parent.boxes, leaf.lane));
+        setLane(parent.boxes, leaf.lane, bounds);
+        m_dirtyNodes[leaf.node] = 1;
+    }
+    m_dirtyLeaves.clear();
+
+    // Nodes are stored parents first, so going backwards visits children before their parents
+    for (size_t index = m_nodes.size() - 1; index > 0; --index) {
+        if (m_dirtyNodes[index] == 0) {
+            continue;
+        }
+        m_dirtyNodes[index] = 0;
+        const Node & node = m_nodes[index];
+        Aabb bounds;
+        extendByLanes(bounds, node.boxes);
+        setLane(m_nodes[node.parent].boxes, node.lane, bounds);
+        m_dirtyNodes[node.parent] = 1;
+    }
+    m_dirtyNodes[0] = 0;
+}
+
+void InstanceRegistry::rebuild()
+{
+    std::vector<BuildItem> items;
+    items.reserve(m_numberOfInstances);
+    for (size_t i = 0; i < m_instances.size(); ++i) {
+        if (m_instances[i].alive) {
+            const Aabb & world = m_instances[i].world;
+            BuildItem item;
+            for (int axis = 0; axis < 3; ++axis) {
+                item.center[axis] = world.empty() ? 0.0f : 0.5f * (world.min[axis] + world.max[axis]);
+            }
+            item.instance = static_cast<Instance>(i);
+            items.push_back(item);
+        }
+    }
+
+    m_loose.clear();
+    m_packets.clear();
+    m_leaves.clear();
+    m_nodes.clear();
+    m_dirtyLeaves.clear();
+    m_instancesInTree = items.size();
+    m_removedFromTree = 0;
+    m_leafArea = 0.0;
+    if (!items.empty()) {
+        buildNode(items, 0, items.size(), EMPTY, 0);
+    }
+    m_dirtyNodes.assign(m_nodes.size(), 0);
+    m_builtLeafArea = m_leafArea;
+    ++m_numberOfRebuilds;
+}
+
+U32 InstanceRegistry::buildNode(std::vector<BuildItem> & items, const size_t begin, const size_t end,
+                                const U32 parent, const U32 lane)
+{
+    const U32 index = static_cast<U32>(m_nodes.size());
+    m_nodes.push_back(Node());
+    clearLanes(m_nodes[index].boxes);
+    std::fill(m_nodes[index].children, m_nodes[index].children + 4, EMPTY);
+    m_nodes[index].parent = parent;
+    m_nodes[index].lane = lane;
+
+    // Largest part is halved at the median of centers along their widest axis until there are four
+    size_t parts[5] = { begin, end, end, end, end };
+    size_t numberOfParts = 1;
+    while (numberOfParts < 4) {
+        size_t largest = 0;
+        for (size_t part = 1; part < numberOfParts; ++part) {
+            if (parts[part + 1] - parts[part] > parts[largest + 1] - parts[largest]) {
+                largest = part;
+            }
+        }
+        const size_t first = parts[largest];
+        const size_t last = parts[largest + 1];
+        if (last - first <= INSTANCES_PER_LEAF) {
+            break;
+        }
+
+        Aabb centers;
+        for (size_t i = first; i < last; ++i) {
+            centers.extend(items[i].center[0], items[i].center[1], items[i].center[2]);
+        }
+        int axis = 0;
+        for (int a = 1; a < 3; ++a) {
+            if (centers.max[a] - centers.min[a] > centers.max[axis] - centers.min[axis]) {
+                axis = a;
+            }
+        }
+        const size_t middle = first + (last - first) / 2;
+        std::nth_element(items.begin() + first, items.begin() + middle, items.begin() + last,
+            [axis](const BuildItem & a, const BuildItem & b) { return a.center[axis] < b.center[axis]; });
+
+        for (size_t part = numberOfParts; part > largest; --part) {
+            parts[part + 1] = parts[part];
+        }
+        parts[largest + 1] = middle;
+        ++numberOfParts;
+    }
+
+    for (size_t part = 0; part < numberOfParts; ++part) {
+        const U32 child = (parts[part + 1] - parts[part] <= INSTANCES_PER_LEAF)
+            ? (LEAF_BIT | buildLeaf(items, parts[part], parts[part + 1], index, static_cast<U32>(part)))
+            : buildNode(items, parts[part], parts[part + 1], index, static_cast<U32>(part));
+        m_nodes[index].children[part] = child;
+    }
+
+    if (parent != EMPTY) {
+        Aabb bounds;
+        extendByLanes(bounds, m_nodes[index].boxes);
+        setLane(m_nodes[parent].boxes, lane, bounds);
+    }
+    return index;
+}
+
+U32 InstanceRegistry::buildLeaf(const std::vector<BuildItem> & items, const size_t begin, const size_t end,
+                                const U32 parent, const U32 lane)
+{
+    const U32 index = static_cast<U32>(m_leaves.size());
+    Leaf leaf;
+    leaf.firstPacket = static_cast<U32>(m_packets.size());
+    leaf.numberOfPackets = static_cast<U32>((end - begin + 3) / 4);
+    leaf.node = parent;
+    leaf.lane = lane;
+    leaf.dirty = false;
+    m_leaves.push_back(leaf);
+
+    Aabb bounds;
+    for (U32 p = 0; p < leaf.numberOfPackets; ++p) {
+        m_packets.push_back(Packet());
+        Packet & packet = m_packets.back();
+        packet.leaf = index;
+        clearLanes(packet.boxes);
+        for (U32 l = 0; l < 4; ++l) {
+            const size_t i = begin + p * 4 + l;
+            const U32 place = (leaf.firstPacket + p) * 4 + l;
+            if (i < end) {
+                m_instances[items[i].instance].place = place;
+                setPacketLane(place, items[i].instance);
+            } else {
+                packet.instances[l] = EMPTY;
+            }
+        }
+        extendByLanes(bounds, packet.boxes);
+    }
+
+    setLane(m_nodes[parent].boxes, lane, bounds);
+    m_leafArea += surfaceArea(bounds);
+    return index;
+}
+
+void InstanceRegistry::cull(const Frustum & frustum, std::vector<Instance> & visible)
+{
+    update();
+    visible.clear();
+    if (!m_nodes.empty()) {
+        cullNode(frustum, 0, ALL_PLANES, visible);
+    }
+    for (const Instance instance : m_loose) {
+        if (stb::visible(frustum, m_instances[instance].world)) {
+            visible.push_back(instance);
+        }
+    }
+}
+
+void InstanceRegistry::cullNode(const Frustum & frustum, const U32 node, const U32 planes,
+                                std::vector<Instance> & visible) const
+{
+    const Node & n = m_nodes[node];
+    int crossing[6];
+    const int outside = testLanes(frustum, planes, n.boxes, crossing);
+    for (U32 lane = 0; lane < 4; ++lane) {
+        const U32 child = n.children[lane];
+        if ((child == EMPTY) || ((outside & (1 << lane)) != 0)) {
+            continue;
+        }
+        // Children inside of every plane are visible without testing them
+        const U32 childPlanes = planesOfLane(crossing, lane);
+        if (childPlanes == 0) {
+            addSubtree(child, visible);
+        } else if ((child & LEAF_BIT) != 0) {
+            cullLeaf(frustum, child & ~LEAF_BIT, childPlanes, visible);
+        } else {
+            cullNode(frustum, child, childPlanes, visible);
+        }
+    }
+}
+
+void InstanceRegistry::cullLeaf(const Frustum & frustum, const U32 leaf, const U32 planes,
+                                std::vector<Instance> & visible) const
+{
+    const Leaf & l = m_leaves[leaf];
+    int crossing[6];
+    for (U32 p = l.firstPacket; p < l.firstPacket + l.numberOfPackets; ++p) {
+        const Packet & packet = m_packets[p];
+        const int outside = testLanes(frustum, planes, packet.boxes, crossing);
+        for (U32 lane = 0; lane < 4; ++lane) {
+            if ((packet.instances[lane] != EMPTY) && ((outside & (1 << lane)) == 0)) {
+                visible.push_back(packet.instances[lane]);
+            }
+        }
+    }
+}
+
+void InstanceRegistry::addSubtree(const U32 child, std::vector<Instance> & visible) const
+{
+    if ((child & LEAF_BIT) != 0) {
+        const Leaf & leaf = m_leaves[child & ~LEAF_BIT];
+        for (U32 p = leaf.firstPacket; p < leaf.firstPacket + leaf.numberOfPackets; ++p) {
+            // Empty lanes and instances with empty bounds have negative extents
+            for (U32 lane = 0; lane < 4; ++lane) {
+                if (m_packets[p].boxes.extent[0][lane] >= 0.0f) {
+                    visible.push_back(m_packets[p].instances[lane]);
+                }
+            }
+        }
+        return;
+    }
+    for (U32 lane = 0; lane < 4; ++lane) {
+        if (m_nodes[child].children[lane] != EMPTY) {
+            addSubtree(m_nodes[child].children[lane], visible);
+        }
+    }
+}
@@ -1,9 +1,16 @@
 #include "stb_generator.hh"
 
+#include "stb_baked.hh"
+
 #include "stb_model.hh"
 #include "stb_math.hh"
+#include "stb_parallel.hh"
 #include <cassert>
 #include <algorithm>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -39,27 +46,6 @@ struct Attribute
         u(uv.s), v(uv.t)
     {}
 
-    bool operator == (const Attribute & other) const
-    {
-        // This is safe only for objects in scale of unit cube,
-        // so do not copy this comparison
-        const float diff = 0.00001f;
-        if (
-            (std::abs(other.vertexX - vertexX) < diff)
-            && (std::abs(other.vertexY - vertexY) < diff)
-            && (std::abs(other.vertexZ - vertexZ) < diff)
-            && (std::abs(other.normalX - normalX) < diff)
-            && (std::abs(other.normalY - normalY) < diff)
-            && (std::abs(other.normalZ - normalZ) < diff)
-            && (std::abs(other.u - u) < diff)
-            && (std::abs(other.v - v) < diff)
-            )
-        {
-            return true;
-        }
-        return false;
-    }
-
     Vertex getVertex() const { return Vertex(vertexX, vertexY, vertexZ); }
     Normal getNormal() const { return Normal(normalX, normalY, normalZ); }
     void setVertex(const Vertex & v){ vertexX = v.x; vertexY = v.y; vertexZ = v.z; }
@@ -81,390 +67,337 @@ static void discreteInterpolate1(const float start, const float end, const U sub
     result = start + (((end - start) / static_cast<float>(subdivides + 1)) * static_cast<float>(step));
 }
 
-static void insertVertex(AttributeContainer & attributeContainer, IndiceContainter & indiceContainer,
-    const Attribute & attribute)
+/*
+ * Wraps containers into model without copying them
+ */
+static stb::ModelData wrapIntoModel(AttributeContainer && attributes, IndiceContainter && indices)
 {
-    size_t index = attributeContainer.size();
-    attributeContainer.push_back(attribute);
-    indiceContainer.push_back(index);
-}
+    const std::shared_ptr<const AttributeContainer> attributeOwner
+        = std::make_shared<const AttributeContainer>(std::move(attributes));
+    const std::shared_ptr<const IndiceContainter> indiceOwner
+        = std::make_shared<const IndiceContainter>(std::move(indices));
 
-static void reuseVertex(IndiceContainter & indiceContainer, const U32 reusedIndiceIndex)
-{
-    indiceContainer.push_back(indiceContainer[reusedIndiceIndex]);
-}
+    stb::ModelData::AttributeData * element = new stb::ModelData::AttributeData(
+        attributeOwner,
+        (const char *)attributeOwner->data(),
+        Attribute::elementSizeInBytes() * attributeOwner->size(),
+        { 3, 3, 2 },
+        Attribute::elementSizeInBytes(),
+        stb::ModelData::FLOAT
+        );
 
-static void mergeAndWeldEqualVertices(AttributeContainer & targetAttributes, IndiceContainter & targetIndices,
-    const AttributeContainer & sourceAttributes, const IndiceContainter & sourceIndices)
-{
-    for (U i = 0; i < sourceIndices.size(); ++i) {
-        const Attribute & attribute = sourceAttributes[sourceIndices[i]];
-        AttributeContainer::const_iterator it = std::find(targetAttributes.begin(), targetAttributes.end(), attribute);
-        if (it != targetAttributes.end()) {
-            const size_t existingIndex = std::distance(AttributeContainer::const_iterator(targetAttributes.begin()), it);
-            targetIndices.push_back(existingIndex);
-        } else {
-            targetIndices.push_back(targetAttributes.size());
-            targetAttributes.push_back(attribute);
-        }
-    }
+    return stb::ModelData(
+        { stb::ModelData::AttributeElement(element) },
+        indiceOwner,
+        (const char *)indiceOwner->data(),
+        sizeof(IndiceContainter::value_type) * indiceOwner->size(),
+        sizeof(IndiceContainter::value_type),
+        stb::ModelData::TRIANGLE
+    );
 }
 
-void generateAttributesFor2dPlane(
-    const float x0, const float y0,
-    const float x1, const float y1,
-    const Uv & startUv, const Uv & endUv,
-    const U subdivides,
-    const U currentSquareRow,
-    const U currentSquareColumn,
-    const U tringleIndex,
-    const U tringlePointIndex,
-    float & resultX,
-    float & resultY,
-    float & resultU,
-    float & resultV)
+using stb::baked::detail::CubeFace;
+using stb::baked::detail::cubeFaces;
+using stb::baked::detail::NUMBER_OF_CUBE_FACES;
+
+// Rows of squares generated by one task when cube is generated in parallel
+static const U CUBE_ROWS_PER_TASK = 64;
+
+/*
+ * Writes rows [firstRow, lastRow) of squares of a face with the vertex rows on top of them,
+ * the task writing the last row of squares writes the bottom row of vertices too.
+ * Whole face has (subdivides + 2)^2 vertices and 6 * (subdivides + 1)^2 indices,
+ * texture of each face takes one sixth of u and whole v.
+ */
+static void generateCubeFace(const U faceIndex, const U subdivides, const U firstRow, const U lastRow,
+    const U32 firstVertex, Attribute * attributes, U32 * indices)
 {
-    U verticeRow = 0;
-    U verticeColumn = 0;
-
-    if (tringleIndex % 2 == 0) {
-        //Left side triangle
-        if (tringlePointIndex == 0) {
-            verticeRow = currentSquareRow;
-            verticeColumn = currentSquareColumn;
-        } else if (tringlePointIndex == 1) {
-            verticeRow = currentSquareRow + 1;
-            verticeColumn = currentSquareColumn;
-        } else if (tringlePointIndex == 2) {
-            verticeRow = currentSquareRow;
-            verticeColumn = currentSquareColumn + 1;
-        } else {
-            assert(!"Invalid triangle index");
+    const CubeFace & face = cubeFaces[faceIndex];
+    const U verticesPerRow = subdivides + 2;
+    const U lastVertexRow = (lastRow == subdivides + 1) ? verticesPerRow : lastRow;
+    const float uvStep = 1.0f / 6.0f;
+    const float u0 = static_cast<float>(faceIndex) * uvStep;
+    const float u1 = static_cast<float>(faceIndex + 1) * uvStep;
+
+    for (U row = firstRow; row < lastVertexRow; ++row) {
+        for (U column = 0; column < verticesPerRow; ++column) {
+            Attribute & attribute = attributes[row * verticesPerRow + column];
+            float vertex[3];
+            vertex[face.constantAxis] = face.constant;
+            discreteInterpolate1(face.column0, face.column1, subdivides, column, vertex[face.columnAxis]);
+            discreteInterpolate1(face.row0, face.row1, subdivides, row, vertex[face.rowAxis]);
+            attribute.setVertex(Vertex(vertex[0], vertex[1], vertex[2]));
+            attribute.setNormal(Normal(face.normal[0], face.normal[1], face.normal[2]));
+            discreteInterpolate1(u0, u1, subdivides, column, attribute.u);
+            discreteInterpolate1(0.0f, 1.0f, subdivides, row, attribute.v);
         }
+    }
 
-    } else {
-        //Right side triangle
-        if (tringlePointIndex == 0) {
-            verticeRow = currentSquareRow;
-            verticeColumn = currentSquareColumn + 1;
-        } else if (tringlePointIndex == 1) {
-            verticeRow = currentSquareRow + 1;
-            verticeColumn = currentSquareColumn;
-        } else if (tringlePointIndex == 2) {
-            verticeRow = currentSquareRow + 1;
-            verticeColumn = currentSquareColumn + 1;
-        } else {
-            assert(!"Invalid triangle index");
+    indices += 6 * (subdivides + 1) * firstRow;
+    for (U row = firstRow; row < lastRow; ++row) {
+        for (U column = 0; column <= subdivides; ++column) {
+            const U32 topLeft = firstVertex + row * verticesPerRow + column;
+            const U32 bottomLeft = topLeft + verticesPerRow;
+            *indices++ = topLeft;
+            *indices++ = bottomLeft;
+            *indices++ = topLeft + 1;
+            *indices++ = topLeft + 1;
+            *indices++ = bottomLeft;
+            *indices++ = bottomLeft + 1;
         }
     }
+}
 
-    discreteInterpolate1(x0, x1, subdivides, verticeColumn, resultX);
-    discreteInterpolate1(y0, y1, subdivides, verticeRow, resultY);
+stb::GeneratedSize stb::queryCubeSize(const U subdivides)
+{
+    const GeneratedSize size = {
+        NUMBER_OF_CUBE_FACES * (size_t)(subdivides + 2) * (subdivides + 2),
+        NUMBER_OF_CUBE_FACES * (size_t)6 * (subdivides + 1) * (subdivides + 1)
+    };
+    return size;
+}
 
-    discreteInterpolate1(startUv.s, endUv.s, subdivides, verticeColumn, resultU);
-    discreteInterpolate1(startUv.t, endUv.t, subdivides, verticeRow, resultV);
+void stb::generateCubeInto(const U subdivides, float * attributeOut, U32 * indexOut, const U32 baseVertex,
+    const U numberOfThreads)
+{
+    const size_t verticesPerFace = queryCubeSize(subdivides).numberOfElements / NUMBER_OF_CUBE_FACES;
+    const size_t indicesPerFace = queryCubeSize(subdivides).numberOfIndices / NUMBER_OF_CUBE_FACES;
+    const U rowsPerFace = subdivides + 1;
+    const U tasksPerFace = (rowsPerFace + CUBE_ROWS_PER_TASK - 1) / CUBE_ROWS_PER_TASK;
+    Attribute * attributes = reinterpret_cast<Attribute *>(attributeOut);
+
+    // Every task writes its own rows, so output does not depend on number of threads
+    stb::parallelFor(NUMBER_OF_CUBE_FACES * tasksPerFace, numberOfThreads, [&](const size_t task) {
+        const U f = static_cast<U>(task / tasksPerFace);
+        const U firstRow = static_cast<U>(task % tasksPerFace) * CUBE_ROWS_PER_TASK;
+        const U lastRow = std::min(firstRow + CUBE_ROWS_PER_TASK, rowsPerFace);
+        generateCubeFace(f, subdivides, firstRow, lastRow, baseVertex + f * verticesPerFace,
+            attributes + f * verticesPerFace, indexOut + f * indicesPerFace);
+    });
 }
 
-static void generatePlaneVertices(
-    const U32 squaresPerface,
-    const U32 squaresPerRow,
-    const U32 subdivides,
-    const float x0, const float x1, const float y0, const float y1,
-    const Uv & startUv, const Uv & endUv,
-    AttributeContainer & attributeContainer, IndiceContainter & indiceContainer,
-
-    Attribute & v0, Attribute & v1, Attribute & v2, Attribute & v3,
-
-    float & v0d0, float & v0d1,
-    float & v1d0, float & v1d1,
-    float & v2d0, float & v2d1,
-    float & v3d0, float & v3d1
-    )
+stb::ModelData stb::generateCube(const U subdivides, const U numberOfThreads)
 {
-    for (U s = 0; s < squaresPerface; ++s) {
-
-        const U currentSquareRow = s / squaresPerRow;
-        const U currentSquareColumn = s % squaresPerRow;
-
-        if (currentSquareColumn == 0) {
-            generateAttributesFor2dPlane(x0, y0, x1, y1, startUv, endUv, subdivides, currentSquareRow, currentSquareColumn, 0, 0, v0d0, v0d1, v0.u, v0.v);
-            generateAttributesFor2dPlane(x0, y0, x1, y1, startUv, endUv, subdivides, currentSquareRow, currentSquareColumn, 0, 1, v1d0, v1d1, v1.u, v1.v);
-            generateAttributesFor2dPlane(x0, y0, x1, y1, startUv, endUv, subdivides, currentSquareRow, currentSquareColumn, 0, 2, v2d0, v2d1, v2.u, v2.v);
-            generateAttributesFor2dPlane(x0, y0, x1, y1, startUv, endUv, subdivides, currentSquareRow, currentSquareColumn, 1, 2, v3d0, v3d1, v3.u, v3.v);
-
-            insertVertex(attributeContainer, indiceContainer, v0);
-            insertVertex(attributeContainer, indiceContainer, v1);
-            insertVertex(attributeContainer, indiceContainer, v2);
-            reuseVertex(indiceContainer, indiceContainer.size() - 1);
-            reuseVertex(indiceContainer, indiceContainer.size() - 3);
-            insertVertex(attributeContainer, indiceContainer, v3);
-        } else {
-            const U startOfPreviousSquare = indiceContainer.size() - 6;
-            generateAttributesFor2dPlane(x0, y0, x1, y1, startUv, endUv, subdivides, currentSquareRow, currentSquareColumn, 0, 2, v1d0, v1d1, v1.u, v1.v);
-            generateAttributesFor2dPlane(x0, y0, x1, y1, startUv, endUv, subdivides, currentSquareRow, currentSquareColumn, 1, 2, v3d0, v3d1, v3.u, v3.v);
-            reuseVertex(indiceContainer, startOfPreviousSquare + 2);
-            reuseVertex(indiceContainer, startOfPreviousSquare + 5);
-            insertVertex(attributeContainer, indiceContainer, v1);
-            reuseVertex(indiceContainer, indiceContainer.size() - 1);
-            reuseVertex(indiceContainer, indiceContainer.size() - 3);
-            insertVertex(attributeContainer, indiceContainer, v3);
-        }
-    }
+    const GeneratedSize size = queryCubeSize(subdivides);
+    AttributeContainer attributeContainer(size.numberOfElements);
+    IndiceContainter indiceContainer(size.numberOfIndices);
+
+    generateCubeInto(subdivides, reinterpret_cast<float *>(&attributeContainer[0]), &indiceContainer[0], 0,
+        numberOfThreads);
+
+    return wrapIntoModel(std::move(attributeContainer), std::move(indiceContainer));
 }
 
-stb::ModelData stb::generateCube(const U subdivides)
+static Uv calculateUvCoordinate(const Vertex & vertex, const float radius)
 {
-    const U numberOfBaseVertices = 8;
-    const float baseVertices[numberOfBaseVertices][3] = {
-        //Top
-        { -0.5, 0.5, 0.5 },
-        { 0.5, 0.5, 0.5 },
-        { 0.5, 0.5, -0.5 },
-        { -0.5, 0.5, -0.5 },
-        //Bottom
-        { -0.5, -0.5, 0.5 },
-        { 0.5, -0.5, 0.5 },
-        { 0.5, -0.5, -0.5 },
-        { -0.5, -0.5, -0.5 }
-    };
+    const float pi = 3.14159265359f;
+    const float v = (radius + vertex.y);
 
-    const U squaresPerface = (U)std::pow(1 + subdivides, 2);
-    const U triangles = squaresPerface * 2 * 6;
-    const U vertices = triangles * 3;
-    const U verticesPerFace = squaresPerface * 2 * 3;
-
-    AttributeContainer vertexContainer(vertices);
-    IndiceContainter indiceContainer(vertices, 0);
-    const U squaresPerRow = subdivides + 1;
-
-    Normal normal(0.0f, 0.0f, 1.0f);
-    Vertex vertex(0.0f, 0.0f, 0.5f);
-    Attribute v0(vertex, normal);
-    Attribute v1(vertex, normal);
-    Attribute v2(vertex, normal);
-    Attribute v3(vertex, normal);
-    const float uvStep = 1.0f / 6.0f;
+    float u = glm::angle(glm::vec2(0.0f, 1.0f), glm::normalize(glm::vec2(vertex.x, vertex.z)));
+    assert(!isnan(u));
+    if (vertex[0] < 0.0)
+        u = pi + (pi - u);
 
-    vertexContainer.clear();
-    indiceContainer.clear();
-
-    generatePlaneVertices(
-        squaresPerface,
-        squaresPerRow,
-        subdivides,
-        baseVertices[0][0], baseVertices[1][0],
-        baseVertices[0][1], baseVertices[4][1],
-        Uv(0.0f * uvStep, 0.0f), Uv(1.0f * uvStep, 1.0),
-        vertexContainer, indiceContainer,
-        v0, v1, v2, v3,
-        v0.vertexX, v0.vertexY,
-        v1.vertexX, v1.vertexY,
-        v2.vertexX, v2.vertexY,
-        v3.vertexX, v3.vertexY
-        );
+    return Uv(u / (pi * 2), v);
+}
 
-    normal = Normal(1.0f, 0.0f, 0.0f);
-    vertex = Vertex(0.5f, 0.0f, 0.0f);
-    v0.setNormal(normal); v1.setNormal(normal); v2.setNormal(normal); v3.setNormal(normal);
-    v0.setVertex(vertex); v1.setVertex(vertex); v2.setVertex(vertex); v3.setVertex(vertex);
-
-    generatePlaneVertices(
-        squaresPerface,
-        squaresPerRow,
-        subdivides,
-        baseVertices[1][2], baseVertices[2][2],
-        baseVertices[1][1], baseVertices[5][1],
-        Uv(1.0f * uvStep, 0.0f), Uv(2.0f * uvStep, 1.0),
-        vertexContainer, indiceContainer,
-        v0, v1, v2, v3,
-        v0.vertexZ, v0.vertexY,
-        v1.vertexZ, v1.vertexY,
-        v2.vertexZ, v2.vertexY,
-        v3.vertexZ, v3.vertexY
-        );
+/*
+ * Vertex of a sphere under construction, position is kept so that output needs not to be read
+ */
+struct SphereVertex
+{
+    U32 index;
+    Vertex vertex;
+};
 
-    normal = Normal(0.0f, 0.0f, -1.0f);
-    vertex = Vertex(0.5f, 0.0f, -0.5f);
-    v0.setNormal(normal); v1.setNormal(normal); v2.setNormal(normal); v3.setNormal(normal);
-    v0.setVertex(vertex); v1.setVertex(vertex); v2.setVertex(vertex); v3.setVertex(vertex);
-
-    generatePlaneVertices(
-        squaresPerface,
-        squaresPerRow,
-        subdivides,
-        baseVertices[2][0], baseVertices[3][0],
-        baseVertices[2][1], baseVertices[6][1],
-        Uv(2.0f * uvStep, 0.0f), Uv(3.0f * uvStep, 1.0),
-        vertexContainer, indiceContainer,
-        v0, v1, v2, v3,
-        v0.vertexX, v0.vertexY,
-        v1.vertexX, v1.vertexY,
-        v2.vertexX, v2.vertexY,
-        v3.vertexX, v3.vertexY
-        );
+/*
+ * Vertex inside one octant of the sphere, left and right are weights of the bottom corners
+ * of the octant and top takes the rest of 1 << subdivides
+ */
+struct OctantVertex
+{
+    SphereVertex sphere;
+    U32 left;
+    U32 right;
+};
 
+static const U NUMBER_OF_SPHERE_EDGES = 12;
+static const U NUMBER_OF_SPHERE_OCTANTS = 8;
 
-    AttributeContainer planeAttributeContainer(verticesPerFace);
-    IndiceContainter planeIndiceContainer(verticesPerFace);
+// Edges of octahedron between base vertices, vertices along each are shared by two octants
+static const U sphereEdges[NUMBER_OF_SPHERE_EDGES][2] = {
+    { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 },
+    { 5, 1 }, { 5, 2 }, { 5, 3 }, { 5, 4 },
+    { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 1 }
+};
 
-    {
-        planeAttributeContainer.clear();
-        planeIndiceContainer.clear();
-
-        normal = Normal(-1.0f, 0.0f, 0.0f);
-        vertex = Vertex(-0.5f, 0.0f, 0.0f);
-        v0.setNormal(normal); v1.setNormal(normal); v2.setNormal(normal); v3.setNormal(normal);
-        v0.setVertex(vertex); v1.setVertex(vertex); v2.setVertex(vertex); v3.setVertex(vertex);
-
-        generatePlaneVertices(
-            squaresPerface,
-            squaresPerRow,
-            subdivides,
-            baseVertices[3][2], baseVertices[0][2],
-            baseVertices[3][1], baseVertices[7][1],
-            Uv(3.0f * uvStep, 0.0f), Uv(4.0f * uvStep, 1.0),
-            planeAttributeContainer, planeIndiceContainer,
-            v0, v1, v2, v3,
-            v0.vertexZ, v0.vertexY,
-            v1.vertexZ, v1.vertexY,
-            v2.vertexZ, v2.vertexY,
-            v3.vertexZ, v3.vertexY
-            );
-
-        mergeAndWeldEqualVertices(vertexContainer, indiceContainer, planeAttributeContainer, planeIndiceContainer);
+// Top, bottom left and bottom right base vertex of each octant
+static const U sphereOctants[NUMBER_OF_SPHERE_OCTANTS][3] = {
+    { 0, 1, 2 }, { 0, 2, 3 }, { 0, 3, 4 }, { 0, 4, 1 }, // Top hemisphere
+    { 5, 1, 2 }, { 5, 2, 3 }, { 5, 3, 4 }, { 5, 4, 1 } // Bottom hemisphere
+};
+
+static SphereVertex sphereMidpoint(const SphereVertex & a, const SphereVertex & b, const U32 index,
+    Attribute * attributes, const float radius)
+{
+    const Vertex v = glm::normalize((a.vertex + b.vertex) / 2.0f);
+    attributes[index] = Attribute(radius * v, v, calculateUvCoordinate(v, radius));
+    const SphereVertex added = { index, attributes[index].getVertex() };
+    return added;
+}
+
+/*
+ * Fills edge[first + 1, last) by halving the edge like triangles are subdivided,
+ * vertex at slot i of the edge gets index firstIndex + i - 1
+ */
+static void bisectSphereEdge(SphereVertex * edge, const U32 first, const U32 last, const U32 firstIndex,
+    Attribute * attributes, const float radius)
+{
+    if ((last - first) < 2) {
+        return;
     }
+    const U32 middle = (first + last) / 2;
+    edge[middle] = sphereMidpoint(edge[first], edge[last], firstIndex + middle - 1, attributes, radius);
+    bisectSphereEdge(edge, first, middle, firstIndex, attributes, radius);
+    bisectSphereEdge(edge, middle, last, firstIndex, attributes, radius);
+}
+
+/*
+ * Edge of an octant as a view to shared edge vertices, which may run in the opposite direction
+ */
+struct OctantEdge
+{
+    const SphereVertex * vertices;
+    U32 size;
+    bool reversed;
 
+    const SphereVertex & at(const U32 slot) const { return vertices[reversed ? (size - slot) : slot]; }
+};
+
+/*
+ * Builds one octant of sphere by subdividing its triangle recursively. Vertices on the edges
+ * of the octant come from shared edges, and vertex at the middle of an inner edge is created
+ * once and looked up by its position afterwards. Octants write to disjoint ranges of output,
+ * so they can be built in parallel.
+ */
+class OctantBuilder
+{
+public:
+    OctantBuilder(const U subdivides, const float radius, const OctantEdge (&edges)[3], const U32 firstVertex,
+        Attribute * attributes, U32 * indices, const U32 baseVertex)
+    : m_size((U32)1 << subdivides),
+    m_radius(radius),
+    m_edges(edges),
+    m_nextVertex(firstVertex),
+    m_attributes(attributes),
+    m_indices(indices),
+    m_baseVertex(baseVertex)
     {
-        planeAttributeContainer.clear();
-        planeIndiceContainer.clear();
-
-        normal = Normal(0.0f, -1.0f, 0.0f);
-        vertex = Vertex(0.0f, -0.5f, 0.0f);
-        v0.setNormal(normal); v1.setNormal(normal); v2.setNormal(normal); v3.setNormal(normal);
-        v0.setVertex(vertex); v1.setVertex(vertex); v2.setVertex(vertex); v3.setVertex(vertex);
-
-        generatePlaneVertices(
-            squaresPerface,
-            squaresPerRow,
-            subdivides,
-            baseVertices[7][2], baseVertices[4][2],
-            baseVertices[4][0], baseVertices[5][0],
-            Uv(4.0f * uvStep, 0.0f), Uv(5.0f * uvStep, 1.0),
-            planeAttributeContainer, planeIndiceContainer,
-            v0, v1, v2, v3,
-            v0.vertexZ, v0.vertexX,
-            v1.vertexZ, v1.vertexX,
-            v2.vertexZ, v2.vertexX,
-            v3.vertexZ, v3.vertexX
-            );
-
-        mergeAndWeldEqualVertices(vertexContainer, indiceContainer, planeAttributeContainer, planeIndiceContainer);
+        // Midpoints are dropped once both triangles of an edge are done, which in depth first
+        // order leaves about the edges along the border of the current path in the cache
+        m_midpoints.reserve(2 * ((size_t)1 << subdivides) + 8);
     }
 
+    OctantVertex vertexAt(const U32 left, const U32 right) const
     {
-        planeAttributeContainer.clear();
-        planeIndiceContainer.clear();
-
-        normal = Normal(0.0f, 1.0f, 0.0f);
-        vertex = Vertex(0.0f, 0.5f, 0.0f);
-        v0.setNormal(normal); v1.setNormal(normal); v2.setNormal(normal); v3.setNormal(normal);
-        v0.setVertex(vertex); v1.setVertex(vertex); v2.setVertex(vertex); v3.setVertex(vertex);
-
-        generatePlaneVertices(
-            squaresPerface,
-            squaresPerRow,
-            subdivides,
-            baseVertices[0][2], baseVertices[3][2],
-            baseVertices[0][0], baseVertices[1][0],
-            Uv(5.0f * uvStep, 0.0f), Uv(6.0f * uvStep, 1.0),
-            planeAttributeContainer, planeIndiceContainer,
-            v0, v1, v2, v3,
-            v0.vertexZ, v0.vertexX,
-            v1.vertexZ, v1.vertexX,
-            v2.vertexZ, v2.vertexX,
-            v3.vertexZ, v3.vertexX
-            );
-
-        mergeAndWeldEqualVertices(vertexContainer, indiceContainer, planeAttributeContainer, planeIndiceContainer);
+        const U32 top = m_size - left - right;
+        const OctantVertex found = {
+            (right == 0) ? m_edges[0].at(left) : ((top == 0) ? m_edges[1].at(right) : m_edges[2].at(right)),
+            left,
+            right
+        };
+        return found;
     }
 
-    stb::ModelData::AttributeData * element = new stb::ModelData::AttributeData(
-        (const char *)&vertexContainer[0],
-        Attribute::elementSizeInBytes() * vertexContainer.size(),
-        { 3, 3, 2 },
-        sizeof(float) * 8,
-        stb::ModelData::FLOAT
-        );
+    void generateTriangle(const OctantVertex & top, const OctantVertex & bottomLeft, const OctantVertex & bottomRight,
+        const U subdivides, const bool direction)
+    {
+        if (subdivides == 0) {
+            if (direction) {
+                *m_indices++ = m_baseVertex + top.sphere.index;
+                *m_indices++ = m_baseVertex + bottomLeft.sphere.index;
+                *m_indices++ = m_baseVertex + bottomRight.sphere.index;
+            } else {
+                *m_indices++ = m_baseVertex + bottomRight.sphere.index;
+                *m_indices++ = m_baseVertex + bottomLeft.sphere.index;
+                *m_indices++ = m_baseVertex + top.sphere.index;
+            }
+            return;
+        }
 
-    return stb::ModelData(
-        { stb::ModelData::AttributeElement(element) },
-        (const char *)&indiceContainer[0],
-        sizeof(IndiceContainter::value_type) * indiceContainer.size(),
-        sizeof(indiceContainer[0]),
-        stb::ModelData::TRIANGLE
-    );
-}
+        const OctantVertex v0 = midpoint(top, bottomLeft);
+        const OctantVertex v1 = midpoint(top, bottomRight);
+        const OctantVertex v2 = midpoint(bottomRight, bottomLeft);
 
-void insertAttributeToContainerCheckIfExists(AttributeContainer & attributeContainer,
-    IndiceContainter & indiceContainer, const Attribute & attribute)
-{
-    AttributeContainer::const_iterator it = std::find(attributeContainer.begin(), attributeContainer.end(), attribute);
-    if (it != attributeContainer.end()) {
-        const size_t existingIndex = std::distance(AttributeContainer::const_iterator(attributeContainer.begin()), it);
-        indiceContainer.push_back(existingIndex);
-    } else {
-        indiceContainer.push_back(attributeContainer.size());
-        attributeContainer.push_back(attribute);
+        generateTriangle(top, v0, v1, subdivides - 1, direction);
+        generateTriangle(v0, bottomLeft, v2, subdivides - 1, direction);
+        generateTriangle(v1, v2, bottomRight, subdivides - 1, direction);
+        generateTriangle(v0, v2, v1, subdivides - 1, direction);
     }
-}
 
-static Uv calculateUvCoordinate(const Vertex & vertex, const float radius)
-{
-    const float pi = 3.14159265359f;
-    const float v = (radius + vertex.y);
+private:
+    OctantVertex midpoint(const OctantVertex & a, const OctantVertex & b)
+    {
+        const U32 left = (a.left + b.left) / 2;
+        const U32 right = (a.right + b.right) / 2;
+        if ((left == 0) || (right == 0) || (left + right == m_size)) {
+            return vertexAt(left, right);
+        }
 
-    float u = glm::angle(glm::vec2(0.0f, 1.0f), glm::normalize(glm::vec2(vertex.x, vertex.z)));
-    assert(!isnan(u));
-    if (vertex[0] < 0.0)
-        u = pi + (pi - u);
+        const U64 key = ((U64)left << 32) | right;
+        const auto found = m_midpoints.find(key);
+        if (found != m_midpoints.end()) {
+            // Inner edge is shared by two triangles only, so it will not be needed again
+            const OctantVertex existing = found->second;
+            m_midpoints.erase(found);
+            return existing;
+        }
 
-    return Uv(u / (pi * 2), v);
-}
+        const OctantVertex added = {
+            sphereMidpoint(a.sphere, b.sphere, m_nextVertex++, m_attributes, m_radius),
+            left,
+            right
+        };
+        m_midpoints.insert(std::make_pair(key, added));
+        return added;
+    }
 
-void generateTriangleOnSphere(
-    const Attribute & top, const Attribute & bottomLeft, const Attribute & bottomRight,
-    const U subdivides,
-    AttributeContainer & attributeContainer, IndiceContainter & indiceContainer, bool direction,
-    const float radius
-    )
+    const U32 m_size;
+    const float m_radius;
+    const OctantEdge (&m_edges)[3];
+    U32 m_nextVertex;
+    Attribute * m_attributes;
+    U32 * m_indices;
+    const U32 m_baseVertex;
+    std::unordered_map<U64, OctantVertex> m_midpoints;
+};
+
+static OctantEdge findOctantEdge(const std::vector<SphereVertex> & edgeVertices, const U from, const U to)
 {
-    if (subdivides == 0) {
-        if (direction) {
-            insertAttributeToContainerCheckIfExists(attributeContainer, indiceContainer, top);
-            insertAttributeToContainerCheckIfExists(attributeContainer, indiceContainer, bottomLeft);
-            insertAttributeToContainerCheckIfExists(attributeContainer, indiceContainer, bottomRight);
-        } else {
-            insertAttributeToContainerCheckIfExists(attributeContainer, indiceContainer, bottomRight);
-            insertAttributeToContainerCheckIfExists(attributeContainer, indiceContainer, bottomLeft);
-            insertAttributeToContainerCheckIfExists(attributeContainer, indiceContainer, top);
+    const U32 size = static_cast<U32>(edgeVertices.size() / NUMBER_OF_SPHERE_EDGES - 1);
+    for (U e = 0; e < NUMBER_OF_SPHERE_EDGES; ++e) {
+        if (((sphereEdges[e][0] == from) && (sphereEdges[e][1] == to)) || ((sphereEdges[e][0] == to) && (sphereEdges[e][1] == from))) {
+            const OctantEdge edge = { &edgeVertices[e * (size + 1)], size, sphereEdges[e][0] != from };
+            return edge;
         }
-        return ;
     }
+    assert(false);
+    return OctantEdge();
+}
 
-    const Vertex v0 = glm::normalize((top.getVertex() + bottomLeft.getVertex()) / 2.0f);
-    const Vertex v1 = glm::normalize((top.getVertex() + bottomRight.getVertex()) / 2.0f);
-    const Vertex v2 = glm::normalize((bottomRight.getVertex() + bottomLeft.getVertex()) / 2.0f);
-    const Attribute a0(radius * v0, v0, calculateUvCoordinate(v0, radius));
-    const Attribute a1(radius * v1, v1, calculateUvCoordinate(v1, radius));
-    const Attribute a2(radius * v2, v2, calculateUvCoordinate(v2, radius));
-
-    generateTriangleOnSphere(top, a0, a1, subdivides - 1, attributeContainer, indiceContainer, direction, radius);
-    generateTriangleOnSphere(a0, bottomLeft, a2, subdivides - 1, attributeContainer, indiceContainer, direction, radius);
-    generateTriangleOnSphere(a1, a2, bottomRight, subdivides - 1, attributeContainer, indiceContainer, direction, radius);
-    generateTriangleOnSphere(a0, a2, a1, subdivides - 1, attributeContainer, indiceContainer, direction, radius);
+stb::GeneratedSize stb::querySphereSize(const U subdivides)
+{
+    // Each subdivide splits a triangle into four, octahedron has 8 triangles and 6 vertices
+    const size_t trianglesPerBaseTriangle = (size_t)1 << (2 * subdivides);
+    const GeneratedSize size = {
+        4 * trianglesPerBaseTriangle + 2,
+        8 * 3 * trianglesPerBaseTriangle
+    };
+    return size;
 }
 
-stb::ModelData stb::generateSphere(const U subdivides, const float radius)
+void stb::generateSphereInto(const U subdivides, const float radius, float * attributeOut, U32 * indexOut,
+    const U32 baseVertex, const U numberOfThreads)
 {
     const U numberOfBaseVertices = 6;
     const Attribute baseVertices[numberOfBaseVertices] = {
@@ -476,76 +409,51 @@ stb::ModelData stb::generateSphere(const U subdivides, const float radius)
         Attribute(Vertex(0.0f, -radius, 0.0f), Normal(0.0f, -1.0f, 0.0f), Uv(0.0f, 0.0f)) // Bottom
     };
 
-    const U numberOfVertice = 4098; // Number of vertices for 4 subdivides
-    AttributeContainer attributeContainer(numberOfVertice);
-    IndiceContainter indiceContainer(numberOfVertice);
-
-    attributeContainer.clear();
-    indiceContainer.clear();
-
-    //Top hemisphere
-    generateTriangleOnSphere(
-        baseVertices[0], baseVertices[1], baseVertices[2],
-        subdivides,
-        attributeContainer, indiceContainer, false, radius
-        );
-
-    generateTriangleOnSphere(
-        baseVertices[0], baseVertices[2], baseVertices[3],
-        subdivides,
-        attributeContainer, indiceContainer, false, radius
-        );
-
-    generateTriangleOnSphere(
-        baseVertices[0], baseVertices[3], baseVertices[4],
-        subdivides,
-        attributeContainer, indiceContainer, false, radius
-        );
-
-    generateTriangleOnSphere(
-        baseVertices[0], baseVertices[4], baseVertices[1],
-        subdivides,
-        attributeContainer, indiceContainer, false, radius
-        );
-
-    //Bottom hemisphere
-    generateTriangleOnSphere(
-        baseVertices[5], baseVertices[1], baseVertices[2],
-        subdivides,
-        attributeContainer, indiceContainer, true, radius
-        );
+    // Output is laid out as base vertices, vertices inside each edge and vertices inside each octant,
+    // so that every vertex has a fixed place whichever thread creates it
+    const U32 edgeSize = (U32)1 << subdivides;
+    const U32 verticesInsideEdge = edgeSize - 1;
+    const U32 verticesInsideOctant = (edgeSize < 2) ? 0 : ((edgeSize - 1) * (edgeSize - 2) / 2);
+    const U32 firstOctantVertex = numberOfBaseVertices + NUMBER_OF_SPHERE_EDGES * verticesInsideEdge;
+    const size_t indicesPerOctant = (size_t)3 * edgeSize * edgeSize;
+    Attribute * attributes = reinterpret_cast<Attribute *>(attributeOut);
+
+    for (U i = 0; i < numberOfBaseVertices; ++i) {
+        attributes[i] = baseVertices[i];
+    }
 
-    generateTriangleOnSphere(
-        baseVertices[5], baseVertices[2], baseVertices[3],
-        subdivides,
-        attributeContainer, indiceContainer, true, radius
-        );
+    std::vector<SphereVertex> edgeVertices(NUMBER_OF_SPHERE_EDGES * (edgeSize + 1));
+    for (U e = 0; e < NUMBER_OF_SPHERE_EDGES; ++e) {
+        SphereVertex * edge = &edgeVertices[e * (edgeSize + 1)];
+        const SphereVertex first = { sphereEdges[e][0], baseVertices[sphereEdges[e][0]].getVertex() };
+        const SphereVertex last = { sphereEdges[e][1], baseVertices[sphereEdges[e][1]].getVertex() };
+        edge[0] = first;
+        edge[edgeSize] = last;
+        bisectSphereEdge(edge, 0, edgeSize, numberOfBaseVertices + e * verticesInsideEdge, attributes, radius);
+    }
 
-    generateTriangleOnSphere(
-        baseVertices[5], baseVertices[3], baseVertices[4],
-        subdivides,
-        attributeContainer, indiceContainer, true, radius
-        );
+    stb::parallelFor(NUMBER_OF_SPHERE_OCTANTS, numberOfThreads, [&](const size_t o) {
+        const U * corners = sphereOctants[o];
+        const OctantEdge edges[3] = {
+            findOctantEdge(edgeVertices, corners[0], corners[1]),
+            findOctantEdge(edgeVertices, corners[1], corners[2]),
+            findOctantEdge(edgeVertices, corners[0], corners[2])
+        };
+        OctantBuilder builder(subdivides, radius, edges, firstOctantVertex + static_cast<U32>(o) * verticesInsideOctant,
+            attributes, indexOut + o * indicesPerOctant, baseVertex);
+        builder.generateTriangle(builder.vertexAt(0, 0), builder.vertexAt(edgeSize, 0), builder.vertexAt(0, edgeSize),
+            subdivides, o >= (NUMBER_OF_SPHERE_OCTANTS / 2));
+    });
+}
 
-    generateTriangleOnSphere(
-        baseVertices[5], baseVertices[4], baseVertices[1],
-        subdivides,
-        attributeContainer, indiceContainer, true, radius
-        );
+stb::ModelData stb::generateSphere(const U subdivides, const float radius, const U numberOfThreads)
+{
+    const GeneratedSize size = querySphereSize(subdivides);
+    AttributeContainer attributeContainer(size.numberOfElements);
+    IndiceContainter indiceContainer(size.numberOfIndices);
 
-    stb::ModelData::AttributeData * element = new stb::ModelData::AttributeData(
-        (const char *)&attributeContainer[0],
-        Attribute::elementSizeInBytes() * attributeContainer.size(),
-        { 3, 3, 2 },
-        Attribute::elementSizeInBytes(),
-        stb::ModelData::FLOAT
-        );
+    generateSphereInto(subdivides, radius, reinterpret_cast<float *>(&attributeContainer[0]), &indiceContainer[0], 0,
+        numberOfThreads);
 
-    return stb::ModelData(
-    { stb::ModelData::AttributeElement(element) },
-    (const char *)&indiceContainer[0],
-    sizeof(IndiceContainter::value_type) * indiceContainer.size(),
-    sizeof(indiceContainer[0]),
-    stb::ModelData::TRIANGLE
-    );
+    return wrapIntoModel(std::move(attributeContainer), std::move(indiceContainer));
 }
@@ -0,0 +1,107 @@
+#include "stb_generator_cache.hh"
+
+#include "stb_buffer.hh"
+#include "stb_generator.hh"
+#include "stb_util.hh"
+
+#include <cstring>
+
+using namespace stb;
+
+static size_t sizeOfModel(const ModelData & model)
+{
+    size_t size = model.indicesDataSize();
+    for (size_t i = 0; i < model.numberOfAttrBuffers(); ++i) {
+        size += model.attrBufferSize(i);
+    }
+    return size;
+}
+
+bool GeneratorCache::Key::operator < (const Key & other) const
+{
+    if (shape != other.shape) {
+        return shape < other.shape;
+    }
+    if (subdivides != other.subdivides) {
+        return subdivides < other.subdivides;
+    }
+    return radiusBits < other.radiusBits;
+}
+
+GeneratorCache::GeneratorCache(const size_t budgetInBytes, const std::string & directory, const U numberOfThreads)
+: m_budgetInBytes(budgetInBytes),
+m_directory(directory),
+m_numberOfThreads(numberOfThreads),
+m_sizeInBytes(0)
+{}
+
+void GeneratorCache::clear()
+{
+    m_index.clear();
+    m_models.clear();
+    m_sizeInBytes = 0;
+}
+
+std::string GeneratorCache::pathOf(const Key & key) const
+{
+    // Radius is named by its bits, so that every float has a distinct and exact name
+    char name[64];
+    stb_snprintf(name, sizeof(name), "%s-%u-%08x.sm",
+        (key.shape == GeneratedShape::Cube) ? "cube" : "sphere", key.subdivides, key.radiusBits);
+    return m_directory + "/" + name;
+}
+
+ModelData GeneratorCache::load(const Key & key, const float radius) const
+{
+    if (!m_directory.empty()) {
+        const std::string path = pathOf(key);
+        const buffer::MappedFile file(path.c_str());
+        if (file.ready()) {
+            const ModelData model = readModel(file.data(), file.size());
+            if (model.valid()) {
+                return model;
+            }
+        }
+    }
+
+    const ModelData model = (key.shape == GeneratedShape::Cube)
+        ? generateCube(key.subdivides, m_numberOfThreads)
+        : generateSphere(key.subdivides, radius, m_numberOfThreads);
+
+    if (!m_directory.empty()) {
+        writeModel(model, pathOf(key).c_str());
+    }
+    return model;
+}
+
+ModelData GeneratorCache::get(const GeneratedShape shape, const U subdivides, const float radius)
+{
+    Key key = { shape, subdivides, 0 };
+    if (shape == GeneratedShape::Sphere) {
+        memcpy(&key.radiusBits, &radius, sizeof(radius));
+    }
+
+    const auto found = m_index.find(key);
+    if (found != m_index.end()) {
+        m_models.splice(m_models.begin(), m_models, found->second);
+        return found->second->model;
+    }
+
+    const ModelData model = load(key, radius);
+    const size_t size = sizeOfModel(model);
+    if (!model.valid() || (size > m_budgetInBytes)) {
+        return model;
+    }
+
+    while ((m_sizeInBytes + size) > m_budgetInBytes) {
+        m_sizeInBytes -= m_models.back().size;
+        m_index.erase(m_models.back().key);
+        m_models.pop_back();
+    }
+
+    const Entry entry = { key, model, size };
+    m_models.push_front(entry);
+    m_index.insert(std::make_pair(key, m_models.begin()));
+    m_sizeInBytes += size;
+    return model;
+}
@@ -0,0 +1,85 @@
+#include "stb_gl_batch.hh"
+
+#include "stb_gl.hh"
+#include "stb_gl_state.hh"
+#include "stb_gl_pool.hh"
+
+using namespace stb;
+
+DrawBatch::DrawBatch(const bool allowIndirect)
+: m_indirect(allowIndirect && ogl_ext_ARB_draw_indirect && ogl_ext_ARB_multi_draw_indirect),
+m_changed(false),
+m_offsetsIndiceType(0),
+m_indirectBuffer(0)
+{
+    if (m_indirect) {
+        glGenBuffers(1, &m_indirectBuffer);
+    }
+}
+
+DrawBatch::~DrawBatch()
+{
+    if (m_indirectBuffer != 0) {
+        glstate::deleteBuffers(1, &m_indirectBuffer);
+    }
+}
+
+void DrawBatch::add(const size_t numberOfIndices, const size_t firstIndex, const GL_I baseVertex)
+{
+    m_counts.push_back(static_cast<GL_I>(numberOfIndices));
+    m_firstIndices.push_back(firstIndex);
+    m_baseVertices.push_back(baseVertex);
+    if (m_indirect) {
+        const IndirectCommand command = {
+            static_cast<GL_U>(numberOfIndices), 1, static_cast<GL_U>(firstIndex), baseVertex, 0
+        };
+        m_commands.push_back(command);
+    }
+    m_changed = true;
+}
+
+void DrawBatch::add(const PooledMesh & mesh)
+{
+    add(mesh.numberOfIndices, mesh.firstIndex, static_cast<GL_I>(mesh.firstVertex));
+}
+
+void DrawBatch::clear()
+{
+    m_counts.clear();
+    m_firstIndices.clear();
+    m_baseVertices.clear();
+    m_offsets.clear();
+    m_commands.clear();
+    m_changed = true;
+}
+
+void DrawBatch::submit(const GL_I typeOfData, const GL_I indiceElementSizeGlEnum)
+{
+    if (m_counts.empty()) {
+        return;
+    }
+
+    if (m_indirect) {
+        glstate::bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        if (m_changed) {
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(IndirectCommand) * m_commands.size(), &m_commands[0],
+                         GL_DYNAMIC_DRAW);
+            m_changed = false;
+        }
+        glMultiDrawElementsIndirect(typeOfData, indiceElementSizeGlEnum, 0, static_cast<GLsizei>(m_commands.size()), 0);
+        glstate::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
+    }
+
+    if (m_changed || (m_offsetsIndiceType != indiceElementSizeGlEnum)) {
+        const size_t sizeOfIndice = (indiceElementSizeGlEnum == GL_UNSIGNED_SHORT) ? sizeof(U16) : sizeof(U32);
+        m_offsets.resize(m_firstIndices.size());
+        for (size_t i = 0; i < m_firstIndices.size(); ++i) {
+            m_offsets[i] = (const void *)(m_firstIndices[i] * sizeOfIndice);
+        }
+        m_offsetsIndiceType = indiceElementSizeGlEnum;
+        m_changed = false;
+    }
+    glMultiDrawElementsBaseVertex(typeOfData, &m_counts[0], indiceElementSizeGlEnum, &m_offsets[0],
+                                  static_cast<GLsizei>(m_counts.size()), &m_baseVertices[0]);
+}
@@ -2,11 +2,16 @@
 
 #include "stb_model.hh"
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
+#include "stb_gl_profiler.hh"
 #include "stb_math.hh"
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 
 namespace stb {
+    extern void setError(const char * format, ...);
+
     class VaoAccess
     {
     public:
@@ -25,20 +30,128 @@ namespace stb {
         GL_I & indiceElementSizeGlEnum() { return m_vao.indiceElementSizeGlEnum; }
         const GL_I & indiceElementSizeGlEnum() const { return m_vao.indiceElementSizeGlEnum; }
         GL_U * vbo() { return m_vao.vbo; }
+        GL_I * vboUsage() { return m_vao.vboUsage; }
+        size_t * vboSize() { return m_vao.vboSize; }
+        GL_I & indiceBufferUsage() { return m_vao.indiceBufferUsage; }
+        size_t & indiceBufferSize() { return m_vao.indiceBufferSize; }
+        GL_I & instanceBufferIndex() { return m_vao.instanceBufferIndex; }
+        GL_U & instanceDivisor() { return m_vao.instanceDivisor; }
+        GL_I & numberOfInstances() { return m_vao.numberOfInstances; }
 
     private:
         VertexArrayObject & m_vao;
     };
 
+    class StreamBufferAccess
+    {
+    public:
+        StreamBufferAccess(StreamBuffer & stream)
+        : m_stream(stream)
+        {}
+
+        GL_U & vao() { return m_stream.vao; }
+        GL_U & vertexBuffer() { return m_stream.vertexBuffer; }
+        GL_U & indiceBuffer() { return m_stream.indiceBuffer; }
+        GL_I & indiceElementSizeGlEnum() { return m_stream.indiceElementSizeGlEnum; }
+        size_t & sizeOfVertex() { return m_stream.sizeOfVertex; }
+        size_t & sizeOfIndice() { return m_stream.sizeOfIndice; }
+        size_t & vertexBytesPerFrame() { return m_stream.vertexBytesPerFrame; }
+        size_t & indiceBytesPerFrame() { return m_stream.indiceBytesPerFrame; }
+        size_t & framesInFlight() { return m_stream.framesInFlight; }
+        size_t & frame() { return m_stream.frame; }
+        size_t & vertexOffset() { return m_stream.vertexOffset; }
+        size_t & indiceOffset() { return m_stream.indiceOffset; }
+        size_t & numberOfOrphans() { return m_stream.numberOfOrphans; }
+        void *& fence(const size_t frame) { return m_stream.fences[frame]; }
+
+    private:
+        StreamBuffer & m_stream;
+    };
+
 }
 
+// Granularity of comparison when reloading buffers
+static const size_t RELOAD_BLOCK_SIZE = 4096;
+// Changed ranges closer than this are uploaded as one, the gap costs less than another call
+static const size_t UPDATE_MERGE_GAP = 256;
+
 stb::VertexArrayObject::VertexArrayObject()
     : vao(0),
       indiceBuffer(0),
       typeOfData(0),
-      indiceElementSizeGlEnum(0)
+      indiceElementSizeGlEnum(0),
+      indiceBufferUsage(0),
+      indiceBufferSize(0),
+      instanceBufferIndex(-1),
+      instanceDivisor(0),
+      numberOfInstances(0)
 {
     memset(vbo, 0, sizeof(vbo[0]) * STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT);
+    memset(vboUsage, 0, sizeof(vboUsage[0]) * STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT);
+    memset(vboSize, 0, sizeof(vboSize[0]) * STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT);
+}
+
+void stb::VaoChanges::attributesChanged(const size_t attributeBufferIndex, const size_t offset, const size_t size)
+{
+    const Range range = { offset, size };
+    m_attributes[attributeBufferIndex].push_back(range);
+}
+
+void stb::VaoChanges::indicesChanged(const size_t offset, const size_t size)
+{
+    const Range range = { offset, size };
+    m_indices.push_back(range);
+}
+
+bool stb::VaoChanges::empty() const
+{
+    for (const Ranges & ranges : m_attributes) {
+        if (!ranges.empty()) {
+            return false;
+        }
+    }
+    return m_indices.empty();
+}
+
+void stb::VaoChanges::clear()
+{
+    for (Ranges & ranges : m_attributes) {
+        ranges.clear();
+    }
+    m_indices.clear();
+}
+
+static GL_I glUsage(const stb::BufferUsage::Type usage)
+{
+    switch (usage) {
+    case stb::BufferUsage::Dynamic:
+        return GL_DYNAMIC_DRAW;
+    case stb::BufferUsage::Stream:
+        return GL_STREAM_DRAW;
+    case stb::BufferUsage::Static:
+        break;
+    }
+    return GL_STATIC_DRAW;
+}
+
+/*
+ * Points attribute at location to buffer bound to GL_ARRAY_BUFFER
+ */
+static void attributePointer(const GL_I location,
+                             const size_t numberOfValues,
+                             const stb::ModelData::AttributeBufferDataType dataType,
+                             const size_t sizeOfElement,
+                             const size_t pointer)
+{
+    glEnableVertexAttribArray(location);
+    switch (dataType) {
+    case stb::ModelData::FLOAT:
+        glVertexAttribPointer(location, numberOfValues, GL_FLOAT, GL_FALSE, sizeOfElement, (const void *)pointer);
+        break;
+    case stb::ModelData::UINT32:
+        glVertexAttribIPointer(location, numberOfValues, GL_UNSIGNED_INT, sizeOfElement, (const void *)pointer);
+        break;
+    }
 }
 
 void stb::initVao(VertexArrayObject & v,
@@ -46,24 +159,27 @@ void stb::initVao(VertexArrayObject & v,
                   const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo
                   )
 {
-    VaoAccess vao(v);
+    initVao(v, model, shaderAttributeIndexInfo, BufferUsages(), BufferUsage::Static);
+}
 
+/*
+ * Creates vao drawing model from its buffers, which already hold the data of model
+ */
+static void setUpVao(stb::VaoAccess & vao,
+                     const stb::ModelData & model,
+                     const stb::ShaderAttributeLayoutInfo & shaderAttributeIndexInfo)
+{
     glGenVertexArrays(1, &vao.vao());
-    glBindVertexArray(vao.vao());
+    stb::glstate::bindVertexArray(vao.vao());
 
-    ShaderAttributeLayoutInfo::const_iterator it = shaderAttributeIndexInfo.begin();
+    stb::ShaderAttributeLayoutInfo::const_iterator it = shaderAttributeIndexInfo.begin();
     for (size_t attributeBufferIndex = 0;
          attributeBufferIndex < model.numberOfAttrBuffers();
          ++attributeBufferIndex) {
 
         bool outOfData = false;
 
-        glGenBuffers(1, &vao.vbo()[attributeBufferIndex]);
-        glBindBuffer(GL_ARRAY_BUFFER, vao.vbo()[attributeBufferIndex]);
-        glBufferData(GL_ARRAY_BUFFER,
-                     model.attrBufferSize(attributeBufferIndex),
-                     model.attrBuffer(attributeBufferIndex),
-                     GL_STATIC_DRAW); // TODO: parametritize draw type
+        stb::glstate::bindBuffer(GL_ARRAY_BUFFER, vao.vbo()[attributeBufferIndex]);
 
         for (size_t bufferIndex = 0;
              bufferIndex < model.numberOfAttrInBuffer(attributeBufferIndex);
@@ -71,27 +187,11 @@ void stb::initVao(VertexArrayObject & v,
 
             if ((*it) == -1) continue;
 
-            const size_t numberOfValues = model.valuesPerAttribute(attributeBufferIndex, bufferIndex);
-            glEnableVertexAttribArray(*it);
-            switch (model.attrBufferDataType(attributeBufferIndex)) {
-            case stb::ModelData::FLOAT:
-                glVertexAttribPointer(*it,
-                                      numberOfValues,
-                                      GL_FLOAT,
-                                      GL_FALSE,
-                                      model.attrBufferSizeOfElement(attributeBufferIndex),
-                                      (const void *)model.pointerToDataInBuffer(
-                                                                 attributeBufferIndex, bufferIndex));
-                break;
-            case stb::ModelData::UINT32:
-                glVertexAttribIPointer(*it,
-                                       numberOfValues,
-                                       GL_UNSIGNED_INT,
-                                       model.attrBufferSizeOfElement(attributeBufferIndex),
-                                       (const void *)model.pointerToDataInBuffer(
-                                                                attributeBufferIndex, bufferIndex));
-                break;
-            }
+            attributePointer(*it,
+                             model.valuesPerAttribute(attributeBufferIndex, bufferIndex),
+                             model.attrBufferDataType(attributeBufferIndex),
+                             model.attrBufferSizeOfElement(attributeBufferIndex),
+                             model.pointerToDataInBuffer(attributeBufferIndex, bufferIndex));
 
             ++it;
             if (it == shaderAttributeIndexInfo.end()) {
@@ -104,22 +204,17 @@ void stb::initVao(VertexArrayObject & v,
         }
     }
 
-    glGenBuffers(1, &vao.indiceBuffer());
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.indiceBuffer());
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 model.indicesDataSize(),
-                 model.indicesData(),
-                 GL_STATIC_DRAW); // TODO: parametritize draw type
+    stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.indiceBuffer());
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    stb::glstate::bindVertexArray(0);
+    stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
 
     switch (model.attributeDataMode()) {
-    case ModelData::TRIANGLE:
+    case stb::ModelData::TRIANGLE:
         vao.typeOfData() = GL_TRIANGLES;
         break;
-    case ModelData::TRIANGE_STRIP:
+    case stb::ModelData::TRIANGE_STRIP:
         vao.typeOfData() = GL_TRIANGLE_STRIP;
         break;
     }
@@ -138,13 +233,266 @@ void stb::initVao(VertexArrayObject & v,
     vao.numberOfIndicesElements() = model.indicesDataSize() / model.sizeOfIndiceElement();
 }
 
+void stb::initVao(VertexArrayObject & v,
+                  const stb::ModelData & model,
+                  const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                  const BufferUsages & attributeUsages,
+                  const BufferUsage::Type indiceUsage
+                  )
+{
+    VaoAccess vao(v);
+
+    for (size_t attributeBufferIndex = 0;
+         attributeBufferIndex < model.numberOfAttrBuffers();
+         ++attributeBufferIndex) {
+        vao.vboUsage()[attributeBufferIndex] = glUsage((attributeBufferIndex < attributeUsages.size())
+            ? attributeUsages[attributeBufferIndex] : BufferUsage::Static);
+        vao.vboSize()[attributeBufferIndex] = model.attrBufferSize(attributeBufferIndex);
+        glGenBuffers(1, &vao.vbo()[attributeBufferIndex]);
+        stb::glstate::bindBuffer(GL_ARRAY_BUFFER, vao.vbo()[attributeBufferIndex]);
+        glBufferData(GL_ARRAY_BUFFER,
+                     model.attrBufferSize(attributeBufferIndex),
+                     model.attrBuffer(attributeBufferIndex),
+                     vao.vboUsage()[attributeBufferIndex]);
+    }
+
+    // Element array binding is state of the bound vao, indices are uploaded through another target
+    vao.indiceBufferUsage() = glUsage(indiceUsage);
+    vao.indiceBufferSize() = model.indicesDataSize();
+    glGenBuffers(1, &vao.indiceBuffer());
+    stb::glstate::bindBuffer(GL_COPY_WRITE_BUFFER, vao.indiceBuffer());
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 model.indicesDataSize(),
+                 model.indicesData(),
+                 vao.indiceBufferUsage());
+    stb::glstate::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    setUpVao(vao, model, shaderAttributeIndexInfo);
+}
+
+void stb::initVaoFromBuffers(VertexArrayObject & v,
+                             const stb::ModelData & model,
+                             const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                             const std::vector<GL_U> & attributeBuffers,
+                             const GL_U indiceBuffer,
+                             const BufferUsages & attributeUsages,
+                             const BufferUsage::Type indiceUsage
+                             )
+{
+    assert(attributeBuffers.size() == model.numberOfAttrBuffers());
+    VaoAccess vao(v);
+
+    for (size_t attributeBufferIndex = 0;
+         attributeBufferIndex < model.numberOfAttrBuffers();
+         ++attributeBufferIndex) {
+        vao.vboUsage()[attributeBufferIndex] = glUsage((attributeBufferIndex < attributeUsages.size())
+            ? attributeUsages[attributeBufferIndex] : BufferUsage::Static);
+        vao.vboSize()[attributeBufferIndex] = model.attrBufferSize(attributeBufferIndex);
+        vao.vbo()[attributeBufferIndex] = attributeBuffers[attributeBufferIndex];
+    }
+    vao.indiceBufferUsage() = glUsage(indiceUsage);
+    vao.indiceBufferSize() = model.indicesDataSize();
+    vao.indiceBuffer() = indiceBuffer;
+
+    setUpVao(vao, model, shaderAttributeIndexInfo);
+}
+
+static bool sameLayout(const stb::ModelData & a, const stb::ModelData & b)
+{
+    if ((a.numberOfAttrBuffers() != b.numberOfAttrBuffers())
+        || (a.sizeOfIndiceElement() != b.sizeOfIndiceElement())) {
+        return false;
+    }
+    for (size_t i = 0; i < a.numberOfAttrBuffers(); ++i) {
+        if ((a.attrBufferSizeOfElement(i) != b.attrBufferSizeOfElement(i))
+            || (a.attrBufferDataType(i) != b.attrBufferDataType(i))
+            || (a.numberOfAttrInBuffer(i) != b.numberOfAttrInBuffer(i))) {
+            return false;
+        }
+        for (size_t v = 0; v < a.numberOfAttrInBuffer(i); ++v) {
+            if (a.valuesPerAttribute(i, v) != b.valuesPerAttribute(i, v)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Sorts ranges and merges overlapping and close ones, clamping them to the buffer
+ */
+static void coalesceRanges(stb::VaoChanges::Ranges & ranges, const size_t bufferSize)
+{
+    std::sort(ranges.begin(), ranges.end(), [](const stb::VaoChanges::Range & a, const stb::VaoChanges::Range & b) {
+        return a.offset < b.offset;
+    });
+
+    size_t merged = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const size_t begin = std::min(ranges[i].offset, bufferSize);
+        const size_t end = std::min(ranges[i].offset + ranges[i].size, bufferSize);
+        if (begin == end) {
+            continue;
+        }
+        if ((merged != 0) && (begin <= ranges[merged - 1].offset + ranges[merged - 1].size + UPDATE_MERGE_GAP)) {
+            stb::VaoChanges::Range & last = ranges[merged - 1];
+            last.size = std::max(last.offset + last.size, end) - last.offset;
+        } else {
+            const stb::VaoChanges::Range range = { begin, end - begin };
+            ranges[merged++] = range;
+        }
+    }
+    ranges.resize(merged);
+}
+
+/*
+ * Uploads changed ranges of data into buffer bound to target, or all of data
+ * with usage if its size is not the size of the buffer. Returns bytes uploaded.
+ */
+static size_t uploadRanges(const GLenum target, const GL_I usage, size_t & bufferSize,
+                           const char * data, const size_t dataSize, stb::VaoChanges::Ranges & ranges)
+{
+    if (dataSize != bufferSize) {
+        glBufferData(target, dataSize, data, usage);
+        bufferSize = dataSize;
+        return dataSize;
+    }
+
+    coalesceRanges(ranges, dataSize);
+    if (ranges.empty()) {
+        return 0;
+    }
+    if (ranges.size() == 1) {
+        glBufferSubData(target, ranges[0].offset, ranges[0].size, data + ranges[0].offset);
+        return ranges[0].size;
+    }
+
+    // One mapping covers all ranges, only the ranges are written and flushed
+    const size_t spanBegin = ranges.front().offset;
+    const size_t spanEnd = ranges.back().offset + ranges.back().size;
+    char * mapped = (char *)glMapBufferRange(target, spanBegin, spanEnd - spanBegin,
+        GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    size_t uploaded = 0;
+    for (const stb::VaoChanges::Range & range : ranges) {
+        if (mapped != 0) {
+            memcpy(mapped + (range.offset - spanBegin), data + range.offset, range.size);
+            glFlushMappedBufferRange(target, range.offset - spanBegin, range.size);
+        } else {
+            glBufferSubData(target, range.offset, range.size, data + range.offset);
+        }
+        uploaded += range.size;
+    }
+    if (mapped != 0) {
+        glUnmapBuffer(target);
+    }
+    return uploaded;
+}
+
+static void updateDrawInfo(stb::VaoAccess & vao, const stb::ModelData & model)
+{
+    switch (model.attributeDataMode()) {
+    case stb::ModelData::TRIANGLE:
+        vao.typeOfData() = GL_TRIANGLES;
+        break;
+    case stb::ModelData::TRIANGE_STRIP:
+        vao.typeOfData() = GL_TRIANGLE_STRIP;
+        break;
+    }
+    vao.numberOfIndicesElements() = model.indicesDataSize() / model.sizeOfIndiceElement();
+}
+
+size_t stb::updateVao(VertexArrayObject & v,
+                      const stb::ModelData & model,
+                      VaoChanges & changes
+                      )
+{
+    VaoAccess vao(v);
+    stb::glstate::bindVertexArray(vao.vao());
+
+    size_t uploaded = 0;
+    for (size_t i = 0; i < model.numberOfAttrBuffers(); ++i) {
+        if (changes.m_attributes[i].empty() && (model.attrBufferSize(i) == vao.vboSize()[i])) {
+            continue;
+        }
+        stb::glstate::bindBuffer(GL_ARRAY_BUFFER, vao.vbo()[i]);
+        uploaded += uploadRanges(GL_ARRAY_BUFFER, vao.vboUsage()[i], vao.vboSize()[i],
+                                 model.attrBuffer(i), model.attrBufferSize(i), changes.m_attributes[i]);
+    }
+
+    // Element array binding is part of vao state, so it is bound while vao is
+    if (!changes.m_indices.empty() || (model.indicesDataSize() != vao.indiceBufferSize())) {
+        stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.indiceBuffer());
+        uploaded += uploadRanges(GL_ELEMENT_ARRAY_BUFFER, vao.indiceBufferUsage(), vao.indiceBufferSize(),
+                                 model.indicesData(), model.indicesDataSize(), changes.m_indices);
+    }
+
+    stb::glstate::bindVertexArray(0);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    updateDrawInfo(vao, model);
+    changes.clear();
+    return uploaded;
+}
+
+/*
+ * Adds blocks of updated that differ from resident to ranges,
+ * sizes that differ are left for updateVao to re-specify
+ */
+static void findChanged(const char * resident, const size_t residentSize,
+                        const char * updated, const size_t updatedSize,
+                        stb::VaoChanges::Ranges & ranges)
+{
+    if ((residentSize != updatedSize) || (resident == updated)) {
+        return;
+    }
+
+    for (size_t offset = 0; offset < updatedSize; offset += RELOAD_BLOCK_SIZE) {
+        const size_t length = std::min(RELOAD_BLOCK_SIZE, updatedSize - offset);
+        if (memcmp(resident + offset, updated + offset, length) != 0) {
+            const stb::VaoChanges::Range range = { offset, length };
+            ranges.push_back(range);
+        }
+    }
+}
+
+bool stb::reloadVao(VertexArrayObject & v,
+                    const stb::ModelData & resident,
+                    const stb::ModelData & updated
+                    )
+{
+    if (!sameLayout(resident, updated)) {
+        return false;
+    }
+
+    VaoChanges changes;
+    for (size_t i = 0; i < updated.numberOfAttrBuffers(); ++i) {
+        findChanged(resident.attrBuffer(i), resident.attrBufferSize(i),
+                    updated.attrBuffer(i), updated.attrBufferSize(i), changes.m_attributes[i]);
+    }
+    findChanged(resident.indicesData(), resident.indicesDataSize(),
+                updated.indicesData(), updated.indicesDataSize(), changes.m_indices);
+    updateVao(v, updated, changes);
+    return true;
+}
+
 void stb::bindAndDraw(VertexArrayObject & v)
 {
+    const stb::GpuScope scope(stb::activeGpuProfiler(), "bindAndDraw");
     stb::VaoAccess vao(v);
-    glBindVertexArray(vao.vao());
+    stb::glstate::bindVertexArray(vao.vao());
     glDrawElements(vao.typeOfData(), vao.numberOfIndicesElements(), vao.indiceElementSizeGlEnum(), 0);
 }
 
+void stb::bindAndDrawRange(VertexArrayObject & v, const size_t firstIndex, const size_t numberOfIndices)
+{
+    const stb::GpuScope scope(stb::activeGpuProfiler(), "bindAndDrawRange");
+    stb::VaoAccess vao(v);
+    const size_t sizeOfIndice = (vao.indiceElementSizeGlEnum() == GL_UNSIGNED_SHORT) ? 2 : 4;
+    stb::glstate::bindVertexArray(vao.vao());
+    glDrawElements(vao.typeOfData(), static_cast<GLsizei>(numberOfIndices), vao.indiceElementSizeGlEnum(),
+        (const void *)(firstIndex * sizeOfIndice));
+}
+
 void stb::draw(VertexArrayObject & v)
 {
     const stb::VaoAccess vao(v);
@@ -153,8 +501,9 @@ void stb::draw(VertexArrayObject & v)
 
 void stb::bindAndDraw(VertexArrayObject & v, const GL_I customDataType)
 {
+    const stb::GpuScope scope(stb::activeGpuProfiler(), "bindAndDraw");
     stb::VaoAccess vao(v);
-    glBindVertexArray(vao.vao());
+    stb::glstate::bindVertexArray(vao.vao());
     glDrawElements(customDataType, vao.numberOfIndicesElements(), vao.indiceElementSizeGlEnum(), 0);
 }
 
@@ -164,10 +513,315 @@ void stb::draw(VertexArrayObject & v, const GL_I customDataType)
     glDrawElements(customDataType, vao.numberOfIndicesElements(), vao.indiceElementSizeGlEnum(), 0);
 }
 
+bool stb::initInstances(VertexArrayObject & v,
+                        const ModelData::AttributeData & instances,
+                        const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                        const GL_U divisor
+                        )
+{
+    // Divisor is core only from 3.3 on
+    if (!ogl_ext_ARB_instanced_arrays) {
+        stb::setError("%s: ARB_instanced_arrays is not supported", __FUNCTION__);
+        return false;
+    }
+    if (instances.m_sizeOfAttributeElement == 0) {
+        stb::setError("%s: Size of instance element is zero", __FUNCTION__);
+        return false;
+    }
+
+    VaoAccess vao(v);
+    GL_I index = 0;
+    while ((index < STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT) && (vao.vbo()[index] != 0)) {
+        ++index;
+    }
+    if (index == STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT) {
+        stb::setError("%s: All %d buffers of vao are in use", __FUNCTION__, STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT);
+        return false;
+    }
+
+    vao.instanceBufferIndex() = index;
+    vao.instanceDivisor() = std::max<GL_U>(divisor, 1);
+    vao.vboUsage()[index] = GL_DYNAMIC_DRAW;
+    vao.vboSize()[index] = instances.m_attributeDataSize;
+    vao.numberOfInstances() = static_cast<GL_I>(instances.m_attributeDataSize / instances.m_sizeOfAttributeElement
+        * vao.instanceDivisor());
+
+    stb::glstate::bindVertexArray(vao.vao());
+    glGenBuffers(1, &vao.vbo()[index]);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, vao.vbo()[index]);
+    glBufferData(GL_ARRAY_BUFFER, instances.m_attributeDataSize, instances.m_attributeData, GL_DYNAMIC_DRAW);
+
+    size_t pointer = 0;
+    for (size_t i = 0; (i < instances.m_valuesPerAttribute.size()) && (i < shaderAttributeIndexInfo.size()); ++i) {
+        if (shaderAttributeIndexInfo[i] != -1) {
+            attributePointer(shaderAttributeIndexInfo[i], instances.m_valuesPerAttribute[i], instances.m_dataType,
+                             instances.m_sizeOfAttributeElement, pointer);
+            glVertexAttribDivisorARB(shaderAttributeIndexInfo[i], vao.instanceDivisor());
+        }
+        pointer += instances.m_valuesPerAttribute[i] * sizeof(float);
+    }
+
+    stb::glstate::bindVertexArray(0);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+bool stb::updateInstances(VertexArrayObject & v, const ModelData::AttributeData & instances)
+{
+    VaoAccess vao(v);
+    const GL_I index = vao.instanceBufferIndex();
+    if (index == -1) {
+        stb::setError("%s: Instances of vao are not initialized", __FUNCTION__);
+        return false;
+    }
+    if (instances.m_sizeOfAttributeElement == 0) {
+        stb::setError("%s: Size of instance element is zero", __FUNCTION__);
+        return false;
+    }
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, vao.vbo()[index]);
+    if (instances.m_attributeDataSize != vao.vboSize()[index]) {
+        glBufferData(GL_ARRAY_BUFFER, instances.m_attributeDataSize, instances.m_attributeData, GL_DYNAMIC_DRAW);
+        vao.vboSize()[index] = instances.m_attributeDataSize;
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.m_attributeDataSize, instances.m_attributeData);
+    }
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+    vao.numberOfInstances() = static_cast<GL_I>(instances.m_attributeDataSize / instances.m_sizeOfAttributeElement
+        * vao.instanceDivisor());
+    return true;
+}
+
+void stb::bindAndDrawInstanced(VertexArrayObject & v)
+{
+    const stb::GpuScope scope(stb::activeGpuProfiler(), "bindAndDrawInstanced");
+    stb::VaoAccess vao(v);
+    stb::glstate::bindVertexArray(vao.vao());
+    glDrawElementsInstanced(vao.typeOfData(), vao.numberOfIndicesElements(), vao.indiceElementSizeGlEnum(), 0,
+                            vao.numberOfInstances());
+}
+
+void stb::drawInstanced(VertexArrayObject & v, const size_t numberOfInstances)
+{
+    const stb::VaoAccess vao(v);
+    glDrawElementsInstanced(vao.typeOfData(), vao.numberOfIndicesElements(), vao.indiceElementSizeGlEnum(), 0,
+                            static_cast<GLsizei>(numberOfInstances));
+}
+
 void stb::releaseVao(VertexArrayObject & v)
 {
     stb::VaoAccess vao(v);
-    glDeleteBuffers(STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT, vao.vbo());
-    glDeleteBuffers(1, &vao.indiceBuffer());
-    glDeleteVertexArrays(1, &vao.vao());
+    stb::glstate::deleteBuffers(STB_GL_OBJECT_MAX_NUMBER_OF_BUFFERS_PER_OBJECT, vao.vbo());
+    stb::glstate::deleteBuffers(1, &vao.indiceBuffer());
+    stb::glstate::deleteVertexArrays(1, &vao.vao());
+    // Names may be reused by GL, so none of them are kept for a later initVao to find
+    v = VertexArrayObject();
+}
+
+stb::VaoDrawInfo stb::drawInfo(VertexArrayObject & v)
+{
+    stb::VaoAccess vao(v);
+    VaoDrawInfo info;
+    info.vao = vao.vao();
+    info.typeOfData = vao.typeOfData();
+    info.numberOfIndices = vao.numberOfIndicesElements();
+    info.indiceElementSizeGlEnum = vao.indiceElementSizeGlEnum();
+    info.numberOfInstances = (vao.instanceBufferIndex() != -1) ? vao.numberOfInstances() : 0;
+    return info;
+}
+
+stb::StreamBuffer::StreamBuffer()
+    : vao(0),
+      vertexBuffer(0),
+      indiceBuffer(0),
+      indiceElementSizeGlEnum(0),
+      sizeOfVertex(0),
+      sizeOfIndice(0),
+      vertexBytesPerFrame(0),
+      indiceBytesPerFrame(0),
+      framesInFlight(0),
+      frame(0),
+      vertexOffset(0),
+      indiceOffset(0),
+      numberOfOrphans(0)
+{
+    memset(fences, 0, sizeof(fences[0]) * STB_GL_OBJECT_MAX_STREAM_FRAMES_IN_FLIGHT);
+}
+
+void stb::initStreamBuffer(StreamBuffer & s,
+                           const std::vector<size_t> & valuesPerAttribute,
+                           const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                           const size_t sizeOfIndice,
+                           const size_t verticesPerFrame,
+                           const size_t indicesPerFrame,
+                           const size_t framesInFlight
+                           )
+{
+    StreamBufferAccess stream(s);
+    stream.sizeOfVertex() = 0;
+    for (size_t values : valuesPerAttribute) {
+        stream.sizeOfVertex() += values * sizeof(float);
+    }
+    stream.sizeOfIndice() = sizeOfIndice;
+    stream.indiceElementSizeGlEnum() = (sizeOfIndice == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    stream.vertexBytesPerFrame() = verticesPerFrame * stream.sizeOfVertex();
+    stream.indiceBytesPerFrame() = indicesPerFrame * sizeOfIndice;
+    stream.framesInFlight() = std::min<size_t>(std::max<size_t>(framesInFlight, 1), STB_GL_OBJECT_MAX_STREAM_FRAMES_IN_FLIGHT);
+    // First beginStreamFrame moves to the first segment
+    stream.frame() = stream.framesInFlight() - 1;
+    stream.vertexOffset() = stream.frame() * stream.vertexBytesPerFrame();
+    stream.indiceOffset() = stream.frame() * stream.indiceBytesPerFrame();
+
+    glGenVertexArrays(1, &stream.vao());
+    stb::glstate::bindVertexArray(stream.vao());
+
+    glGenBuffers(1, &stream.vertexBuffer());
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, stream.vertexBuffer());
+    glBufferData(GL_ARRAY_BUFFER, stream.vertexBytesPerFrame() * stream.framesInFlight(), 0, GL_STREAM_DRAW);
+
+    size_t pointer = 0;
+    for (size_t i = 0; (i < valuesPerAttribute.size()) && (i < shaderAttributeIndexInfo.size()); ++i) {
+        if (shaderAttributeIndexInfo[i] != -1) {
+            glEnableVertexAttribArray(shaderAttributeIndexInfo[i]);
+            glVertexAttribPointer(shaderAttributeIndexInfo[i], valuesPerAttribute[i], GL_FLOAT, GL_FALSE,
+                                  stream.sizeOfVertex(), (const void *)pointer);
+        }
+        pointer += valuesPerAttribute[i] * sizeof(float);
+    }
+
+    glGenBuffers(1, &stream.indiceBuffer());
+    stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.indiceBuffer());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, stream.indiceBytesPerFrame() * stream.framesInFlight(), 0, GL_STREAM_DRAW);
+
+    stb::glstate::bindVertexArray(0);
+    stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*
+ * Gives both buffers new storage, the old one is freed by the driver once the GPU is done with it
+ */
+static void orphanStream(stb::StreamBufferAccess & stream)
+{
+    stb::glstate::bindVertexArray(stream.vao());
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, stream.vertexBuffer());
+    glBufferData(GL_ARRAY_BUFFER, stream.vertexBytesPerFrame() * stream.framesInFlight(), 0, GL_STREAM_DRAW);
+    stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.indiceBuffer());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, stream.indiceBytesPerFrame() * stream.framesInFlight(), 0, GL_STREAM_DRAW);
+    stb::glstate::bindVertexArray(0);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (size_t i = 0; i < stream.framesInFlight(); ++i) {
+        if (stream.fence(i) != 0) {
+            glDeleteSync(static_cast<GLsync>(stream.fence(i)));
+            stream.fence(i) = 0;
+        }
+    }
+    ++stream.numberOfOrphans();
+}
+
+void stb::beginStreamFrame(StreamBuffer & s)
+{
+    StreamBufferAccess stream(s);
+    const bool written = (stream.vertexOffset() != stream.frame() * stream.vertexBytesPerFrame())
+        || (stream.indiceOffset() != stream.frame() * stream.indiceBytesPerFrame());
+    if (written) {
+        stream.fence(stream.frame()) = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    stream.frame() = (stream.frame() + 1) % stream.framesInFlight();
+    void *& fence = stream.fence(stream.frame());
+    if (fence != 0) {
+        // Zero timeout only polls, a segment still in use is not waited for
+        const GLenum result = glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        glDeleteSync(static_cast<GLsync>(fence));
+        fence = 0;
+        if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED)) {
+            orphanStream(stream);
+        }
+    }
+    stream.vertexOffset() = stream.frame() * stream.vertexBytesPerFrame();
+    stream.indiceOffset() = stream.frame() * stream.indiceBytesPerFrame();
+}
+
+/*
+ * Copies data into buffer bound to target, without waiting for draws using other parts of it
+ */
+static void writeUnsynchronized(const GLenum target, const size_t offset, const void * data, const size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    void * mapped = glMapBufferRange(target, offset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped == 0) {
+        glBufferSubData(target, offset, size, data);
+        return;
+    }
+    memcpy(mapped, data, size);
+    glUnmapBuffer(target);
+}
+
+bool stb::writeStream(StreamBuffer & s,
+                      const void * vertices, const size_t numberOfVertices,
+                      const void * indices, const size_t numberOfIndices,
+                      StreamRange & range
+                      )
+{
+    StreamBufferAccess stream(s);
+    const size_t vertexBytes = numberOfVertices * stream.sizeOfVertex();
+    const size_t indiceBytes = numberOfIndices * stream.sizeOfIndice();
+    const size_t vertexEnd = (stream.frame() + 1) * stream.vertexBytesPerFrame();
+    const size_t indiceEnd = (stream.frame() + 1) * stream.indiceBytesPerFrame();
+    if ((stream.vertexOffset() + vertexBytes > vertexEnd) || (stream.indiceOffset() + indiceBytes > indiceEnd)) {
+        stb::setError("%s: %zu vertices and %zu indices do not fit in what is left of the frame",
+            __FUNCTION__, numberOfVertices, numberOfIndices);
+        return false;
+    }
+
+    stb::glstate::bindVertexArray(stream.vao());
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, stream.vertexBuffer());
+    writeUnsynchronized(GL_ARRAY_BUFFER, stream.vertexOffset(), vertices, vertexBytes);
+    stb::glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.indiceBuffer());
+    writeUnsynchronized(GL_ELEMENT_ARRAY_BUFFER, stream.indiceOffset(), indices, indiceBytes);
+    stb::glstate::bindVertexArray(0);
+    stb::glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    range.firstIndex = stream.indiceOffset() / stream.sizeOfIndice();
+    range.numberOfIndices = numberOfIndices;
+    range.baseVertex = static_cast<GL_I>(stream.vertexOffset() / stream.sizeOfVertex());
+    stream.vertexOffset() += vertexBytes;
+    stream.indiceOffset() += indiceBytes;
+    return true;
+}
+
+void stb::drawStream(StreamBuffer & s, const StreamRange & range)
+{
+    drawStream(s, range, GL_TRIANGLES);
+}
+
+void stb::drawStream(StreamBuffer & s, const StreamRange & range, const GL_I customDataType)
+{
+    StreamBufferAccess stream(s);
+    stb::glstate::bindVertexArray(stream.vao());
+    glDrawElementsBaseVertex(customDataType, static_cast<GLsizei>(range.numberOfIndices), stream.indiceElementSizeGlEnum(),
+        (const void *)(range.firstIndex * stream.sizeOfIndice()), range.baseVertex);
+}
+
+size_t stb::numberOfStreamOrphans(const StreamBuffer & s)
+{
+    return StreamBufferAccess(const_cast<StreamBuffer &>(s)).numberOfOrphans();
+}
+
+void stb::releaseStreamBuffer(StreamBuffer & s)
+{
+    StreamBufferAccess stream(s);
+    for (size_t i = 0; i < stream.framesInFlight(); ++i) {
+        if (stream.fence(i) != 0) {
+            glDeleteSync(static_cast<GLsync>(stream.fence(i)));
+            stream.fence(i) = 0;
+        }
+    }
+    stb::glstate::deleteBuffers(1, &stream.vertexBuffer());
+    stb::glstate::deleteBuffers(1, &stream.indiceBuffer());
+    stb::glstate::deleteVertexArrays(1, &stream.vao());
 }
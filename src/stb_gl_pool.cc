@@ -0,0 +1,202 @@
+#include "stb_gl_pool.hh"
+
+#include "stb_model.hh"
+#include "stb_gl.hh"
+#include "stb_gl_state.hh"
+
+#include <algorithm>
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+using namespace stb;
+
+stb::PooledMesh::PooledMesh()
+    : firstVertex(0),
+      numberOfVertices(0),
+      firstIndex(0),
+      numberOfIndices(0),
+      typeOfData(0)
+{}
+
+GeometryPool::GeometryPool(const std::vector<size_t> & valuesPerAttribute,
+                           const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo,
+                           const size_t initialVertices,
+                           const size_t initialIndices)
+: m_valuesPerAttribute(valuesPerAttribute),
+m_shaderAttributeIndexInfo(shaderAttributeIndexInfo),
+m_sizeOfVertex(0),
+m_vao(0),
+m_vertexBuffer(0),
+m_indiceBuffer(0),
+m_vertices(0),
+m_indices(0),
+m_numberOfMeshes(0)
+{
+    for (size_t values : m_valuesPerAttribute) {
+        m_sizeOfVertex += values * sizeof(float);
+    }
+
+    glGenVertexArrays(1, &m_vao);
+    growVertices(std::max<size_t>(initialVertices, 1));
+    growIndices(std::max<size_t>(initialIndices, 1));
+}
+
+GeometryPool::~GeometryPool()
+{
+    glstate::deleteBuffers(1, &m_vertexBuffer);
+    glstate::deleteBuffers(1, &m_indiceBuffer);
+    glstate::deleteVertexArrays(1, &m_vao);
+}
+
+void GeometryPool::setAttributePointers()
+{
+    glstate::bindVertexArray(m_vao);
+    glstate::bindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    size_t pointer = 0;
+    for (size_t i = 0; (i < m_valuesPerAttribute.size()) && (i < m_shaderAttributeIndexInfo.size()); ++i) {
+        if (m_shaderAttributeIndexInfo[i] != -1) {
+            glEnableVertexAttribArray(m_shaderAttributeIndexInfo[i]);
+            glVertexAttribPointer(m_shaderAttributeIndexInfo[i], m_valuesPerAttribute[i], GL_FLOAT, GL_FALSE,
+                                  m_sizeOfVertex, (const void *)pointer);
+        }
+        pointer += m_valuesPerAttribute[i] * sizeof(float);
+    }
+    glstate::bindVertexArray(0);
+    glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*
+ * Replaces buffer with a larger one holding the same data at the same offsets
+ */
+static GL_U growBuffer(const GL_U buffer, const size_t oldSize, const size_t newSize)
+{
+    GL_U grown = 0;
+    glGenBuffers(1, &grown);
+    glstate::bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, 0, GL_DYNAMIC_DRAW);
+    if (oldSize != 0) {
+        glstate::bindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+        glstate::bindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glstate::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glstate::deleteBuffers(1, &buffer);
+    return grown;
+}
+
+void GeometryPool::growVertices(const size_t atLeast)
+{
+    const size_t capacity = m_vertices.capacity() + std::max(m_vertices.capacity(), atLeast);
+    m_vertexBuffer = growBuffer(m_vertexBuffer, m_vertices.capacity() * m_sizeOfVertex, capacity * m_sizeOfVertex);
+    m_vertices.grow(capacity);
+    // Attribute pointers refer to the buffer that was bound when they were set
+    setAttributePointers();
+}
+
+void GeometryPool::growIndices(const size_t atLeast)
+{
+    const size_t capacity = m_indices.capacity() + std::max(m_indices.capacity(), atLeast);
+    m_indiceBuffer = growBuffer(m_indiceBuffer, m_indices.capacity() * sizeof(U32), capacity * sizeof(U32));
+    m_indices.grow(capacity);
+    glstate::bindVertexArray(m_vao);
+    glstate::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indiceBuffer);
+    glstate::bindVertexArray(0);
+}
+
+bool GeometryPool::sameFormat(const ModelData & model) const
+{
+    if (!model.valid() || (model.numberOfAttrBuffers() != 1)
+        || (model.attrBufferDataType(0) != ModelData::FLOAT)
+        || (model.attrBufferSizeOfElement(0) != m_sizeOfVertex)
+        || (model.numberOfAttrInBuffer(0) != m_valuesPerAttribute.size())
+        || ((model.sizeOfIndiceElement() != sizeof(U16)) && (model.sizeOfIndiceElement() != sizeof(U32)))) {
+        return false;
+    }
+    for (size_t i = 0; i < m_valuesPerAttribute.size(); ++i) {
+        if (model.valuesPerAttribute(0, i) != m_valuesPerAttribute[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PooledMesh GeometryPool::add(const ModelData & model)
+{
+    PooledMesh mesh;
+    if (!sameFormat(model)) {
+        stb::setError("%s: Model is not a single buffer of the vertex format of pool", __FUNCTION__);
+        return mesh;
+    }
+    const size_t numberOfVertices = model.attrBufferSize(0) / m_sizeOfVertex;
+    const size_t numberOfIndices = model.indicesDataSize() / model.sizeOfIndiceElement();
+    if ((numberOfVertices == 0) || (numberOfIndices == 0)) {
+        stb::setError("%s: Model has no vertices or indices", __FUNCTION__);
+        return mesh;
+    }
+
+    size_t firstVertex = m_vertices.allocate(numberOfVertices);
+    if (firstVertex == FreeListAllocator::INVALID_OFFSET) {
+        growVertices(numberOfVertices);
+        firstVertex = m_vertices.allocate(numberOfVertices);
+    }
+    size_t firstIndex = m_indices.allocate(numberOfIndices);
+    if (firstIndex == FreeListAllocator::INVALID_OFFSET) {
+        growIndices(numberOfIndices);
+        firstIndex = m_indices.allocate(numberOfIndices);
+    }
+
+    glstate::bindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, firstVertex * m_sizeOfVertex, numberOfVertices * m_sizeOfVertex, model.attrBuffer(0));
+    glstate::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Indices stay relative to the model, base vertex moves them to its place in the pool
+    glstate::bindVertexArray(m_vao);
+    if (model.sizeOfIndiceElement() == sizeof(U32)) {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(U32), numberOfIndices * sizeof(U32),
+                        model.indicesData());
+    } else {
+        const U16 * indices = reinterpret_cast<const U16 *>(model.indicesData());
+        const std::vector<U32> widened(indices, indices + numberOfIndices);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(U32), numberOfIndices * sizeof(U32),
+                        &widened[0]);
+    }
+    glstate::bindVertexArray(0);
+
+    mesh.firstVertex = firstVertex;
+    mesh.numberOfVertices = numberOfVertices;
+    mesh.firstIndex = firstIndex;
+    mesh.numberOfIndices = numberOfIndices;
+    mesh.typeOfData = (model.attributeDataMode() == ModelData::TRIANGE_STRIP) ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    ++m_numberOfMeshes;
+    return mesh;
+}
+
+void GeometryPool::remove(PooledMesh & mesh)
+{
+    if (!mesh.valid()) {
+        return;
+    }
+    m_vertices.free(mesh.firstVertex, mesh.numberOfVertices);
+    m_indices.free(mesh.firstIndex, mesh.numberOfIndices);
+    mesh = PooledMesh();
+    --m_numberOfMeshes;
+}
+
+void GeometryPool::bind()
+{
+    glstate::bindVertexArray(m_vao);
+}
+
+void GeometryPool::draw(const PooledMesh & mesh)
+{
+    draw(mesh, mesh.typeOfData);
+}
+
+void GeometryPool::draw(const PooledMesh & mesh, const GL_I customDataType)
+{
+    glDrawElementsBaseVertex(customDataType, static_cast<GLsizei>(mesh.numberOfIndices), GL_UNSIGNED_INT,
+                             (const void *)(mesh.firstIndex * sizeof(U32)), static_cast<GLint>(mesh.firstVertex));
+}
@@ -0,0 +1,213 @@
+#include "stb_gl_profiler.hh"
+
+#include "stb_gl.hh"
+
+#include <algorithm>
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+using namespace stb;
+
+static const size_t QUERIES_PER_ALLOCATION = 64;
+
+static GpuProfiler * activeProfiler = 0;
+
+stb::GpuScopeStatistics::GpuScopeStatistics()
+    : lastMs(0.0),
+      averageMs(0.0),
+      minMs(0.0),
+      maxMs(0.0),
+      callsInLastFrame(0),
+      frames(0)
+{
+    std::fill(history, history + STB_GL_PROFILER_HISTORY, 0.0);
+}
+
+GpuProfiler::GpuProfiler(const size_t framesOfLatency, const size_t maxScopesPerFrame)
+: m_supported(ogl_ext_ARB_timer_query != 0),
+m_framesOfLatency(std::max<size_t>(framesOfLatency, 1)),
+m_maxScopesPerFrame(std::max<size_t>(maxScopesPerFrame, 1)),
+m_frameNumber(0),
+m_inFrame(false),
+m_frameScope(-1),
+m_droppedScopes(0)
+{
+    if (!m_supported) {
+        stb::setError("%s: ARB_timer_query not supported, GPU times are not measured", __FUNCTION__);
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (!m_allQueries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(m_allQueries.size()), &m_allQueries[0]);
+    }
+    if (activeProfiler == this) {
+        activeProfiler = 0;
+    }
+}
+
+GL_U GpuProfiler::takeQuery()
+{
+    if (m_freeQueries.empty()) {
+        const size_t first = m_allQueries.size();
+        m_allQueries.resize(first + QUERIES_PER_ALLOCATION);
+        glGenQueries(QUERIES_PER_ALLOCATION, &m_allQueries[first]);
+        m_freeQueries.assign(m_allQueries.begin() + first, m_allQueries.end());
+    }
+    const GL_U query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+    return query;
+}
+
+size_t GpuProfiler::nameIndex(const char * name)
+{
+    // Literals are found by address, equal names at other addresses by their text
+    const std::map<const char *, size_t>::const_iterator byPointer = m_namesByPointer.find(name);
+    if (byPointer != m_namesByPointer.end()) {
+        return byPointer->second;
+    }
+    const std::string text(name);
+    std::map<std::string, size_t>::const_iterator byString = m_namesByString.find(text);
+    if (byString == m_namesByString.end()) {
+        byString = m_namesByString.insert(std::make_pair(text, m_statistics.size())).first;
+        m_statistics.push_back(GpuScopeStatistics());
+        m_statistics.back().name = text;
+    }
+    m_namesByPointer[name] = byString->second;
+    return byString->second;
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (!m_supported || m_inFrame) {
+        return;
+    }
+    m_inFrame = true;
+    m_current.number = m_frameNumber;
+    m_current.scopes.clear();
+    m_frameScope = beginScope("frame");
+}
+
+I GpuProfiler::beginScope(const char * name)
+{
+    if (!m_supported || !m_inFrame) {
+        return -1;
+    }
+    if (m_current.scopes.size() >= m_maxScopesPerFrame) {
+        ++m_droppedScopes;
+        return -1;
+    }
+    Scope scope;
+    scope.name = nameIndex(name);
+    scope.begin = takeQuery();
+    scope.end = 0;
+    glQueryCounter(scope.begin, GL_TIMESTAMP);
+    m_current.scopes.push_back(scope);
+    return static_cast<I>(m_current.scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(const I scope)
+{
+    if ((scope < 0) || (static_cast<size_t>(scope) >= m_current.scopes.size())
+        || (m_current.scopes[scope].end != 0)) {
+        return;
+    }
+    m_current.scopes[scope].end = takeQuery();
+    glQueryCounter(m_current.scopes[scope].end, GL_TIMESTAMP);
+}
+
+void GpuProfiler::endFrame()
+{
+    if (!m_supported || !m_inFrame) {
+        return;
+    }
+    endScope(m_frameScope);
+    m_inFrame = false;
+    m_pending.push_back(Frame());
+    m_pending.back().number = m_current.number;
+    m_pending.back().scopes.swap(m_current.scopes);
+    ++m_frameNumber;
+
+    while (!m_pending.empty() && (m_pending.front().number + m_framesOfLatency <= m_frameNumber)
+           && collect(m_pending.front())) {
+        m_pending.pop_front();
+    }
+}
+
+bool GpuProfiler::collect(Frame & frame)
+{
+    // Queries complete in order, the frame is done when its end is
+    if (!frame.scopes.empty() && (frame.scopes[0].end != 0)) {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.scopes[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+
+    std::vector<double> milliseconds(m_statistics.size(), 0.0);
+    std::vector<size_t> calls(m_statistics.size(), 0);
+    for (const Scope & scope : frame.scopes) {
+        m_freeQueries.push_back(scope.begin);
+        if (scope.end == 0) {
+            continue;
+        }
+        m_freeQueries.push_back(scope.end);
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(scope.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+        milliseconds[scope.name] += (end > begin) ? static_cast<double>(end - begin) / 1000000.0 : 0.0;
+        ++calls[scope.name];
+    }
+
+    for (size_t i = 0; i < m_statistics.size(); ++i) {
+        if (calls[i] == 0) {
+            continue;
+        }
+        GpuScopeStatistics & statistics = m_statistics[i];
+        statistics.lastMs = milliseconds[i];
+        statistics.callsInLastFrame = calls[i];
+        statistics.history[statistics.frames % STB_GL_PROFILER_HISTORY] = milliseconds[i];
+        ++statistics.frames;
+
+        const size_t samples = std::min<size_t>(statistics.frames, STB_GL_PROFILER_HISTORY);
+        statistics.minMs = *std::min_element(statistics.history, statistics.history + samples);
+        statistics.maxMs = *std::max_element(statistics.history, statistics.history + samples);
+        double sum = 0.0;
+        for (size_t sample = 0; sample < samples; ++sample) {
+            sum += statistics.history[sample];
+        }
+        statistics.averageMs = sum / static_cast<double>(samples);
+    }
+    return true;
+}
+
+std::vector<GpuScopeStatistics> GpuProfiler::statistics() const
+{
+    std::vector<GpuScopeStatistics> all;
+    for (const std::pair<const std::string, size_t> & name : m_namesByString) {
+        all.push_back(m_statistics[name.second]);
+    }
+    return all;
+}
+
+const GpuScopeStatistics * GpuProfiler::statistics(const std::string & name) const
+{
+    const std::map<std::string, size_t>::const_iterator found = m_namesByString.find(name);
+    return (found != m_namesByString.end()) ? &m_statistics[found->second] : 0;
+}
+
+void stb::setActiveGpuProfiler(GpuProfiler * profiler)
+{
+    activeProfiler = profiler;
+}
+
+GpuProfiler * stb::activeGpuProfiler()
+{
+    return activeProfiler;
+}
@@ -1,6 +1,7 @@
 #include "stb_gl_shader.hh"
 
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
 #include "stb_error.hh"
 #include "stb_buffer.hh"
 
@@ -166,7 +167,7 @@ void stb::releaseShader(stb::Shader & s)
     glDeleteShader(shader.vShader());
     glDetachShader(shader.glApp(), shader.fShader());
     glDeleteShader(shader.fShader());
-    glDeleteProgram(shader.glApp());
+    glstate::deletePrograms(1, &shader.glApp());
     shader.glApp() = 0;
     shader.vShader() = 0;
     shader.fShader() = 0;
@@ -239,7 +240,7 @@ exit_failure:
 void stb::activateShader(stb::Shader & s)
 {
     const stb::ShaderAccess shader(s);
-    glUseProgram(shader.glApp());
+    glstate::useProgram(shader.glApp());
 }
 
 GL_U stb::glRef(stb::Shader & s)
@@ -0,0 +1,276 @@
+#include "stb_gl_state.hh"
+
+#include "stb_gl.hh"
+
+#include <algorithm>
+
+using namespace stb;
+using namespace stb::glstate;
+
+namespace
+{
+    // Never a valid name or enum, forces the next call to reach GL
+    const GL_U UNKNOWN = ~static_cast<GL_U>(0);
+
+    const GLenum BUFFER_TARGETS[] = {
+        GL_ARRAY_BUFFER,
+        GL_ELEMENT_ARRAY_BUFFER,
+        GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER,
+        GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER,
+        GL_UNIFORM_BUFFER,
+        GL_TEXTURE_BUFFER,
+        GL_DRAW_INDIRECT_BUFFER
+    };
+    const size_t NUMBER_OF_BUFFER_TARGETS = sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+    const size_t ELEMENT_ARRAY_BUFFER_TARGET = 1;
+
+    const GLenum TEXTURE_TARGETS[] = {
+        GL_TEXTURE_2D,
+        GL_TEXTURE_2D_ARRAY,
+        GL_TEXTURE_3D,
+        GL_TEXTURE_CUBE_MAP,
+        GL_TEXTURE_BUFFER
+    };
+    const size_t NUMBER_OF_TEXTURE_TARGETS = sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+
+    const GLenum CAPABILITIES[] = {
+        GL_BLEND,
+        GL_DEPTH_TEST,
+        GL_CULL_FACE,
+        GL_SCISSOR_TEST,
+        GL_PROGRAM_POINT_SIZE
+    };
+    const size_t NUMBER_OF_CAPABILITIES = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+    struct State
+    {
+        State() { invalidate(); }
+
+        void invalidate()
+        {
+            program = UNKNOWN;
+            vao = UNKNOWN;
+            std::fill(buffers, buffers + NUMBER_OF_BUFFER_TARGETS, UNKNOWN);
+            activeTexture = UNKNOWN;
+            std::fill(&textures[0][0], &textures[0][0] + STB_GL_STATE_MAX_TEXTURE_UNITS * NUMBER_OF_TEXTURE_TARGETS,
+                      UNKNOWN);
+            std::fill(capabilities, capabilities + NUMBER_OF_CAPABILITIES, UNKNOWN);
+            blendSource = UNKNOWN;
+            blendDestination = UNKNOWN;
+            depthFunc = UNKNOWN;
+            depthMask = UNKNOWN;
+            cullFace = UNKNOWN;
+        }
+
+        GL_U program;
+        GL_U vao;
+        GL_U buffers[NUMBER_OF_BUFFER_TARGETS];
+        GL_U activeTexture;
+        GL_U textures[STB_GL_STATE_MAX_TEXTURE_UNITS][NUMBER_OF_TEXTURE_TARGETS];
+        GL_U capabilities[NUMBER_OF_CAPABILITIES];
+        GL_U blendSource;
+        GL_U blendDestination;
+        GL_U depthFunc;
+        GL_U depthMask;
+        GL_U cullFace;
+    };
+
+    State state;
+    Counters counted;
+
+    /*
+     * Stores value and returns true if it differs from the shadowed one, counting either way
+     */
+    bool change(GL_U & shadowed, const GL_U value, const Counter::Type counter)
+    {
+        if (shadowed == value) {
+            ++counted.elided[counter];
+            return false;
+        }
+        shadowed = value;
+        ++counted.issued[counter];
+        return true;
+    }
+
+    size_t indexOf(const GLenum * values, const size_t numberOfValues, const GL_I value)
+    {
+        return std::find(values, values + numberOfValues, static_cast<GLenum>(value)) - values;
+    }
+
+    void forget(GL_U * shadowed, const size_t numberOfShadowed, const size_t count, const GL_U * names)
+    {
+        for (size_t i = 0; i < numberOfShadowed; ++i) {
+            if (std::find(names, names + count, shadowed[i]) != names + count) {
+                shadowed[i] = UNKNOWN;
+            }
+        }
+    }
+
+    void setCapability(const GL_I capability, const bool enabled)
+    {
+        const size_t index = indexOf(CAPABILITIES, NUMBER_OF_CAPABILITIES, capability);
+        if (index == NUMBER_OF_CAPABILITIES) {
+            ++counted.issued[Counter::Capability];
+        } else if (!change(state.capabilities[index], enabled ? 1 : 0, Counter::Capability)) {
+            return;
+        }
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+    }
+}
+
+glstate::Counters::Counters()
+{
+    std::fill(issued, issued + Counter::NumberOfCounters, 0);
+    std::fill(elided, elided + Counter::NumberOfCounters, 0);
+}
+
+void glstate::useProgram(const GL_U program)
+{
+    if (change(state.program, program, Counter::Program)) {
+        glUseProgram(program);
+    }
+}
+
+void glstate::bindVertexArray(const GL_U vao)
+{
+    if (change(state.vao, vao, Counter::VertexArray)) {
+        glBindVertexArray(vao);
+        state.buffers[ELEMENT_ARRAY_BUFFER_TARGET] = UNKNOWN;
+    }
+}
+
+void glstate::bindBuffer(const GL_I target, const GL_U buffer)
+{
+    const size_t index = indexOf(BUFFER_TARGETS, NUMBER_OF_BUFFER_TARGETS, target);
+    if (index == NUMBER_OF_BUFFER_TARGETS) {
+        ++counted.issued[Counter::Buffer];
+        glBindBuffer(target, buffer);
+    } else if (change(state.buffers[index], buffer, Counter::Buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void glstate::activeTexture(const GL_U unit)
+{
+    if (change(state.activeTexture, unit, Counter::ActiveTexture)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void glstate::bindTexture(const GL_I target, const GL_U texture)
+{
+    const size_t index = indexOf(TEXTURE_TARGETS, NUMBER_OF_TEXTURE_TARGETS, target);
+    if ((state.activeTexture >= STB_GL_STATE_MAX_TEXTURE_UNITS) || (index == NUMBER_OF_TEXTURE_TARGETS)) {
+        ++counted.issued[Counter::Texture];
+        glBindTexture(target, texture);
+    } else if (change(state.textures[state.activeTexture][index], texture, Counter::Texture)) {
+        glBindTexture(target, texture);
+    }
+}
+
+void glstate::bindTexture(const GL_U unit, const GL_I target, const GL_U texture)
+{
+    const size_t index = indexOf(TEXTURE_TARGETS, NUMBER_OF_TEXTURE_TARGETS, target);
+    if ((unit < STB_GL_STATE_MAX_TEXTURE_UNITS) && (index != NUMBER_OF_TEXTURE_TARGETS)
+        && (state.textures[unit][index] == texture)) {
+        ++counted.elided[Counter::Texture];
+        return;
+    }
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void glstate::enable(const GL_I capability)
+{
+    setCapability(capability, true);
+}
+
+void glstate::disable(const GL_I capability)
+{
+    setCapability(capability, false);
+}
+
+void glstate::blendFunc(const GL_I sourceFactor, const GL_I destinationFactor)
+{
+    if ((state.blendSource == static_cast<GL_U>(sourceFactor))
+        && (state.blendDestination == static_cast<GL_U>(destinationFactor))) {
+        ++counted.elided[Counter::BlendFunc];
+        return;
+    }
+    state.blendSource = sourceFactor;
+    state.blendDestination = destinationFactor;
+    ++counted.issued[Counter::BlendFunc];
+    glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void glstate::depthFunc(const GL_I function)
+{
+    if (change(state.depthFunc, function, Counter::DepthFunc)) {
+        glDepthFunc(function);
+    }
+}
+
+void glstate::depthMask(const bool write)
+{
+    if (change(state.depthMask, write ? 1 : 0, Counter::DepthMask)) {
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void glstate::cullFace(const GL_I face)
+{
+    if (change(state.cullFace, face, Counter::CullFace)) {
+        glCullFace(face);
+    }
+}
+
+void glstate::deletePrograms(const size_t count, const GL_U * programs)
+{
+    for (size_t i = 0; i < count; ++i) {
+        glDeleteProgram(programs[i]);
+    }
+    forget(&state.program, 1, count, programs);
+}
+
+void glstate::deleteVertexArrays(const size_t count, const GL_U * vaos)
+{
+    glDeleteVertexArrays(static_cast<GLsizei>(count), vaos);
+    const GL_U vao = state.vao;
+    forget(&state.vao, 1, count, vaos);
+    if (state.vao != vao) {
+        state.buffers[ELEMENT_ARRAY_BUFFER_TARGET] = UNKNOWN;
+    }
+}
+
+void glstate::deleteBuffers(const size_t count, const GL_U * buffers)
+{
+    glDeleteBuffers(static_cast<GLsizei>(count), buffers);
+    forget(state.buffers, NUMBER_OF_BUFFER_TARGETS, count, buffers);
+}
+
+void glstate::deleteTextures(const size_t count, const GL_U * textures)
+{
+    glDeleteTextures(static_cast<GLsizei>(count), textures);
+    forget(&state.textures[0][0], STB_GL_STATE_MAX_TEXTURE_UNITS * NUMBER_OF_TEXTURE_TARGETS, count, textures);
+}
+
+void glstate::invalidate()
+{
+    state.invalidate();
+}
+
+const Counters & glstate::counters()
+{
+    return counted;
+}
+
+void glstate::resetCounters()
+{
+    counted = Counters();
+}
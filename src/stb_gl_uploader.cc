@@ -0,0 +1,300 @@
+#include "stb_gl_uploader.hh"
+
+#include "stb_gl.hh"
+#include "stb_gl_state.hh"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace stb;
+
+typedef std::lock_guard<std::mutex> Guard;
+
+stb::TextureUpload::TextureUpload()
+    : width(0),
+      height(0),
+      bytesPerPixel(4),
+      internalFormat(GL_RGBA8),
+      format(GL_RGBA),
+      type(GL_UNSIGNED_BYTE),
+      minFilter(GL_LINEAR),
+      magFilter(GL_LINEAR),
+      wrap(GL_CLAMP_TO_EDGE),
+      mipmaps(false),
+      pixels(0)
+{}
+
+AsyncUploader::AsyncUploader(const MakeCurrent & makeCurrent, const DoneCurrent & doneCurrent, const size_t stagingSize)
+: m_makeCurrent(makeCurrent),
+m_doneCurrent(doneCurrent),
+m_stagingSize(std::max<size_t>(stagingSize, 1)),
+m_stagingBuffer(0),
+m_nextTicket(1),
+m_ready(-1),
+m_stop(false)
+{
+    m_thread = std::thread(&AsyncUploader::run, this);
+}
+
+AsyncUploader::~AsyncUploader()
+{
+    {
+        Guard guard(m_lock);
+        m_stop = true;
+    }
+    m_changed.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool AsyncUploader::ready()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_changed.wait(lock, [this]() { return m_ready != -1; });
+    return m_ready == 1;
+}
+
+AsyncUploader::Ticket AsyncUploader::uploadModel(const ModelData & model)
+{
+    Guard guard(m_lock);
+    m_jobs.push_back(Job());
+    Job & job = m_jobs.back();
+    job.ticket = m_nextTicket++;
+    job.model.push_back(model);
+    m_pending.insert(job.ticket);
+    m_changed.notify_all();
+    return job.ticket;
+}
+
+AsyncUploader::Ticket AsyncUploader::uploadTexture(const TextureUpload & texture)
+{
+    Guard guard(m_lock);
+    m_jobs.push_back(Job());
+    Job & job = m_jobs.back();
+    job.ticket = m_nextTicket++;
+    job.texture = texture;
+    m_pending.insert(job.ticket);
+    m_changed.notify_all();
+    return job.ticket;
+}
+
+size_t AsyncUploader::numberOfPending()
+{
+    Guard guard(m_lock);
+    return m_pending.size();
+}
+
+void AsyncUploader::run()
+{
+    const bool current = m_makeCurrent();
+    {
+        Guard guard(m_lock);
+        m_ready = current ? 1 : 0;
+    }
+    m_changed.notify_all();
+    if (current) {
+        glGenBuffers(1, &m_stagingBuffer);
+    }
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_changed.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop) {
+                break;
+            }
+            job.ticket = m_jobs.front().ticket;
+            job.model.swap(m_jobs.front().model);
+            job.texture = m_jobs.front().texture;
+            m_jobs.pop_front();
+        }
+
+        Finished finished;
+        finished.ticket = job.ticket;
+        finished.failed = !current;
+        finished.fence = 0;
+        finished.texture = 0;
+        if (current) {
+            if (!job.model.empty()) {
+                loadModel(job.model[0], finished);
+                finished.model.swap(job.model);
+            } else {
+                loadTexture(job.texture, finished);
+            }
+            // Flush so that the fence is reached even if loader has nothing more to do
+            finished.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+
+        Guard guard(m_lock);
+        m_finished.push_back(Finished());
+        m_finished.back().ticket = finished.ticket;
+        m_finished.back().failed = finished.failed;
+        m_finished.back().fence = finished.fence;
+        m_finished.back().model.swap(finished.model);
+        m_finished.back().buffers.swap(finished.buffers);
+        m_finished.back().texture = finished.texture;
+    }
+
+    if (current) {
+        // Objects of uploads nobody took are shared, so they can be released here
+        for (Finished & finished : m_finished) {
+            if (finished.fence != 0) {
+                glDeleteSync(static_cast<GLsync>(finished.fence));
+            }
+            if (!finished.buffers.empty()) {
+                glDeleteBuffers(static_cast<GLsizei>(finished.buffers.size()), &finished.buffers[0]);
+            }
+            if (finished.texture != 0) {
+                glDeleteTextures(1, &finished.texture);
+            }
+        }
+        glDeleteBuffers(1, &m_stagingBuffer);
+        glFinish();
+        m_doneCurrent();
+    }
+}
+
+void AsyncUploader::loadModel(const ModelData & model, Finished & finished)
+{
+    // Buffers are filled through the copy target, element array binding would need a vao of this context
+    finished.buffers.resize(model.numberOfAttrBuffers() + 1);
+    glGenBuffers(static_cast<GLsizei>(finished.buffers.size()), &finished.buffers[0]);
+    for (size_t i = 0; i < model.numberOfAttrBuffers(); ++i) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, finished.buffers[i]);
+        glBufferData(GL_COPY_WRITE_BUFFER, model.attrBufferSize(i), model.attrBuffer(i), GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, finished.buffers.back());
+    glBufferData(GL_COPY_WRITE_BUFFER, model.indicesDataSize(), model.indicesData(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void AsyncUploader::loadTexture(const TextureUpload & texture, Finished & finished)
+{
+    const size_t rowSize = texture.width * texture.bytesPerPixel;
+    if ((rowSize == 0) || (texture.height == 0) || (texture.pixels == 0)) {
+        finished.failed = true;
+        return;
+    }
+
+    glGenTextures(1, &finished.texture);
+    glBindTexture(GL_TEXTURE_2D, finished.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.magFilter);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, texture.internalFormat,
+                 static_cast<GLsizei>(texture.width), static_cast<GLsizei>(texture.height), 0,
+                 texture.format, texture.type, 0);
+
+    // Rows are copied into the staging buffer and the texture is filled from it, a band at a time.
+    // Staging buffer is orphaned for every band, so the copy never waits for the previous band.
+    const size_t rowsPerBand = std::max<size_t>(m_stagingSize / rowSize, 1);
+    const char * pixels = static_cast<const char *>(texture.pixels);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingBuffer);
+    for (size_t row = 0; row < texture.height; row += rowsPerBand) {
+        const size_t rows = std::min(rowsPerBand, texture.height - row);
+        const size_t bandSize = rows * rowSize;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bandSize, 0, GL_STREAM_DRAW);
+        void * staged = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bandSize,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (staged != 0) {
+            memcpy(staged, pixels + row * rowSize, bandSize);
+        }
+        if ((staged == 0) || (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)) {
+            finished.failed = true;
+            break;
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(row),
+                        static_cast<GLsizei>(texture.width), static_cast<GLsizei>(rows),
+                        texture.format, texture.type, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (texture.mipmaps && !finished.failed) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool AsyncUploader::takeFinished(const Ticket ticket, Finished & finished, UploadState::Type & state)
+{
+    Guard guard(m_lock);
+    if (m_pending.count(ticket) == 0) {
+        state = UploadState::Failed;
+        return false;
+    }
+    const std::vector<Finished>::iterator found = std::find_if(m_finished.begin(), m_finished.end(),
+        [ticket](const Finished & f) { return f.ticket == ticket; });
+    if (found == m_finished.end()) {
+        state = UploadState::Pending;
+        return false;
+    }
+    if (found->fence != 0) {
+        const GLenum status = glClientWaitSync(static_cast<GLsync>(found->fence), 0, 0);
+        if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED)) {
+            state = UploadState::Pending;
+            return false;
+        }
+        glDeleteSync(static_cast<GLsync>(found->fence));
+    }
+
+    finished.ticket = found->ticket;
+    finished.failed = found->failed;
+    finished.fence = 0;
+    finished.model.swap(found->model);
+    finished.buffers.swap(found->buffers);
+    finished.texture = found->texture;
+    m_finished.erase(found);
+    m_pending.erase(ticket);
+    state = finished.failed ? UploadState::Failed : UploadState::Done;
+    return true;
+}
+
+UploadState::Type AsyncUploader::takeModel(const Ticket ticket,
+                                           VertexArrayObject & vao,
+                                           const ShaderAttributeLayoutInfo & shaderAttributeIndexInfo)
+{
+    Finished finished;
+    UploadState::Type state = UploadState::Pending;
+    if (!takeFinished(ticket, finished, state)) {
+        return state;
+    }
+    if (finished.model.empty() || finished.failed) {
+        if (!finished.buffers.empty()) {
+            glstate::deleteBuffers(finished.buffers.size(), &finished.buffers[0]);
+        }
+        if (finished.texture != 0) {
+            glstate::deleteTextures(1, &finished.texture);
+        }
+        return UploadState::Failed;
+    }
+
+    const GL_U indiceBuffer = finished.buffers.back();
+    finished.buffers.pop_back();
+    initVaoFromBuffers(vao, finished.model[0], shaderAttributeIndexInfo, finished.buffers, indiceBuffer);
+    return UploadState::Done;
+}
+
+UploadState::Type AsyncUploader::takeTexture(const Ticket ticket, GL_U & texture)
+{
+    Finished finished;
+    UploadState::Type state = UploadState::Pending;
+    if (!takeFinished(ticket, finished, state)) {
+        return state;
+    }
+    if (finished.failed || (finished.texture == 0)) {
+        if (!finished.buffers.empty()) {
+            glstate::deleteBuffers(finished.buffers.size(), &finished.buffers[0]);
+        }
+        if (finished.texture != 0) {
+            glstate::deleteTextures(1, &finished.texture);
+        }
+        return UploadState::Failed;
+    }
+    texture = finished.texture;
+    return UploadState::Done;
+}
@@ -0,0 +1,314 @@
+#include "stb_isosurface.hh"
+
+#include "stb_parallel.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+using namespace stb;
+
+static const size_t VALUES_PER_ELEMENT = 6;
+// Layers of cells in one slab, small enough to balance work between workers also for thin volumes
+static const size_t LAYERS_PER_SLAB = 8;
+static const U NUMBER_OF_CORNERS = 8;
+static const U NUMBER_OF_CELL_EDGES = 12;
+
+// Corner i of cell is at x = bit 0, y = bit 1, z = bit 2 of i
+static const U CELL_EDGES[NUMBER_OF_CELL_EDGES][2] = {
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
+namespace
+{
+
+struct Grid
+{
+    size_t samplesX;
+    size_t samplesY;
+    size_t samplesZ;
+    size_t cellsX;
+    size_t cellsY;
+    size_t cellsZ;
+
+    size_t cellIndex(const size_t x, const size_t y, const size_t z) const
+    {
+        return (z * cellsY + y) * cellsX + x;
+    }
+};
+
+/*
+ * Result of one slab of cells before merging
+ */
+struct Slab
+{
+    // Cells having a vertex, in increasing order, vertex i belongs to cells[i]
+    std::vector<size_t> cells;
+    std::vector<float> vertices;
+    // Four cells per quad, counterclockwise seen from outside
+    std::vector<size_t> quads;
+};
+
+}
+
+static bool validSettings(const IsosurfaceSettings & settings)
+{
+    return (settings.samplesX >= 2)
+        && (settings.samplesY >= 2)
+        && (settings.samplesZ >= 2)
+        && (settings.spacing > 0.0f);
+}
+
+static Grid makeGrid(const IsosurfaceSettings & settings)
+{
+    const Grid grid = {
+        settings.samplesX, settings.samplesY, settings.samplesZ,
+        settings.samplesX - (size_t)1, settings.samplesY - (size_t)1, settings.samplesZ - (size_t)1
+    };
+    return grid;
+}
+
+static void addCellVertex(const float (&values)[NUMBER_OF_CORNERS], const size_t x, const size_t y, const size_t z,
+    const IsosurfaceSettings & settings, std::vector<float> & vertices)
+{
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    U crossings = 0;
+    for (U e = 0; e < NUMBER_OF_CELL_EDGES; ++e) {
+        const U a = CELL_EDGES[e][0];
+        const U b = CELL_EDGES[e][1];
+        if ((values[a] < settings.isoLevel) == (values[b] < settings.isoLevel)) {
+            continue;
+        }
+        const float t = (settings.isoLevel - values[a]) / (values[b] - values[a]);
+        for (U c = 0; c < 3; ++c) {
+            const float from = static_cast<float>((a >> c) & 1);
+            const float to = static_cast<float>((b >> c) & 1);
+            sum[c] += from + (to - from) * t;
+        }
+        ++crossings;
+    }
+
+    // Difference between opposite faces of cell
+    float gradient[3] = { 0.0f, 0.0f, 0.0f };
+    for (U i = 0; i < NUMBER_OF_CORNERS; ++i) {
+        for (U c = 0; c < 3; ++c) {
+            gradient[c] += ((i >> c) & 1) ? values[i] : -values[i];
+        }
+    }
+    const float length = std::sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+
+    const float position[3] = {
+        settings.originX + (static_cast<float>(x) + sum[0] / crossings) * settings.spacing,
+        settings.originY + (static_cast<float>(y) + sum[1] / crossings) * settings.spacing,
+        settings.originZ + (static_cast<float>(z) + sum[2] / crossings) * settings.spacing
+    };
+    vertices.insert(vertices.end(), position, position + 3);
+    if (length > 0.0f) {
+        const float normal[3] = { gradient[0] / length, gradient[1] / length, gradient[2] / length };
+        vertices.insert(vertices.end(), normal, normal + 3);
+    } else {
+        const float normal[3] = { 0.0f, 1.0f, 0.0f };
+        vertices.insert(vertices.end(), normal, normal + 3);
+    }
+}
+
+/*
+ * Quad around edge leaving the inside along positive axis when from is set, entering it otherwise.
+ * Cells are given as (u - 1, v - 1), (u, v - 1), (u, v) and (u - 1, v) in the plane of
+ * the two other axes, u following the edge axis in x, y, z order.
+ */
+static void addQuad(const bool from, const size_t c0, const size_t c1, const size_t c2, const size_t c3,
+    std::vector<size_t> & quads)
+{
+    // Counterclockwise when edge leaves the inside, seen from its far end
+    const size_t quad[4] = { c0, c1, c2, c3 };
+    const size_t reversed[4] = { c0, c3, c2, c1 };
+    quads.insert(quads.end(), from ? quad : reversed, (from ? quad : reversed) + 4);
+}
+
+/*
+ * Vertices of cells in layers [firstLayer, lastLayer) and quads of edges whose
+ * cells with highest z are in those layers. Samples hold layers [firstLayer, lastLayer].
+ */
+static void buildSlab(const float * samples, const Grid & grid, const IsosurfaceSettings & settings,
+    const size_t firstLayer, const size_t lastLayer, Slab & slab)
+{
+    const size_t samplesPerLayer = grid.samplesX * grid.samplesY;
+    // Most cells are far from the surface, comparing bytes rejects them before any values are read
+    std::vector<U8> inside((lastLayer - firstLayer + 1) * samplesPerLayer);
+    for (size_t i = 0; i < inside.size(); ++i) {
+        inside[i] = (samples[i] < settings.isoLevel) ? 1 : 0;
+    }
+
+    for (size_t z = firstLayer; z < lastLayer; ++z) {
+        for (size_t y = 0; y < grid.cellsY; ++y) {
+            const size_t row = (z - firstLayer) * samplesPerLayer + y * grid.samplesX;
+            const size_t rows[4] = { row, row + grid.samplesX, row + samplesPerLayer, row + samplesPerLayer + grid.samplesX };
+            // Bit r of column code is inside of sample x on row r, cell is crossed unless its two columns agree
+            auto columnCode = [&](const size_t x) {
+                return inside[rows[0] + x] | (inside[rows[1] + x] << 1) | (inside[rows[2] + x] << 2) | (inside[rows[3] + x] << 3);
+            };
+
+            U left = columnCode(0);
+            for (size_t x = 0; x < grid.cellsX; ++x) {
+                const U right = columnCode(x + 1);
+                if (((left | right) != 0) && ((left & right) != 0xf)) {
+                    float values[NUMBER_OF_CORNERS];
+                    for (U i = 0; i < NUMBER_OF_CORNERS; ++i) {
+                        values[i] = samples[rows[i >> 1] + x + (i & 1)];
+                    }
+                    slab.cells.push_back(grid.cellIndex(x, y, z));
+                    addCellVertex(values, x, y, z, settings, slab.vertices);
+                }
+                left = right;
+            }
+        }
+    }
+
+    // Edges on the outermost samples have less than four cells around them
+    for (size_t z = firstLayer; z < lastLayer; ++z) {
+        for (size_t y = 0; y < grid.samplesY; ++y) {
+            const U8 * here = &inside[(z - firstLayer) * samplesPerLayer + y * grid.samplesX];
+            const bool innerY = (y > 0) && (y < grid.cellsY);
+            for (size_t x = 0; x < grid.samplesX; ++x) {
+                const bool innerX = (x > 0) && (x < grid.cellsX);
+                if ((x < grid.cellsX) && innerY && (z > 0) && (here[x] != here[x + 1])) {
+                    addQuad(here[x] != 0, grid.cellIndex(x, y - 1, z - 1), grid.cellIndex(x, y, z - 1),
+                        grid.cellIndex(x, y, z), grid.cellIndex(x, y - 1, z), slab.quads);
+                }
+                if ((y < grid.cellsY) && innerX && (z > 0) && (here[x] != here[x + grid.samplesX])) {
+                    addQuad(here[x] != 0, grid.cellIndex(x - 1, y, z - 1), grid.cellIndex(x - 1, y, z),
+                        grid.cellIndex(x, y, z), grid.cellIndex(x, y, z - 1), slab.quads);
+                }
+                if (innerX && innerY && (here[x] != here[x + samplesPerLayer])) {
+                    addQuad(here[x] != 0, grid.cellIndex(x - 1, y - 1, z), grid.cellIndex(x, y - 1, z),
+                        grid.cellIndex(x, y, z), grid.cellIndex(x - 1, y, z), slab.quads);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Builds slabs in parallel and merges them. Sampler returns samples of layers
+ * [first, last], either from the buffer it fills or from elsewhere.
+ */
+template <typename Sampler>
+static ModelData extractSurface(const IsosurfaceSettings & settings, const U numberOfThreads, Sampler sampler)
+{
+    const Grid grid = makeGrid(settings);
+    const size_t numberOfSlabs = (grid.cellsZ + LAYERS_PER_SLAB - 1) / LAYERS_PER_SLAB;
+    std::vector<Slab> slabs(numberOfSlabs);
+    parallelFor(numberOfSlabs, numberOfThreads, [&](const size_t s) {
+        const size_t firstLayer = s * LAYERS_PER_SLAB;
+        const size_t lastLayer = std::min(grid.cellsZ, firstLayer + LAYERS_PER_SLAB);
+        std::vector<float> buffer;
+        buildSlab(sampler(firstLayer, lastLayer, buffer), grid, settings, firstLayer, lastLayer, slabs[s]);
+    });
+
+    std::vector<size_t> firstVertex(numberOfSlabs + 1, 0);
+    std::vector<size_t> firstQuad(numberOfSlabs + 1, 0);
+    for (size_t s = 0; s < numberOfSlabs; ++s) {
+        firstVertex[s + 1] = firstVertex[s] + slabs[s].cells.size();
+        firstQuad[s + 1] = firstQuad[s] + slabs[s].quads.size() / 4;
+    }
+    if (firstVertex[numberOfSlabs] > std::numeric_limits<U32>::max()) {
+        stb::setError("%s: Surface has %zu vertices, more than U32 indices can refer to",
+            __FUNCTION__, firstVertex[numberOfSlabs]);
+        return ModelData();
+    }
+
+    const std::shared_ptr<std::vector<float> > attributes
+        = std::make_shared<std::vector<float> >(firstVertex[numberOfSlabs] * VALUES_PER_ELEMENT);
+    const std::shared_ptr<std::vector<U32> > indices
+        = std::make_shared<std::vector<U32> >(firstQuad[numberOfSlabs] * 6);
+    const size_t cellsPerSlab = grid.cellsX * grid.cellsY * LAYERS_PER_SLAB;
+    parallelFor(numberOfSlabs, numberOfThreads, [&](const size_t s) {
+        const Slab & slab = slabs[s];
+        std::copy(slab.vertices.begin(), slab.vertices.end(),
+            attributes->begin() + firstVertex[s] * VALUES_PER_ELEMENT);
+
+        U32 * output = indices->data() + firstQuad[s] * 6;
+        for (size_t q = 0; q < slab.quads.size(); q += 4) {
+            U32 vertex[4];
+            for (U corner = 0; corner < 4; ++corner) {
+                // Cell is either in this slab or in the last layer of the previous one
+                const size_t cell = slab.quads[q + corner];
+                const Slab & owner = slabs[cell / cellsPerSlab];
+                const size_t local = std::lower_bound(owner.cells.begin(), owner.cells.end(), cell) - owner.cells.begin();
+                vertex[corner] = static_cast<U32>(firstVertex[cell / cellsPerSlab] + local);
+            }
+            const U32 triangles[6] = { vertex[0], vertex[1], vertex[2], vertex[0], vertex[2], vertex[3] };
+            output = std::copy(triangles, triangles + 6, output);
+        }
+    });
+
+    ModelData::AttributeData * element = new ModelData::AttributeData(
+        attributes,
+        (const char *)attributes->data(),
+        sizeof(float) * attributes->size(),
+        { 3, 3 },
+        sizeof(float) * VALUES_PER_ELEMENT,
+        ModelData::FLOAT
+        );
+
+    return ModelData(
+        { ModelData::AttributeElement(element) },
+        indices,
+        (const char *)indices->data(),
+        sizeof(U32) * indices->size(),
+        sizeof(U32),
+        ModelData::TRIANGLE
+    );
+}
+
+ModelData stb::generateIsosurface(const DistanceFunction & distance, const IsosurfaceSettings & settings,
+    const U numberOfThreads)
+{
+    if (!distance || !validSettings(settings)) {
+        stb::setError("%s: Invalid isosurface settings, samples %ux%ux%u", __FUNCTION__,
+            settings.samplesX, settings.samplesY, settings.samplesZ);
+        return ModelData();
+    }
+
+    return extractSurface(settings, numberOfThreads,
+        [&](const size_t firstLayer, const size_t lastLayer, std::vector<float> & buffer) {
+            buffer.resize((lastLayer - firstLayer + 1) * settings.samplesX * settings.samplesY);
+            float * sample = buffer.data();
+            // Positions come from sample indices, so that layers shared by two slabs get the same values
+            for (size_t z = firstLayer; z <= lastLayer; ++z) {
+                const float wz = settings.originZ + static_cast<float>(z) * settings.spacing;
+                for (U y = 0; y < settings.samplesY; ++y) {
+                    const float wy = settings.originY + static_cast<float>(y) * settings.spacing;
+                    for (U x = 0; x < settings.samplesX; ++x) {
+                        *sample++ = distance(settings.originX + static_cast<float>(x) * settings.spacing, wy, wz);
+                    }
+                }
+            }
+            return static_cast<const float *>(buffer.data());
+        });
+}
+
+ModelData stb::generateIsosurface(const float * volume, const IsosurfaceSettings & settings,
+    const U numberOfThreads)
+{
+    if (!volume || !validSettings(settings)) {
+        stb::setError("%s: Invalid isosurface settings, samples %ux%ux%u", __FUNCTION__,
+            settings.samplesX, settings.samplesY, settings.samplesZ);
+        return ModelData();
+    }
+
+    return extractSurface(settings, numberOfThreads,
+        [&](const size_t firstLayer, const size_t /*lastLayer*/, std::vector<float> & /*buffer*/) {
+            return volume + firstLayer * settings.samplesX * settings.samplesY;
+        });
+}
@@ -0,0 +1,292 @@
+#include "stb_json.hh"
+
+#include <cstring>
+
+using namespace stb;
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+static const U MAX_DEPTH = 64;
+
+namespace
+{
+
+class Parser
+{
+public:
+    Parser(const char * text, const size_t size, json::Document & document)
+    : m_begin(text), m_p(text), m_end(text + size), m_document(document)
+    {}
+
+    bool parseDocument(void)
+    {
+        m_document.nodes.clear();
+        if (!parseValue(0)) {
+            return false;
+        }
+        skipSpaces();
+        if (m_p != m_end) {
+            return fail("trailing characters");
+        }
+        return true;
+    }
+
+private:
+    bool fail(const char * reason)
+    {
+        stb::setError("json::parse: %s at %zu", reason, (size_t)(m_p - m_begin));
+        return false;
+    }
+
+    void skipSpaces(void)
+    {
+        while ((m_p < m_end) && ((*m_p == ' ') || (*m_p == '\n') || (*m_p == '\r') || (*m_p == '\t'))) {
+            ++m_p;
+        }
+    }
+
+    bool literal(const char * word)
+    {
+        const size_t length = strlen(word);
+        if (((size_t)(m_end - m_p) < length) || (memcmp(m_p, word, length) != 0)) {
+            return fail("unknown literal");
+        }
+        m_p += length;
+        return true;
+    }
+
+    U32 addNode(const json::Type type)
+    {
+        json::Node node;
+        node.type = type;
+        node.number = 0.0;
+        node.text = 0;
+        node.textLength = 0;
+        node.key = 0;
+        node.keyLength = 0;
+        node.numberOfChildren = 0;
+        node.firstChild = json::NO_NODE;
+        node.nextSibling = json::NO_NODE;
+        m_document.nodes.push_back(node);
+        return (U32)(m_document.nodes.size() - 1);
+    }
+
+    bool parseString(const char *& text, size_t & length)
+    {
+        ++m_p; // Opening quote
+        text = m_p;
+        while (m_p < m_end) {
+            if (*m_p == '"') {
+                length = m_p - text;
+                ++m_p;
+                return true;
+            } else if ((*m_p == '\\') && ((m_p + 1) < m_end)) {
+                ++m_p;
+            }
+            ++m_p;
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseNumber(double & value)
+    {
+        bool negative = false;
+        if (*m_p == '-') {
+            negative = true;
+            ++m_p;
+        }
+
+        U64 mantissa = 0;
+        int exponent = 0;
+        bool digits = false;
+        for (; (m_p < m_end) && (*m_p >= '0') && (*m_p <= '9'); ++m_p) {
+            digits = true;
+            if (mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (*m_p - '0');
+            } else {
+                ++exponent;
+            }
+        }
+        if ((m_p < m_end) && (*m_p == '.')) {
+            ++m_p;
+            for (; (m_p < m_end) && (*m_p >= '0') && (*m_p <= '9'); ++m_p) {
+                digits = true;
+                if (mantissa < 100000000000000000ULL) {
+                    mantissa = mantissa * 10 + (*m_p - '0');
+                    --exponent;
+                }
+            }
+        }
+        if (!digits) {
+            return fail("invalid number");
+        }
+        if ((m_p < m_end) && ((*m_p == 'e') || (*m_p == 'E'))) {
+            ++m_p;
+            bool negativeExponent = false;
+            if ((m_p < m_end) && ((*m_p == '-') || (*m_p == '+'))) {
+                negativeExponent = (*m_p == '-');
+                ++m_p;
+            }
+            int e = 0;
+            for (; (m_p < m_end) && (*m_p >= '0') && (*m_p <= '9'); ++m_p) {
+                if (e < 10000) {
+                    e = e * 10 + (*m_p - '0');
+                }
+            }
+            exponent += negativeExponent ? -e : e;
+        }
+
+        double result = (double)mantissa;
+        double scale = 1.0;
+        for (int e = (exponent < 0) ? -exponent : exponent; (e > 0) && (scale < 1e308); --e) {
+            scale *= 10.0;
+        }
+        result = (exponent < 0) ? (result / scale) : (result * scale);
+        value = negative ? -result : result;
+        return true;
+    }
+
+    bool parseContainer(const U32 index, const U depth, const bool object)
+    {
+        const char close = object ? '}' : ']';
+        ++m_p;
+        skipSpaces();
+        if ((m_p < m_end) && (*m_p == close)) {
+            ++m_p;
+            return true;
+        }
+
+        U32 previous = json::NO_NODE;
+        while (true) {
+            const char * key = 0;
+            size_t keyLength = 0;
+            if (object) {
+                skipSpaces();
+                if ((m_p >= m_end) || (*m_p != '"') || !parseString(key, keyLength)) {
+                    return fail("expected key");
+                }
+                skipSpaces();
+                if ((m_p >= m_end) || (*m_p != ':')) {
+                    return fail("expected ':'");
+                }
+                ++m_p;
+            }
+
+            const U32 child = (U32)m_document.nodes.size();
+            if (!parseValue(depth + 1)) {
+                return false;
+            }
+            m_document.nodes[child].key = key;
+            m_document.nodes[child].keyLength = keyLength;
+            if (previous == json::NO_NODE) {
+                m_document.nodes[index].firstChild = child;
+            } else {
+                m_document.nodes[previous].nextSibling = child;
+            }
+            ++m_document.nodes[index].numberOfChildren;
+            previous = child;
+
+            skipSpaces();
+            if (m_p >= m_end) {
+                return fail("unterminated container");
+            } else if (*m_p == ',') {
+                ++m_p;
+            } else if (*m_p == close) {
+                ++m_p;
+                return true;
+            } else {
+                return fail("expected ',' or end of container");
+            }
+        }
+    }
+
+    bool parseValue(const U depth)
+    {
+        if (depth > MAX_DEPTH) {
+            return fail("too deep nesting");
+        }
+        skipSpaces();
+        if (m_p >= m_end) {
+            return fail("unexpected end");
+        }
+
+        switch (*m_p) {
+        case '{':
+            return parseContainer(addNode(json::OBJECT), depth, true);
+        case '[':
+            return parseContainer(addNode(json::ARRAY), depth, false);
+        case '"': {
+            const U32 index = addNode(json::STRING);
+            return parseString(m_document.nodes[index].text, m_document.nodes[index].textLength);
+        }
+        case 't':
+            m_document.nodes[addNode(json::BOOLEAN)].number = 1.0;
+            return literal("true");
+        case 'f':
+            addNode(json::BOOLEAN);
+            return literal("false");
+        case 'n':
+            addNode(json::NUL);
+            return literal("null");
+        default: {
+            const U32 index = addNode(json::NUMBER);
+            return parseNumber(m_document.nodes[index].number);
+        }
+        }
+    }
+
+    const char * m_begin;
+    const char * m_p;
+    const char * m_end;
+    json::Document & m_document;
+};
+
+}
+
+bool json::parse(const char * text, const size_t size, Document & document)
+{
+    Parser parser(text, size, document);
+    return parser.parseDocument();
+}
+
+const json::Node * json::member(const Document & document, const Node & object, const char * key)
+{
+    if (object.type != OBJECT) {
+        return 0;
+    }
+    const size_t keyLength = strlen(key);
+    for (U32 i = object.firstChild; i != NO_NODE; i = document.nodes[i].nextSibling) {
+        const Node & node = document.nodes[i];
+        if ((node.keyLength == keyLength) && (memcmp(node.key, key, keyLength) == 0)) {
+            return &node;
+        }
+    }
+    return 0;
+}
+
+const json::Node * json::element(const Document & document, const Node & array, const size_t index)
+{
+    if ((array.type != ARRAY) || (index >= array.numberOfChildren)) {
+        return 0;
+    }
+    U32 i = array.firstChild;
+    for (size_t n = 0; n < index; ++n) {
+        i = document.nodes[i].nextSibling;
+    }
+    return &document.nodes[i];
+}
+
+double json::numberMember(const Document & document, const Node & object, const char * key, const double defaultValue)
+{
+    const Node * node = member(document, object, key);
+    return ((node != 0) && (node->type == NUMBER)) ? node->number : defaultValue;
+}
+
+bool json::equals(const Node * node, const char * value)
+{
+    return (node != 0) && (node->type == STRING)
+        && (node->textLength == strlen(value)) && (memcmp(node->text, value, node->textLength) == 0);
+}
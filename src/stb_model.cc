@@ -3,10 +3,20 @@
 #include "stb_util.hh"
 #include "stb_types.hh"
 #include "stb_error.hh"
+#include "stb_json.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <iterator>
 #include <cstring>
+#include <climits>
+
+#if defined(STB_LINUX)
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 using namespace stb;
 
@@ -19,10 +29,75 @@ static const size_t SIZE_OF_MODEL_HEADER = 5;
 static const size_t INDEX_VERSION = 0;
 static const size_t INDEX_FORMAT = 1;
 
+// .sm version 2 stores any model, every piece of it padded to SM_ALIGNMENT
+static const U8 SM_VERSION_GENERIC = 2;
+static const size_t SIZE_OF_GENERIC_HEADER = 8;
+static const size_t SM_ALIGNMENT = 4;
+static const char SM_PADDING[SM_ALIGNMENT] = { 0, 0, 0, 0 };
+
+static const U32 GLB_MAGIC = 0x46546C67; // "glTF"
+static const U32 GLB_VERSION = 2;
+static const U32 GLB_CHUNK_JSON = 0x4E4F534A;
+static const U32 GLB_CHUNK_BIN = 0x004E4942;
+static const size_t SIZE_OF_GLB_HEADER = 12;
+static const size_t SIZE_OF_GLB_CHUNK_HEADER = 8;
+static const U32 GLTF_UNSIGNED_BYTE = 5121;
+static const U32 GLTF_UNSIGNED_SHORT = 5123;
+static const U32 GLTF_UNSIGNED_INT = 5125;
+static const U32 GLTF_FLOAT = 5126;
+static const U32 GLTF_TRIANGLES = 4;
+static const U32 GLTF_TRIANGLE_STRIP = 5;
+
+static U32 readU32(const char * p)
+{
+    U32 value = 0;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static ModelData::DataOwner copyToOwner(const char * data, const size_t size)
+{
+    return std::make_shared<const std::string>(data, size);
+}
+
+static const char * ownedData(const ModelData::DataOwner & owner)
+{
+    return static_cast<const std::string *>(owner.get())->data();
+}
+
+ModelData::AttributeData::AttributeData(const char * attrBufferData,
+    const size_t attrBufferDataSize,
+    const ValuesPerAttributeContainer & valuesPerAttr,
+    const size_t sizeOfAttrElement,
+    const AttributeBufferDataType attrDataType)
+    : m_owner(copyToOwner(attrBufferData, attrBufferDataSize)),
+    m_attributeData(ownedData(m_owner)),
+    m_attributeDataSize(attrBufferDataSize),
+    m_valuesPerAttribute(valuesPerAttr),
+    m_sizeOfAttributeElement(sizeOfAttrElement),
+    m_dataType(attrDataType)
+{}
+
+ModelData::AttributeData::AttributeData(const DataOwner & owner,
+    const char * attrBufferData,
+    const size_t attrBufferDataSize,
+    const ValuesPerAttributeContainer & valuesPerAttr,
+    const size_t sizeOfAttrElement,
+    const AttributeBufferDataType attrDataType)
+    : m_owner(owner),
+    m_attributeData(attrBufferData),
+    m_attributeDataSize(attrBufferDataSize),
+    m_valuesPerAttribute(valuesPerAttr),
+    m_sizeOfAttributeElement(sizeOfAttrElement),
+    m_dataType(attrDataType)
+{}
+
 ModelData::ModelData(const ModelData & other)
     : m_attrDataBuffers(other.m_attrDataBuffers),
     m_numberAttributes(other.m_numberAttributes),
-    m_indicesBuffer(other.m_indicesBuffer),
+    m_indicesOwner(other.m_indicesOwner),
+    m_indicesData(other.m_indicesData),
+    m_indicesDataSize(other.m_indicesDataSize),
     m_indiceElementSize(other.m_indiceElementSize),
     m_modeOfAttributeData(other.m_modeOfAttributeData)
 {}
@@ -30,6 +105,8 @@ ModelData::ModelData(const ModelData & other)
 ModelData::ModelData()
 :
 m_numberAttributes(0),
+m_indicesData(""),
+m_indicesDataSize(0),
 m_indiceElementSize(0),
 m_modeOfAttributeData(TRIANGLE)
 {}
@@ -42,7 +119,30 @@ ModelData::ModelData(AttributeElementContainer attrDataBuffers,
     )
     : m_attrDataBuffers(attrDataBuffers),
     m_numberAttributes(0),
-    m_indicesBuffer(indicesBuffer, indicesBufferSize),
+    m_indicesOwner(copyToOwner(indicesBuffer, indicesBufferSize)),
+    m_indicesData(ownedData(m_indicesOwner)),
+    m_indicesDataSize(indicesBufferSize),
+    m_indiceElementSize(indiceElementSize),
+    m_modeOfAttributeData(modeOfAttrData)
+
+{
+    for (AttributeElementContainer::const_iterator it = m_attrDataBuffers.begin(); it != m_attrDataBuffers.end(); ++it) {
+        m_numberAttributes += (*it)->m_valuesPerAttribute.size();
+    }
+}
+
+ModelData::ModelData(AttributeElementContainer attrDataBuffers,
+    const DataOwner & indicesOwner,
+    const char * indicesBuffer,
+    const size_t indicesBufferSize,
+    const size_t indiceElementSize,
+    const ModelData::AttributeDataMode modeOfAttrData
+    )
+    : m_attrDataBuffers(attrDataBuffers),
+    m_numberAttributes(0),
+    m_indicesOwner(indicesOwner),
+    m_indicesData(indicesBuffer),
+    m_indicesDataSize(indicesBufferSize),
     m_indiceElementSize(indiceElementSize),
     m_modeOfAttributeData(modeOfAttrData)
 
@@ -54,12 +154,12 @@ ModelData::ModelData(AttributeElementContainer attrDataBuffers,
 
 const char * ModelData::attrBuffer(const size_t attributeBufferIndex) const
 {
-    return m_attrDataBuffers[attributeBufferIndex]->m_attributeData.c_str();
+    return m_attrDataBuffers[attributeBufferIndex]->m_attributeData;
 }
 
 size_t ModelData::attrBufferSize(const size_t attributeBufferIndex) const
 {
-    return m_attrDataBuffers[attributeBufferIndex]->m_attributeData.size();
+    return m_attrDataBuffers[attributeBufferIndex]->m_attributeDataSize;
 }
 
 size_t ModelData::attrBufferSizeOfElement(const size_t attributeBufferIndex) const
@@ -153,10 +253,114 @@ static stb::ModelData parseVn(const char * buffer, const size_t size)
     );
 }
 
+static size_t paddingOf(const size_t size)
+{
+    return (SM_ALIGNMENT - (size % SM_ALIGNMENT)) % SM_ALIGNMENT;
+}
+
+/*
+ * Parses .sm version 2:
+ * version (1B), mode (1B), size of indice (1B), number of attribute buffers (1B), size of indices (4B),
+ * for each buffer: data type (1B), number of attributes (1B), values per attribute (1B each),
+ * size of element (4B), size of buffer (4B);
+ * then indices and buffers. Header, indices and each buffer are padded to 4 bytes.
+ */
+static stb::ModelData parseGeneric(const char * buffer, const size_t size)
+{
+    const char * end = buffer + size;
+    if (size < SIZE_OF_GENERIC_HEADER) {
+        stb::setError("%s:%u", __FUNCTION__, __LINE__);
+        return stb::ModelData();
+    }
+
+    const U8 mode = (U8)buffer[1];
+    const size_t sizeOfIndice = (U8)buffer[2];
+    const size_t numberOfBuffers = (U8)buffer[3];
+    const size_t sizeOfIndices = readU32(buffer + 4);
+    if ((mode > ModelData::TRIANGE_STRIP) || ((sizeOfIndice != 2) && (sizeOfIndice != 4))
+        || ((sizeOfIndices % sizeOfIndice) != 0)) {
+        stb::setError("%s: Invalid header", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    struct BufferInfo
+    {
+        ModelData::AttributeBufferDataType type;
+        ModelData::ValuesPerAttributeContainer values;
+        size_t sizeOfElement;
+        size_t size;
+    };
+    std::vector<BufferInfo> infos(numberOfBuffers);
+
+    const char * p = buffer + SIZE_OF_GENERIC_HEADER;
+    for (size_t b = 0; b < numberOfBuffers; ++b) {
+        if ((end - p) < 2) {
+            stb::setError("%s:%u", __FUNCTION__, __LINE__);
+            return stb::ModelData();
+        }
+        const U8 type = (U8)p[0];
+        const size_t numberOfAttributes = (U8)p[1];
+        p += 2;
+        if ((type > ModelData::UINT32) || ((size_t)(end - p) < (numberOfAttributes + 8))) {
+            stb::setError("%s:%u", __FUNCTION__, __LINE__);
+            return stb::ModelData();
+        }
+        infos[b].type = (ModelData::AttributeBufferDataType)type;
+        for (size_t a = 0; a < numberOfAttributes; ++a) {
+            infos[b].values.push_back((U8)p[a]);
+        }
+        p += numberOfAttributes;
+        infos[b].sizeOfElement = readU32(p);
+        infos[b].size = readU32(p + 4);
+        p += 8;
+
+        // Every value is four bytes, attributes of an element must fit in it
+        size_t valuesPerElement = 0;
+        for (const size_t values : infos[b].values) {
+            valuesPerElement += values;
+        }
+        if ((infos[b].sizeOfElement == 0) || ((infos[b].size % infos[b].sizeOfElement) != 0)
+            || ((valuesPerElement * 4) > infos[b].sizeOfElement)) {
+            stb::setError("%s: Invalid buffer %zu", __FUNCTION__, b);
+            return stb::ModelData();
+        }
+    }
+    p += paddingOf(p - buffer);
+
+    if ((p > end) || ((size_t)(end - p) < sizeOfIndices)) {
+        stb::setError("%s:%u", __FUNCTION__, __LINE__);
+        return stb::ModelData();
+    }
+    const char * indices = p;
+    p += sizeOfIndices + paddingOf(sizeOfIndices);
+
+    ModelData::AttributeElementContainer attributes;
+    for (size_t b = 0; b < numberOfBuffers; ++b) {
+        if ((p > end) || ((size_t)(end - p) < infos[b].size)) {
+            stb::setError("%s:%u", __FUNCTION__, __LINE__);
+            return stb::ModelData();
+        }
+        attributes.push_back(ModelData::AttributeElement(new ModelData::AttributeData(
+            p,
+            infos[b].size,
+            infos[b].values,
+            infos[b].sizeOfElement,
+            infos[b].type
+            )));
+        p += infos[b].size + paddingOf(infos[b].size);
+    }
+
+    return stb::ModelData(attributes, indices, sizeOfIndices, sizeOfIndice, (ModelData::AttributeDataMode)mode);
+}
+
 stb::ModelData stb::readModel(const char * buffer, const size_t size)
 {
     std::string format(4, ' ');
 
+    if ((size > INDEX_VERSION) && ((U8)*(buffer + INDEX_VERSION) == SM_VERSION_GENERIC)) {
+        return parseGeneric(buffer, size);
+    }
+
     if (size < 5) {
         stb::setError("%s:%u", __FUNCTION__, __LINE__);
         return stb::ModelData();
@@ -179,6 +383,458 @@ stb::ModelData stb::readModel(const char * buffer, const size_t size)
     }
 }
 
+namespace
+{
+
+struct WritePiece
+{
+    const char * data;
+    size_t size;
+};
+
+}
+
+static void addPiece(std::vector<WritePiece> & pieces, const char * data, const size_t size)
+{
+    if (size > 0) {
+        const WritePiece piece = { data, size };
+        pieces.push_back(piece);
+    }
+    if (paddingOf(size) > 0) {
+        const WritePiece padding = { SM_PADDING, paddingOf(size) };
+        pieces.push_back(padding);
+    }
+}
+
+static void appendU32(std::string & header, const U32 value)
+{
+    header.append((const char *)&value, sizeof(value));
+}
+
+/*
+ * Splits serialized model into pieces, which point to header and to model's own buffers
+ */
+static bool modelPieces(const ModelData & model, std::string & header, std::vector<WritePiece> & pieces)
+{
+    if (!model.valid() || (model.numberOfAttrBuffers() > 0xff) || (model.indicesDataSize() > 0xffffffff)) {
+        stb::setError("%s: Model can not be serialized", __FUNCTION__);
+        return false;
+    }
+
+    header.assign(1, (char)SM_VERSION_GENERIC);
+    header += (char)model.attributeDataMode();
+    header += (char)model.sizeOfIndiceElement();
+    header += (char)model.numberOfAttrBuffers();
+    appendU32(header, (U32)model.indicesDataSize());
+
+    for (size_t b = 0; b < model.numberOfAttrBuffers(); ++b) {
+        if ((model.numberOfAttrInBuffer(b) > 0xff)
+            || (model.attrBufferSizeOfElement(b) > 0xffffffff) || (model.attrBufferSize(b) > 0xffffffff)) {
+            stb::setError("%s: Buffer %zu can not be serialized", __FUNCTION__, b);
+            return false;
+        }
+        header += (char)model.attrBufferDataType(b);
+        header += (char)model.numberOfAttrInBuffer(b);
+        for (size_t v = 0; v < model.numberOfAttrInBuffer(b); ++v) {
+            if (model.valuesPerAttribute(b, v) > 0xff) {
+                stb::setError("%s: Buffer %zu can not be serialized", __FUNCTION__, b);
+                return false;
+            }
+            header += (char)model.valuesPerAttribute(b, v);
+        }
+        appendU32(header, (U32)model.attrBufferSizeOfElement(b));
+        appendU32(header, (U32)model.attrBufferSize(b));
+    }
+
+    pieces.clear();
+    addPiece(pieces, header.data(), header.size());
+    addPiece(pieces, model.indicesData(), model.indicesDataSize());
+    for (size_t b = 0; b < model.numberOfAttrBuffers(); ++b) {
+        addPiece(pieces, model.attrBuffer(b), model.attrBufferSize(b));
+    }
+    return true;
+}
+
+size_t stb::writtenModelSize(const ModelData & model)
+{
+    std::string header;
+    std::vector<WritePiece> pieces;
+    if (!modelPieces(model, header, pieces)) {
+        return 0;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        size += pieces[i].size;
+    }
+    return size;
+}
+
+bool stb::writeModel(const ModelData & model, FILE * stream)
+{
+    std::string header;
+    std::vector<WritePiece> pieces;
+    if (!modelPieces(model, header, pieces)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (fwrite(pieces[i].data, 1, pieces[i].size, stream) != pieces[i].size) {
+            stb::setError("%s: Writing failed", __FUNCTION__);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool stb::writeModel(const ModelData & model, char * output, const size_t outputSize)
+{
+    std::string header;
+    std::vector<WritePiece> pieces;
+    if (!modelPieces(model, header, pieces)) {
+        return false;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        size += pieces[i].size;
+    }
+    if (size > outputSize) {
+        stb::setError("%s: Output of %zu bytes is too small for %zu bytes", __FUNCTION__, outputSize, size);
+        return false;
+    }
+
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        memcpy(output, pieces[i].data, pieces[i].size);
+        output += pieces[i].size;
+    }
+    return true;
+}
+
+#if defined(STB_LINUX)
+bool stb::writeModel(const ModelData & model, const char * path)
+{
+    std::string header;
+    std::vector<WritePiece> pieces;
+    if (!modelPieces(model, header, pieces)) {
+        return false;
+    }
+
+    std::vector<struct iovec> vectors(pieces.size());
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        vectors[i].iov_base = const_cast<char *>(pieces[i].data);
+        vectors[i].iov_len = pieces[i].size;
+    }
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        stb::setError("%s: Unable to open %s", __FUNCTION__, path);
+        return false;
+    }
+
+    size_t first = 0;
+    while (first < vectors.size()) {
+        const ssize_t written = writev(fd, &vectors[first], (int)std::min<size_t>(vectors.size() - first, IOV_MAX));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            stb::setError("%s: Writing %s failed", __FUNCTION__, path);
+            return false;
+        }
+
+        // Skip fully written pieces and advance into partially written one
+        size_t remaining = (size_t)written;
+        while ((first < vectors.size()) && (remaining >= vectors[first].iov_len)) {
+            remaining -= vectors[first].iov_len;
+            ++first;
+        }
+        if (remaining > 0) {
+            vectors[first].iov_base = (char *)vectors[first].iov_base + remaining;
+            vectors[first].iov_len -= remaining;
+        }
+    }
+
+    if (close(fd) != 0) {
+        stb::setError("%s: Writing %s failed", __FUNCTION__, path);
+        return false;
+    }
+    return true;
+}
+#else
+bool stb::writeModel(const ModelData & model, const char * path)
+{
+    FILE * stream = fopen(path, "wb");
+    if (stream == 0) {
+        stb::setError("%s: Unable to open %s", __FUNCTION__, path);
+        return false;
+    }
+    const bool written = writeModel(model, stream);
+    if ((fclose(stream) != 0) && written) {
+        stb::setError("%s: Writing %s failed", __FUNCTION__, path);
+        return false;
+    }
+    return written;
+}
+#endif
+
+namespace
+{
+
+/*
+ * Accessor of glTF resolved into binary chunk
+ */
+struct GlbAccessor
+{
+    const char * data;
+    size_t size;
+    size_t stride;
+    size_t values;
+    size_t count;
+    size_t sizeOfComponent;
+    U32 componentType;
+    // Whole stride of last element is in the view, so size is count strides
+    bool padded;
+};
+
+}
+
+static size_t sizeMember(const json::Document & document, const json::Node & object, const char * key, const size_t defaultValue)
+{
+    const double value = json::numberMember(document, object, key, (double)defaultValue);
+    return (value >= 0.0) ? (size_t)value : (size_t)-1;
+}
+
+static size_t valuesOfAccessorType(const json::Node * type)
+{
+    if (json::equals(type, "SCALAR")) {
+        return 1;
+    } else if (json::equals(type, "VEC2")) {
+        return 2;
+    } else if (json::equals(type, "VEC3")) {
+        return 3;
+    } else if (json::equals(type, "VEC4")) {
+        return 4;
+    }
+    return 0;
+}
+
+static size_t sizeOfComponentType(const U32 componentType)
+{
+    switch (componentType) {
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    }
+    return 0;
+}
+
+static bool resolveGlbAccessor(const json::Document & document, const json::Node * index,
+    const char * bin, const size_t binSize, GlbAccessor & accessor)
+{
+    const json::Node * accessors = json::member(document, document.root(), "accessors");
+    const json::Node * node = ((index != 0) && (index->type == json::NUMBER) && (accessors != 0))
+        ? json::element(document, *accessors, (size_t)index->number) : 0;
+    if (node == 0) {
+        stb::setError("%s: Missing accessor", __FUNCTION__);
+        return false;
+    }
+    if (json::member(document, *node, "sparse") != 0) {
+        stb::setError("%s: Sparse accessors are not supported", __FUNCTION__);
+        return false;
+    }
+
+    const json::Node * views = json::member(document, document.root(), "bufferViews");
+    const size_t viewIndex = sizeMember(document, *node, "bufferView", (size_t)-1);
+    const json::Node * view = (views != 0) ? json::element(document, *views, viewIndex) : 0;
+    if (view == 0) {
+        stb::setError("%s: Missing buffer view", __FUNCTION__);
+        return false;
+    }
+    if ((sizeMember(document, *view, "buffer", 0) != 0) || (bin == 0)) {
+        stb::setError("%s: Only binary chunk is supported as buffer", __FUNCTION__);
+        return false;
+    }
+
+    accessor.componentType = (U32)sizeMember(document, *node, "componentType", 0);
+    accessor.sizeOfComponent = sizeOfComponentType(accessor.componentType);
+    accessor.values = valuesOfAccessorType(json::member(document, *node, "type"));
+    accessor.count = sizeMember(document, *node, "count", 0);
+    if ((accessor.sizeOfComponent == 0) || (accessor.values == 0) || (accessor.count == 0) || (accessor.count > 0xffffffff)) {
+        stb::setError("%s: Unsupported accessor", __FUNCTION__);
+        return false;
+    }
+
+    const size_t sizeOfElement = accessor.values * accessor.sizeOfComponent;
+    const size_t viewOffset = sizeMember(document, *view, "byteOffset", 0);
+    const size_t viewLength = sizeMember(document, *view, "byteLength", 0);
+    const size_t offset = sizeMember(document, *node, "byteOffset", 0);
+    accessor.stride = sizeMember(document, *view, "byteStride", sizeOfElement);
+    if ((accessor.stride < sizeOfElement) || (accessor.stride > 252)
+        || (viewOffset > binSize) || (viewLength > (binSize - viewOffset)) || (offset > viewLength)
+        || (sizeOfElement > (viewLength - offset))
+        || ((accessor.count - 1) > ((viewLength - offset - sizeOfElement) / accessor.stride))) {
+        stb::setError("%s: Accessor out of buffer", __FUNCTION__);
+        return false;
+    }
+
+    accessor.data = bin + viewOffset + offset;
+    accessor.size = accessor.stride * accessor.count;
+    accessor.padded = (accessor.count <= ((viewLength - offset) / accessor.stride));
+    return true;
+}
+
+stb::ModelData stb::readGlbModel(const char * buffer, const size_t size, const ModelData::DataOwner & owner)
+{
+    if ((size < (SIZE_OF_GLB_HEADER + SIZE_OF_GLB_CHUNK_HEADER))
+        || (readU32(buffer) != GLB_MAGIC) || (readU32(buffer + 4) != GLB_VERSION)) {
+        stb::setError("%s: Not a binary glTF 2.0", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    const size_t length = std::min<size_t>(readU32(buffer + 8), size);
+    if (length < (SIZE_OF_GLB_HEADER + SIZE_OF_GLB_CHUNK_HEADER)) {
+        stb::setError("%s: Truncated binary glTF", __FUNCTION__);
+        return stb::ModelData();
+    }
+    const char * chunk = buffer + SIZE_OF_GLB_HEADER;
+    const size_t jsonSize = readU32(chunk);
+    if ((readU32(chunk + 4) != GLB_CHUNK_JSON)
+        || (jsonSize > (length - SIZE_OF_GLB_HEADER - SIZE_OF_GLB_CHUNK_HEADER))) {
+        stb::setError("%s: Invalid JSON chunk", __FUNCTION__);
+        return stb::ModelData();
+    }
+    const char * jsonText = chunk + SIZE_OF_GLB_CHUNK_HEADER;
+
+    // Sizes are compared instead of pointers, jsonSize is known to fit in length here
+    const size_t afterJson = length - SIZE_OF_GLB_HEADER - SIZE_OF_GLB_CHUNK_HEADER - jsonSize;
+    const char * bin = 0;
+    size_t binSize = 0;
+    chunk = jsonText + jsonSize;
+    if (afterJson >= SIZE_OF_GLB_CHUNK_HEADER) {
+        binSize = readU32(chunk);
+        if ((readU32(chunk + 4) != GLB_CHUNK_BIN)
+            || (binSize > (afterJson - SIZE_OF_GLB_CHUNK_HEADER))) {
+            stb::setError("%s: Invalid binary chunk", __FUNCTION__);
+            return stb::ModelData();
+        }
+        bin = chunk + SIZE_OF_GLB_CHUNK_HEADER;
+    }
+
+    json::Document document;
+    if (!json::parse(jsonText, jsonSize, document)) {
+        return stb::ModelData();
+    }
+
+    const json::Node * meshes = json::member(document, document.root(), "meshes");
+    const json::Node * mesh = (meshes != 0) ? json::element(document, *meshes, 0) : 0;
+    const json::Node * primitives = (mesh != 0) ? json::member(document, *mesh, "primitives") : 0;
+    const json::Node * primitive = (primitives != 0) ? json::element(document, *primitives, 0) : 0;
+    const json::Node * attributes = (primitive != 0) ? json::member(document, *primitive, "attributes") : 0;
+    if (attributes == 0) {
+        stb::setError("%s: No mesh primitive", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    ModelData::AttributeDataMode mode = ModelData::TRIANGLE;
+    switch (sizeMember(document, *primitive, "mode", GLTF_TRIANGLES)) {
+    case GLTF_TRIANGLES:
+        break;
+    case GLTF_TRIANGLE_STRIP:
+        mode = ModelData::TRIANGE_STRIP;
+        break;
+    default:
+        stb::setError("%s: Unsupported primitive mode", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    // Each accessor is a buffer of its own, so interleaved views are used as they are unless
+    // the view ends before the stride of the last element does
+    static const char * semantics[] = { "POSITION", "NORMAL", "TEXCOORD_0", "TANGENT", "COLOR_0" };
+    ModelData::AttributeElementContainer buffers;
+    size_t numberOfVertices = 0;
+    for (size_t i = 0; i < (sizeof(semantics) / sizeof(semantics[0])); ++i) {
+        const json::Node * index = json::member(document, *attributes, semantics[i]);
+        if (index == 0) {
+            if (i == 0) {
+                stb::setError("%s: Primitive has no POSITION", __FUNCTION__);
+                return stb::ModelData();
+            }
+            continue;
+        }
+
+        GlbAccessor accessor;
+        if (!resolveGlbAccessor(document, index, bin, binSize, accessor)) {
+            return stb::ModelData();
+        }
+        if (accessor.componentType != GLTF_FLOAT) {
+            stb::setError("%s: %s is not float", __FUNCTION__, semantics[i]);
+            return stb::ModelData();
+        }
+        if (i == 0) {
+            numberOfVertices = accessor.count;
+        }
+
+        if (accessor.padded) {
+            buffers.push_back(ModelData::AttributeElement(new ModelData::AttributeData(
+                owner,
+                accessor.data,
+                accessor.size,
+                { accessor.values },
+                accessor.stride,
+                ModelData::FLOAT
+                )));
+            continue;
+        }
+
+        const size_t sizeOfElement = accessor.values * accessor.sizeOfComponent;
+        std::vector<char> tight(accessor.count * sizeOfElement);
+        for (size_t e = 0; e < accessor.count; ++e) {
+            memcpy(&tight[e * sizeOfElement], accessor.data + e * accessor.stride, sizeOfElement);
+        }
+        buffers.push_back(ModelData::AttributeElement(new ModelData::AttributeData(
+            &tight[0],
+            tight.size(),
+            { accessor.values },
+            sizeOfElement,
+            ModelData::FLOAT
+            )));
+    }
+
+    const json::Node * indicesIndex = json::member(document, *primitive, "indices");
+    if (indicesIndex == 0) {
+        std::vector<U32> indices(numberOfVertices);
+        for (size_t i = 0; i < numberOfVertices; ++i) {
+            indices[i] = (U32)i;
+        }
+        return stb::ModelData(buffers, (const char *)&indices[0], indices.size() * sizeof(U32), sizeof(U32), mode);
+    }
+
+    GlbAccessor indices;
+    if (!resolveGlbAccessor(document, indicesIndex, bin, binSize, indices)) {
+        return stb::ModelData();
+    }
+    if ((indices.values != 1) || (indices.stride != indices.sizeOfComponent) || (indices.componentType == GLTF_FLOAT)) {
+        stb::setError("%s: Invalid indices", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    if (indices.componentType == GLTF_UNSIGNED_BYTE) {
+        // GL 3.2 core has byte indices, but ModelData users expect 2 or 4 byte indices
+        std::vector<U16> widened(indices.count);
+        for (size_t i = 0; i < indices.count; ++i) {
+            widened[i] = (U8)indices.data[i];
+        }
+        return stb::ModelData(buffers, (const char *)&widened[0], widened.size() * sizeof(U16), sizeof(U16), mode);
+    }
+
+    return stb::ModelData(buffers, owner, indices.data, indices.size, indices.sizeOfComponent, mode);
+}
 
 void stb::dumpModel(const ModelData & model, FILE * stream)
 {
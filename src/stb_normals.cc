@@ -0,0 +1,279 @@
+#include "stb_normals.hh"
+
+#include "stb_model.hh"
+#include "stb_parallel.hh"
+#include "stb_simd.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+using namespace stb;
+
+static const size_t VALUES_PER_OUTPUT_ELEMENT = 12;
+// Normal, tangent and bitangent sums of a vertex
+static const size_t VALUES_PER_ACCUMULATOR = 9;
+// Below this each worker would not have enough work to pay for its accumulators
+static const size_t MIN_TRIANGLES_PER_WORKER = 4096;
+static const size_t VERTICES_PER_TASK = 4096;
+
+namespace
+{
+
+struct InputLayout
+{
+    const float * attributes;
+    size_t floatsPerElement;
+    size_t uvOffset;
+    bool hasUv;
+    size_t numberOfVertices;
+    const char * indices;
+    size_t sizeOfIndice;
+    size_t numberOfTriangles;
+};
+
+/*
+ * Per face values for up to four triangles at once, one triangle per lane
+ */
+struct FaceBatch
+{
+    float normal[3][4];
+    float tangent[3][4];
+    float bitangent[3][4];
+    float determinant[4];
+};
+
+}
+
+static U32 indiceAt(const InputLayout & input, const size_t i)
+{
+    return (input.sizeOfIndice == sizeof(U16))
+        ? reinterpret_cast<const U16 *>(input.indices)[i]
+        : reinterpret_cast<const U32 *>(input.indices)[i];
+}
+
+static bool readLayout(const ModelData & model, InputLayout & input)
+{
+    if (!model.valid() || (model.attributeDataMode() != ModelData::TRIANGLE)
+        || (model.attrBufferDataType(0) != ModelData::FLOAT) || (model.valuesPerAttribute(0, 0) < 3)
+        || ((model.sizeOfIndiceElement() != sizeof(U16)) && (model.sizeOfIndiceElement() != sizeof(U32)))
+        || ((model.attrBufferSizeOfElement(0) % sizeof(float)) != 0)) {
+        stb::setError("%s: Model is not indexed triangles with float positions", __FUNCTION__);
+        return false;
+    }
+
+    input.attributes = reinterpret_cast<const float *>(model.attrBuffer(0));
+    input.floatsPerElement = model.attrBufferSizeOfElement(0) / sizeof(float);
+    input.hasUv = false;
+    input.uvOffset = 0;
+    for (size_t a = 1; a < model.numberOfAttrInBuffer(0); ++a) {
+        if (model.valuesPerAttribute(0, a) == 2) {
+            input.hasUv = true;
+            input.uvOffset = model.pointerToDataInBuffer(0, a) / sizeof(float);
+            break;
+        }
+    }
+    input.numberOfVertices = model.attrBufferSize(0) / model.attrBufferSizeOfElement(0);
+    input.indices = model.indicesData();
+    input.sizeOfIndice = model.sizeOfIndiceElement();
+    input.numberOfTriangles = model.indicesDataSize() / model.sizeOfIndiceElement() / 3;
+
+    for (size_t i = 0; i < input.numberOfTriangles * 3; ++i) {
+        if (indiceAt(input, i) >= input.numberOfVertices) {
+            stb::setError("%s: Indice %zu refers to vertex %u of %zu", __FUNCTION__, i,
+                indiceAt(input, i), input.numberOfVertices);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void calculateFaces(const float (&position)[3][3][4], const float (&uv)[3][2][4], FaceBatch & faces)
+{
+    using namespace simd;
+    Float4 e1[3], e2[3];
+    for (U c = 0; c < 3; ++c) {
+        const Float4 p0 = load(position[0][c]);
+        e1[c] = sub(load(position[1][c]), p0);
+        e2[c] = sub(load(position[2][c]), p0);
+    }
+
+    // Cross product of edges, its length is twice the area of triangle
+    store(faces.normal[0], sub(mul(e1[1], e2[2]), mul(e1[2], e2[1])));
+    store(faces.normal[1], sub(mul(e1[2], e2[0]), mul(e1[0], e2[2])));
+    store(faces.normal[2], sub(mul(e1[0], e2[1]), mul(e1[1], e2[0])));
+
+    const Float4 du1 = sub(load(uv[1][0]), load(uv[0][0]));
+    const Float4 dv1 = sub(load(uv[1][1]), load(uv[0][1]));
+    const Float4 du2 = sub(load(uv[2][0]), load(uv[0][0]));
+    const Float4 dv2 = sub(load(uv[2][1]), load(uv[0][1]));
+    store(faces.determinant, sub(mul(du1, dv2), mul(du2, dv1)));
+    for (U c = 0; c < 3; ++c) {
+        store(faces.tangent[c], sub(mul(e1[c], dv2), mul(e2[c], dv1)));
+        store(faces.bitangent[c], sub(mul(e2[c], du1), mul(e1[c], du2)));
+    }
+}
+
+/*
+ * Adds face values of triangles [first, last) to vertices in accumulators
+ */
+static void accumulateFaces(const InputLayout & input, const size_t first, const size_t last, float * accumulators)
+{
+    for (size_t t = first; t < last; t += 4) {
+        const size_t lanes = std::min<size_t>(4, last - t);
+        float position[3][3][4] = {};
+        float uv[3][2][4] = {};
+        U32 corners[3][4] = {};
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            for (U corner = 0; corner < 3; ++corner) {
+                const U32 vertex = indiceAt(input, (t + lane) * 3 + corner);
+                const float * element = input.attributes + vertex * input.floatsPerElement;
+                corners[corner][lane] = vertex;
+                for (U c = 0; c < 3; ++c) {
+                    position[corner][c][lane] = element[c];
+                }
+                if (input.hasUv) {
+                    uv[corner][0][lane] = element[input.uvOffset];
+                    uv[corner][1][lane] = element[input.uvOffset + 1];
+                }
+            }
+        }
+
+        FaceBatch faces;
+        calculateFaces(position, uv, faces);
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            // Triangles without uv area do not tell anything about tangent
+            const float scale = (faces.determinant[lane] != 0.0f) ? (1.0f / faces.determinant[lane]) : 0.0f;
+            for (U corner = 0; corner < 3; ++corner) {
+                float * sum = accumulators + corners[corner][lane] * VALUES_PER_ACCUMULATOR;
+                for (U c = 0; c < 3; ++c) {
+                    sum[c] += faces.normal[c][lane];
+                    sum[3 + c] += faces.tangent[c][lane] * scale;
+                    sum[6 + c] += faces.bitangent[c][lane] * scale;
+                }
+            }
+        }
+    }
+}
+
+static float dot3(const float * a, const float * b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static bool normalize3(float * v)
+{
+    const float length = std::sqrt(dot3(v, v));
+    if (!(length > 0.0f)) {
+        return false;
+    }
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+    return true;
+}
+
+/*
+ * Writes normal and tangent of a vertex from summed face values
+ */
+static void finishVertex(const float * sum, float * normal, float * tangent)
+{
+    std::copy(sum, sum + 3, normal);
+    if (!normalize3(normal)) {
+        // Vertex is not part of any triangle with area
+        normal[0] = 0.0f;
+        normal[1] = 1.0f;
+        normal[2] = 0.0f;
+    }
+
+    // Gram-Schmidt, tangent is made perpendicular to normal
+    const float * t = sum + 3;
+    const float * b = sum + 6;
+    const float tn = dot3(t, normal);
+    tangent[0] = t[0] - normal[0] * tn;
+    tangent[1] = t[1] - normal[1] * tn;
+    tangent[2] = t[2] - normal[2] * tn;
+    if (!normalize3(tangent)) {
+        // No uv derivatives, any perpendicular direction does
+        const float axis[3] = { std::abs(normal[0]) < 0.9f ? 1.0f : 0.0f, std::abs(normal[0]) < 0.9f ? 0.0f : 1.0f, 0.0f };
+        const float an = dot3(axis, normal);
+        tangent[0] = axis[0] - normal[0] * an;
+        tangent[1] = axis[1] - normal[1] * an;
+        tangent[2] = axis[2] - normal[2] * an;
+        normalize3(tangent);
+    }
+
+    const float cross[3] = {
+        normal[1] * tangent[2] - normal[2] * tangent[1],
+        normal[2] * tangent[0] - normal[0] * tangent[2],
+        normal[0] * tangent[1] - normal[1] * tangent[0]
+    };
+    tangent[3] = (dot3(cross, b) < 0.0f) ? -1.0f : 1.0f;
+}
+
+ModelData stb::generateNormalsAndTangents(const ModelData & model, const U numberOfThreads)
+{
+    InputLayout input;
+    if (!readLayout(model, input)) {
+        return ModelData();
+    }
+
+    // Each worker sums its range of triangles into its own accumulators, which are then reduced per vertex
+    const size_t workers = std::max<size_t>(1, std::min<size_t>(numberOfWorkers(numberOfThreads),
+        input.numberOfTriangles / MIN_TRIANGLES_PER_WORKER));
+    std::vector<float> accumulators(workers * input.numberOfVertices * VALUES_PER_ACCUMULATOR, 0.0f);
+    parallelFor(workers, numberOfThreads, [&](const size_t w) {
+        accumulateFaces(input, input.numberOfTriangles * w / workers, input.numberOfTriangles * (w + 1) / workers,
+            &accumulators[w * input.numberOfVertices * VALUES_PER_ACCUMULATOR]);
+    });
+
+    const std::shared_ptr<std::vector<float> > output
+        = std::make_shared<std::vector<float> >(input.numberOfVertices * VALUES_PER_OUTPUT_ELEMENT);
+    const size_t numberOfTasks = (input.numberOfVertices + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+    parallelFor(numberOfTasks, numberOfThreads, [&](const size_t task) {
+        const size_t last = std::min(input.numberOfVertices, (task + 1) * VERTICES_PER_TASK);
+        for (size_t v = task * VERTICES_PER_TASK; v < last; ++v) {
+            float sum[VALUES_PER_ACCUMULATOR];
+            std::copy(&accumulators[v * VALUES_PER_ACCUMULATOR], &accumulators[(v + 1) * VALUES_PER_ACCUMULATOR], sum);
+            for (size_t w = 1; w < workers; ++w) {
+                const float * other = &accumulators[(w * input.numberOfVertices + v) * VALUES_PER_ACCUMULATOR];
+                for (size_t i = 0; i < VALUES_PER_ACCUMULATOR; ++i) {
+                    sum[i] += other[i];
+                }
+            }
+
+            const float * element = input.attributes + v * input.floatsPerElement;
+            float * result = &(*output)[v * VALUES_PER_OUTPUT_ELEMENT];
+            std::copy(element, element + 3, result);
+            result[6] = input.hasUv ? element[input.uvOffset] : 0.0f;
+            result[7] = input.hasUv ? element[input.uvOffset + 1] : 0.0f;
+            finishVertex(sum, result + 3, result + 8);
+        }
+    });
+
+    ModelData::AttributeData * element = new ModelData::AttributeData(
+        output,
+        (const char *)output->data(),
+        sizeof(float) * output->size(),
+        { 3, 3, 2, 4 },
+        sizeof(float) * VALUES_PER_OUTPUT_ELEMENT,
+        ModelData::FLOAT
+        );
+
+    return ModelData(
+        { ModelData::AttributeElement(element) },
+        model.indicesOwner(),
+        model.indicesData(),
+        input.numberOfTriangles * 3 * input.sizeOfIndice,
+        input.sizeOfIndice,
+        ModelData::TRIANGLE
+    );
+}
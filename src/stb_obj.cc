@@ -0,0 +1,747 @@
+#include "stb_obj.hh"
+
+#include "stb_model.hh"
+#include "stb_parallel.hh"
+#include "stb_error.hh"
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+using namespace stb;
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+static const size_t VALUES_PER_VERTEX = 4;
+static const size_t VALUES_PER_NORMAL = 3;
+static const size_t VALUES_PER_VN_ATTRIBUTE = VALUES_PER_VERTEX + VALUES_PER_NORMAL;
+static const size_t MIN_BYTES_PER_CHUNK = 256 * 1024;
+static const size_t CHUNKS_PER_THREAD = 4;
+
+static const size_t READ_BLOCK_SIZE = 1024 * 1024;
+static const size_t VALUES_PER_POSITION = 3;
+static const size_t VALUES_PER_UV = 2;
+static const size_t VALUES_PER_VNT_ATTRIBUTE = VALUES_PER_POSITION + VALUES_PER_NORMAL + VALUES_PER_UV;
+static const I64 MISSING_INDEX = -1;
+
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22
+};
+static const int MAX_EXACT_POWER_OF_TEN = 22;
+static const int MAX_MANTISSA_DIGITS = 19;
+
+static inline bool isDigit(const char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static inline const char * skipSpaces(const char * p, const char * end)
+{
+    while ((p < end) && ((*p == ' ') || (*p == '\t'))) {
+        ++p;
+    }
+    return p;
+}
+
+static inline const char * endOfLine(const char * p, const char * end)
+{
+    const char * eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    return (eol != 0) ? eol : end;
+}
+
+const char * stb::parseFloat(const char * begin, const char * end, float & value)
+{
+    const char * p = begin;
+    bool negative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    U64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool foundDigits = false;
+
+    for (; (p < end) && isDigit(*p); ++p) {
+        foundDigits = true;
+        if (digits < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + static_cast<U64>(*p - '0');
+            if (mantissa != 0) {
+                ++digits;
+            }
+        } else {
+            ++exponent;
+        }
+    }
+
+    if ((p < end) && (*p == '.')) {
+        ++p;
+        for (; (p < end) && isDigit(*p); ++p) {
+            foundDigits = true;
+            if (digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + static_cast<U64>(*p - '0');
+                if (mantissa != 0) {
+                    ++digits;
+                }
+                --exponent;
+            }
+        }
+    }
+
+    if (!foundDigits) {
+        return 0;
+    }
+
+    if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+        const char * e = p + 1;
+        bool negativeExponent = false;
+        if ((e < end) && ((*e == '-') || (*e == '+'))) {
+            negativeExponent = (*e == '-');
+            ++e;
+        }
+        if ((e < end) && isDigit(*e)) {
+            int explicitExponent = 0;
+            for (; (e < end) && isDigit(*e); ++e) {
+                if (explicitExponent < 10000) {
+                    explicitExponent = explicitExponent * 10 + (*e - '0');
+                }
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = e;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0) {
+        while (exponent < -MAX_EXACT_POWER_OF_TEN) {
+            result /= POWERS_OF_TEN[MAX_EXACT_POWER_OF_TEN];
+            exponent += MAX_EXACT_POWER_OF_TEN;
+        }
+        while (exponent > MAX_EXACT_POWER_OF_TEN) {
+            result *= POWERS_OF_TEN[MAX_EXACT_POWER_OF_TEN];
+            exponent -= MAX_EXACT_POWER_OF_TEN;
+        }
+        if (exponent < 0) {
+            result /= POWERS_OF_TEN[-exponent];
+        } else {
+            result *= POWERS_OF_TEN[exponent];
+        }
+    }
+
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+static const char * parseInt(const char * p, const char * end, I64 & value)
+{
+    bool negative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+'))) {
+        negative = (*p == '-');
+        ++p;
+    }
+    if ((p >= end) || !isDigit(*p)) {
+        return 0;
+    }
+    I64 result = 0;
+    for (; (p < end) && isDigit(*p); ++p) {
+        result = result * 10 + (*p - '0');
+    }
+    value = negative ? -result : result;
+    return p;
+}
+
+namespace
+{
+    /*
+     * Indices in .obj are either absolute (1-based) or relative to
+     * the number of elements defined so far (negative). Relative ones
+     * are stored relative to start of the chunk and resolved when the
+     * number of elements in earlier chunks is known.
+     */
+    struct ObjCorner
+    {
+        I64 vertex;
+        I64 normal;
+        bool vertexRelative;
+        bool normalRelative;
+    };
+
+    struct ObjChunk
+    {
+        ObjChunk() : begin(0), end(0), errorAt(0) {}
+
+        const char * begin;
+        const char * end;
+        std::vector<float> vertices;
+        std::vector<float> normals;
+        std::vector<ObjCorner> corners;
+        const char * errorAt;
+    };
+
+    struct VnKey
+    {
+        float values[VALUES_PER_VN_ATTRIBUTE];
+
+        bool operator == (const VnKey & other) const
+        {
+            for (size_t i = 0; i < VALUES_PER_VN_ATTRIBUTE; ++i) {
+                if (values[i] != other.values[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    struct VnKeyHash
+    {
+        size_t operator () (const VnKey & key) const
+        {
+            U64 hash = 14695981039346656037ULL;
+            for (size_t i = 0; i < VALUES_PER_VN_ATTRIBUTE; ++i) {
+                // Adding zero maps -0.0 to 0.0 so that values equal by == hash equally
+                const float value = key.values[i] + 0.0f;
+                U32 bits = 0;
+                memcpy(&bits, &value, sizeof(bits));
+                hash = (hash ^ bits) * 1099511628211ULL;
+            }
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+}
+
+static bool parseFaceCorner(const char *& p, const char * end, const ObjChunk & chunk, ObjCorner & corner)
+{
+    I64 value = 0;
+    if ((p = parseInt(p, end, value)) == 0 || value == 0) {
+        return false;
+    }
+    corner.vertexRelative = (value < 0);
+    corner.vertex = (value < 0) ? static_cast<I64>(chunk.vertices.size() / VALUES_PER_VERTEX) + value : value - 1;
+
+    if ((p >= end) || (*p != '/')) {
+        return false; // Normal is required
+    }
+    ++p;
+    if ((p < end) && (*p != '/')) {
+        // Texture coordinate is not part of "vn" format
+        I64 ignored = 0;
+        if ((p = parseInt(p, end, ignored)) == 0) {
+            return false;
+        }
+    }
+    if ((p >= end) || (*p != '/')) {
+        return false;
+    }
+    ++p;
+    if ((p = parseInt(p, end, value)) == 0 || value == 0) {
+        return false;
+    }
+    corner.normalRelative = (value < 0);
+    corner.normal = (value < 0) ? static_cast<I64>(chunk.normals.size() / VALUES_PER_NORMAL) + value : value - 1;
+    return true;
+}
+
+static bool parseLine(const char * p, const char * end, ObjChunk & chunk)
+{
+    p = skipSpaces(p, end);
+    if ((p == end) || (*p == '#')) {
+        return true;
+    }
+
+    if ((end - p > 2) && (p[0] == 'v') && (p[1] == ' ' || p[1] == '\t')) {
+        float values[VALUES_PER_VERTEX] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        size_t i = 0;
+        p += 2;
+        for (; i < VALUES_PER_VERTEX; ++i) {
+            p = skipSpaces(p, end);
+            const char * next = parseFloat(p, end, values[i]);
+            if (next == 0) {
+                break;
+            }
+            p = next;
+        }
+        if (i < 3) {
+            return false;
+        }
+        chunk.vertices.insert(chunk.vertices.end(), values, values + VALUES_PER_VERTEX);
+    } else if ((end - p > 3) && (p[0] == 'v') && (p[1] == 'n') && (p[2] == ' ' || p[2] == '\t')) {
+        float values[VALUES_PER_NORMAL] = { 0.0f, 0.0f, 0.0f };
+        p += 3;
+        for (size_t i = 0; i < VALUES_PER_NORMAL; ++i) {
+            p = skipSpaces(p, end);
+            if ((p = parseFloat(p, end, values[i])) == 0) {
+                return false;
+            }
+        }
+        chunk.normals.insert(chunk.normals.end(), values, values + VALUES_PER_NORMAL);
+    } else if ((end - p > 2) && (p[0] == 'f') && (p[1] == ' ' || p[1] == '\t')) {
+        ObjCorner first = ObjCorner();
+        ObjCorner previous = ObjCorner();
+        size_t numberOfCorners = 0;
+        p += 2;
+        for (p = skipSpaces(p, end); (p < end) && (*p != '\r'); p = skipSpaces(p, end)) {
+            ObjCorner corner = ObjCorner();
+            if (!parseFaceCorner(p, end, chunk, corner)) {
+                return false;
+            }
+            if (numberOfCorners == 0) {
+                first = corner;
+            } else if (numberOfCorners >= 2) {
+                chunk.corners.push_back(first);
+                chunk.corners.push_back(previous);
+                chunk.corners.push_back(corner);
+            }
+            previous = corner;
+            ++numberOfCorners;
+        }
+        if (numberOfCorners < 3) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void parseChunk(ObjChunk & chunk)
+{
+    const char * p = chunk.begin;
+    while (p < chunk.end) {
+        const char * eol = endOfLine(p, chunk.end);
+        if (!parseLine(p, eol, chunk)) {
+            chunk.errorAt = p;
+            return;
+        }
+        p = eol + 1;
+    }
+}
+
+static void splitToChunks(const char * buffer, const size_t size, const U numberOfThreads,
+    std::vector<ObjChunk> & chunks)
+{
+    const size_t maxChunks = std::max<size_t>(1, size / MIN_BYTES_PER_CHUNK);
+    const size_t numberOfChunks = std::min<size_t>(maxChunks, numberOfWorkers(numberOfThreads) * CHUNKS_PER_THREAD);
+    const char * end = buffer + size;
+    const char * p = buffer;
+
+    chunks.resize(numberOfChunks);
+    for (size_t i = 0; i < numberOfChunks; ++i) {
+        const char * chunkEnd = (i + 1 == numberOfChunks) ? end : buffer + (size / numberOfChunks) * (i + 1);
+        if (chunkEnd < p) {
+            chunkEnd = p;
+        }
+        // Chunks always end at a line break so that no line is split
+        chunkEnd = (chunkEnd < end) ? std::min(endOfLine(chunkEnd, end) + 1, end) : end;
+        chunks[i].begin = p;
+        chunks[i].end = chunkEnd;
+        p = chunkEnd;
+    }
+}
+
+static bool resolveIndex(const I64 index, const bool relative, const size_t elementsBeforeChunk,
+    const size_t numberOfElements, size_t & resolved)
+{
+    const I64 absolute = relative ? static_cast<I64>(elementsBeforeChunk) + index : index;
+    if ((absolute < 0) || (static_cast<U64>(absolute) >= numberOfElements)) {
+        return false;
+    }
+    resolved = static_cast<size_t>(absolute);
+    return true;
+}
+
+template<typename T>
+static std::string packIndices(const std::vector<U32> & indices)
+{
+    std::string packed(indices.size() * sizeof(T), ' ');
+    T * output = reinterpret_cast<T *>(&packed[0]);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        output[i] = static_cast<T>(indices[i]);
+    }
+    return packed;
+}
+
+stb::ModelData stb::convertObj(const char * buffer, const size_t size, const U numberOfThreads)
+{
+    std::vector<ObjChunk> chunks;
+    splitToChunks(buffer, size, numberOfThreads, chunks);
+
+    parallelFor(chunks.size(), numberOfThreads, [&chunks](const size_t i) {
+        parseChunk(chunks[i]);
+    });
+
+    std::vector<size_t> verticesBeforeChunk(chunks.size(), 0);
+    std::vector<size_t> normalsBeforeChunk(chunks.size(), 0);
+    size_t numberOfVertices = 0;
+    size_t numberOfNormals = 0;
+    size_t numberOfCorners = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].errorAt != 0) {
+            stb::setError("%s: Invalid line at byte %zu", __FUNCTION__, (size_t)(chunks[i].errorAt - buffer));
+            return stb::ModelData();
+        }
+        verticesBeforeChunk[i] = numberOfVertices;
+        normalsBeforeChunk[i] = numberOfNormals;
+        numberOfVertices += chunks[i].vertices.size() / VALUES_PER_VERTEX;
+        numberOfNormals += chunks[i].normals.size() / VALUES_PER_NORMAL;
+        numberOfCorners += chunks[i].corners.size();
+    }
+
+    if ((numberOfCorners == 0) || (numberOfVertices == 0) || (numberOfNormals == 0)) {
+        stb::setError("%s: No faces, vertices or normals found", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    std::vector<float> vertices(numberOfVertices * VALUES_PER_VERTEX);
+    std::vector<float> normals(numberOfNormals * VALUES_PER_NORMAL);
+    parallelFor(chunks.size(), numberOfThreads, [&](const size_t i) {
+        std::copy(chunks[i].vertices.begin(), chunks[i].vertices.end(),
+            vertices.begin() + verticesBeforeChunk[i] * VALUES_PER_VERTEX);
+        std::copy(chunks[i].normals.begin(), chunks[i].normals.end(),
+            normals.begin() + normalsBeforeChunk[i] * VALUES_PER_NORMAL);
+    });
+
+    // Welding is done in file order so that result does not depend on number of threads
+    std::unordered_map<VnKey, U32, VnKeyHash> welded;
+    welded.reserve(numberOfCorners / 2);
+    std::vector<float> attributes;
+    attributes.reserve(numberOfVertices * VALUES_PER_VN_ATTRIBUTE);
+    std::vector<U32> indices;
+    indices.reserve(numberOfCorners);
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        for (const ObjCorner & corner : chunks[c].corners) {
+            size_t vertexIndex = 0;
+            size_t normalIndex = 0;
+            if (!resolveIndex(corner.vertex, corner.vertexRelative, verticesBeforeChunk[c], numberOfVertices, vertexIndex)
+                || !resolveIndex(corner.normal, corner.normalRelative, normalsBeforeChunk[c], numberOfNormals, normalIndex)) {
+                stb::setError("%s: Face refers to undefined vertex or normal", __FUNCTION__);
+                return stb::ModelData();
+            }
+
+            VnKey key;
+            memcpy(&key.values[0], &vertices[vertexIndex * VALUES_PER_VERTEX], sizeof(float) * VALUES_PER_VERTEX);
+            memcpy(&key.values[VALUES_PER_VERTEX], &normals[normalIndex * VALUES_PER_NORMAL], sizeof(float) * VALUES_PER_NORMAL);
+
+            const U32 nextIndex = static_cast<U32>(attributes.size() / VALUES_PER_VN_ATTRIBUTE);
+            std::pair<std::unordered_map<VnKey, U32, VnKeyHash>::iterator, bool> result
+                = welded.insert(std::make_pair(key, nextIndex));
+            if (result.second) {
+                attributes.insert(attributes.end(), key.values, key.values + VALUES_PER_VN_ATTRIBUTE);
+            }
+            indices.push_back(result.first->second);
+        }
+    }
+
+    const size_t numberOfAttributes = attributes.size() / VALUES_PER_VN_ATTRIBUTE;
+    const size_t sizeOfIndice = (numberOfAttributes <= 0xffff) ? sizeof(U16) : sizeof(U32);
+    const std::string packedIndices = (sizeOfIndice == sizeof(U16))
+        ? packIndices<U16>(indices) : packIndices<U32>(indices);
+
+    stb::ModelData::AttributeData * element = new stb::ModelData::AttributeData(
+        (const char *)&attributes[0],
+        attributes.size() * sizeof(float),
+        { VALUES_PER_VERTEX, VALUES_PER_NORMAL },
+        VALUES_PER_VN_ATTRIBUTE * sizeof(float),
+        stb::ModelData::FLOAT
+        );
+
+    return stb::ModelData(
+        { stb::ModelData::AttributeElement(element) },
+        packedIndices.c_str(),
+        packedIndices.size(),
+        sizeOfIndice,
+        stb::ModelData::TRIANGLE
+        );
+}
+
+namespace
+{
+    struct VntKey
+    {
+        I64 vertex;
+        I64 uv;
+        I64 normal;
+
+        bool operator == (const VntKey & other) const
+        {
+            return (vertex == other.vertex) && (uv == other.uv) && (normal == other.normal);
+        }
+    };
+
+    struct VntKeyHash
+    {
+        size_t operator () (const VntKey & key) const
+        {
+            U64 hash = static_cast<U64>(key.vertex) * 0x9e3779b97f4a7c15ULL;
+            hash ^= static_cast<U64>(key.uv) + 0x7f4a7c159e3779b9ULL + (hash << 6) + (hash >> 2);
+            hash ^= static_cast<U64>(key.normal) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct ObjStream
+    {
+        ObjStream() : missingNormals(false) {}
+
+        std::vector<float> positions;
+        std::vector<float> uvs;
+        std::vector<float> normals;
+        std::unordered_map<VntKey, U32, VntKeyHash> welded;
+        std::vector<float> attributes;
+        std::vector<bool> needsNormal;
+        std::vector<U32> indices;
+        std::vector<U32> polygon;
+        bool missingNormals;
+    };
+}
+
+static bool resolveStreamIndex(const I64 value, const size_t numberOfElements, I64 & resolved)
+{
+    if (value > 0) {
+        resolved = value - 1;
+    } else if (value < 0) {
+        resolved = static_cast<I64>(numberOfElements) + value;
+    } else {
+        return false;
+    }
+    return (resolved >= 0) && (static_cast<U64>(resolved) < numberOfElements);
+}
+
+static bool parseStreamCorner(const char *& p, const char * end, const ObjStream & obj, VntKey & key)
+{
+    I64 value = 0;
+    key.uv = MISSING_INDEX;
+    key.normal = MISSING_INDEX;
+
+    if (((p = parseInt(p, end, value)) == 0)
+        || !resolveStreamIndex(value, obj.positions.size() / VALUES_PER_POSITION, key.vertex)) {
+        return false;
+    }
+    if ((p < end) && (*p == '/')) {
+        ++p;
+        if ((p < end) && (*p != '/')) {
+            if (((p = parseInt(p, end, value)) == 0)
+                || !resolveStreamIndex(value, obj.uvs.size() / VALUES_PER_UV, key.uv)) {
+                return false;
+            }
+        }
+        if ((p < end) && (*p == '/')) {
+            ++p;
+            if (((p = parseInt(p, end, value)) == 0)
+                || !resolveStreamIndex(value, obj.normals.size() / VALUES_PER_NORMAL, key.normal)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static U32 insertCorner(ObjStream & obj, const VntKey & key)
+{
+    const U32 nextIndex = static_cast<U32>(obj.attributes.size() / VALUES_PER_VNT_ATTRIBUTE);
+    std::pair<std::unordered_map<VntKey, U32, VntKeyHash>::iterator, bool> result
+        = obj.welded.insert(std::make_pair(key, nextIndex));
+
+    if (result.second) {
+        float attribute[VALUES_PER_VNT_ATTRIBUTE] = { 0.0f };
+        memcpy(&attribute[0], &obj.positions[key.vertex * VALUES_PER_POSITION], sizeof(float) * VALUES_PER_POSITION);
+        if (key.normal != MISSING_INDEX) {
+            memcpy(&attribute[VALUES_PER_POSITION], &obj.normals[key.normal * VALUES_PER_NORMAL],
+                sizeof(float) * VALUES_PER_NORMAL);
+        } else {
+            obj.missingNormals = true;
+        }
+        if (key.uv != MISSING_INDEX) {
+            memcpy(&attribute[VALUES_PER_POSITION + VALUES_PER_NORMAL], &obj.uvs[key.uv * VALUES_PER_UV],
+                sizeof(float) * VALUES_PER_UV);
+        }
+        obj.attributes.insert(obj.attributes.end(), attribute, attribute + VALUES_PER_VNT_ATTRIBUTE);
+        obj.needsNormal.push_back(key.normal == MISSING_INDEX);
+    }
+    return result.first->second;
+}
+
+static bool parseFloats(const char * p, const char * end, float * values,
+    const size_t minNumberOfValues, const size_t maxNumberOfValues)
+{
+    size_t i = 0;
+    for (; i < maxNumberOfValues; ++i) {
+        p = skipSpaces(p, end);
+        const char * next = parseFloat(p, end, values[i]);
+        if (next == 0) {
+            break;
+        }
+        p = next;
+    }
+    return i >= minNumberOfValues;
+}
+
+static bool parseStreamLine(const char * p, const char * end, ObjStream & obj)
+{
+    p = skipSpaces(p, end);
+    if ((p == end) || (*p == '#')) {
+        return true;
+    }
+
+    if ((end - p > 2) && (p[0] == 'v') && (p[1] == ' ' || p[1] == '\t')) {
+        float values[VALUES_PER_POSITION] = { 0.0f };
+        if (!parseFloats(p + 2, end, values, VALUES_PER_POSITION, VALUES_PER_POSITION)) {
+            return false;
+        }
+        obj.positions.insert(obj.positions.end(), values, values + VALUES_PER_POSITION);
+    } else if ((end - p > 3) && (p[0] == 'v') && (p[1] == 't') && (p[2] == ' ' || p[2] == '\t')) {
+        float values[VALUES_PER_UV] = { 0.0f };
+        if (!parseFloats(p + 3, end, values, 1, VALUES_PER_UV)) {
+            return false;
+        }
+        obj.uvs.insert(obj.uvs.end(), values, values + VALUES_PER_UV);
+    } else if ((end - p > 3) && (p[0] == 'v') && (p[1] == 'n') && (p[2] == ' ' || p[2] == '\t')) {
+        float values[VALUES_PER_NORMAL] = { 0.0f };
+        if (!parseFloats(p + 3, end, values, VALUES_PER_NORMAL, VALUES_PER_NORMAL)) {
+            return false;
+        }
+        obj.normals.insert(obj.normals.end(), values, values + VALUES_PER_NORMAL);
+    } else if ((end - p > 2) && (p[0] == 'f') && (p[1] == ' ' || p[1] == '\t')) {
+        obj.polygon.clear();
+        for (p = skipSpaces(p + 2, end); (p < end) && (*p != '\r'); p = skipSpaces(p, end)) {
+            VntKey key = VntKey();
+            if (!parseStreamCorner(p, end, obj, key)) {
+                return false;
+            }
+            obj.polygon.push_back(insertCorner(obj, key));
+        }
+        if (obj.polygon.size() < 3) {
+            return false;
+        }
+        for (size_t i = 2; i < obj.polygon.size(); ++i) {
+            obj.indices.push_back(obj.polygon[0]);
+            obj.indices.push_back(obj.polygon[i - 1]);
+            obj.indices.push_back(obj.polygon[i]);
+        }
+    }
+    return true;
+}
+
+/*
+ * Vertices without normal get the sum of normals of faces they belong to,
+ * weighted by face area
+ */
+static void calculateMissingNormals(ObjStream & obj)
+{
+    float * attributes = &obj.attributes[0];
+    for (size_t i = 0; i + 2 < obj.indices.size(); i += 3) {
+        float * a = attributes + obj.indices[i] * VALUES_PER_VNT_ATTRIBUTE;
+        float * b = attributes + obj.indices[i + 1] * VALUES_PER_VNT_ATTRIBUTE;
+        float * c = attributes + obj.indices[i + 2] * VALUES_PER_VNT_ATTRIBUTE;
+        const float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        const float n[3] = {
+            e0[1] * e1[2] - e0[2] * e1[1],
+            e0[2] * e1[0] - e0[0] * e1[2],
+            e0[0] * e1[1] - e0[1] * e1[0]
+        };
+        for (size_t corner = 0; corner < 3; ++corner) {
+            const U32 index = obj.indices[i + corner];
+            if (obj.needsNormal[index]) {
+                float * normal = attributes + index * VALUES_PER_VNT_ATTRIBUTE + VALUES_PER_POSITION;
+                normal[0] += n[0];
+                normal[1] += n[1];
+                normal[2] += n[2];
+            }
+        }
+    }
+
+    for (size_t index = 0; index < obj.needsNormal.size(); ++index) {
+        if (obj.needsNormal[index]) {
+            float * normal = attributes + index * VALUES_PER_VNT_ATTRIBUTE + VALUES_PER_POSITION;
+            const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length > 0.0f) {
+                normal[0] /= length;
+                normal[1] /= length;
+                normal[2] /= length;
+            }
+        }
+    }
+}
+
+stb::ModelData stb::readObjModel(FILE * stream)
+{
+    ObjStream obj;
+    std::vector<char> block(READ_BLOCK_SIZE);
+    size_t carried = 0;
+    size_t lineNumber = 1;
+
+    for (;;) {
+        const size_t readBytes = fread(&block[carried], 1, block.size() - carried, stream);
+        if (ferror(stream)) {
+            stb::setError("%s: Reading stream failed", __FUNCTION__);
+            return stb::ModelData();
+        }
+
+        const bool lastBlock = (readBytes == 0);
+        const char * begin = &block[0];
+        const char * end = begin + carried + readBytes;
+        const char * processedEnd = end;
+
+        if (!lastBlock) {
+            while ((processedEnd > begin) && (*(processedEnd - 1) != '\n')) {
+                --processedEnd;
+            }
+            if (processedEnd == begin) {
+                stb::setError("%s: Line %zu is longer than %zu bytes", __FUNCTION__, lineNumber, READ_BLOCK_SIZE);
+                return stb::ModelData();
+            }
+        }
+
+        for (const char * p = begin; p < processedEnd; ++lineNumber) {
+            const char * eol = endOfLine(p, processedEnd);
+            if (!parseStreamLine(p, eol, obj)) {
+                stb::setError("%s: Invalid line %zu", __FUNCTION__, lineNumber);
+                return stb::ModelData();
+            }
+            p = eol + 1;
+        }
+
+        if (lastBlock) {
+            break;
+        }
+        carried = end - processedEnd;
+        memmove(&block[0], processedEnd, carried);
+    }
+
+    if (obj.indices.empty()) {
+        stb::setError("%s: No faces found", __FUNCTION__);
+        return stb::ModelData();
+    }
+
+    if (obj.missingNormals) {
+        calculateMissingNormals(obj);
+    }
+
+    const size_t numberOfAttributes = obj.attributes.size() / VALUES_PER_VNT_ATTRIBUTE;
+    const size_t sizeOfIndice = (numberOfAttributes <= 0xffff) ? sizeof(U16) : sizeof(U32);
+    const std::string packedIndices = (sizeOfIndice == sizeof(U16))
+        ? packIndices<U16>(obj.indices) : packIndices<U32>(obj.indices);
+
+    stb::ModelData::AttributeData * element = new stb::ModelData::AttributeData(
+        (const char *)&obj.attributes[0],
+        obj.attributes.size() * sizeof(float),
+        { VALUES_PER_POSITION, VALUES_PER_NORMAL, VALUES_PER_UV },
+        VALUES_PER_VNT_ATTRIBUTE * sizeof(float),
+        stb::ModelData::FLOAT
+        );
+
+    return stb::ModelData(
+        { stb::ModelData::AttributeElement(element) },
+        packedIndices.c_str(),
+        packedIndices.size(),
+        sizeOfIndice,
+        stb::ModelData::TRIANGLE
+        );
+}
@@ -0,0 +1,56 @@
+#include "stb_radix_sort.hh"
+
+#include <cassert>
+#include <cstring>
+
+using namespace stb;
+
+static const size_t RADIX_BITS = 8;
+static const size_t RADIX_BUCKETS = 1 << RADIX_BITS;
+static const size_t RADIX_PASSES = sizeof(U64) * 8 / RADIX_BITS;
+
+void stb::radixSort(std::vector<U64> & keys,
+                    std::vector<U32> & values,
+                    std::vector<U64> & scratchKeys,
+                    std::vector<U32> & scratchValues)
+{
+    assert(keys.size() == values.size());
+    const size_t n = keys.size();
+    if (n < 2) {
+        return;
+    }
+    scratchKeys.resize(n);
+    scratchValues.resize(n);
+
+    // Histograms of every pass from a single read of keys
+    size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; ++i) {
+        const U64 key = keys[i];
+        for (size_t pass = 0; pass < RADIX_PASSES; ++pass) {
+            ++counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+        }
+    }
+
+    for (size_t pass = 0; pass < RADIX_PASSES; ++pass) {
+        size_t * count = counts[pass];
+        const size_t shift = pass * RADIX_BITS;
+        if (count[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == n) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+            const size_t bucketSize = count[bucket];
+            count[bucket] = offset;
+            offset += bucketSize;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const size_t to = count[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            scratchKeys[to] = keys[i];
+            scratchValues[to] = values[i];
+        }
+        keys.swap(scratchKeys);
+        values.swap(scratchValues);
+    }
+}
@@ -0,0 +1,167 @@
+#include "stb_render_queue.hh"
+
+#include "stb_gl.hh"
+#include "stb_gl_state.hh"
+#include "stb_radix_sort.hh"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace stb;
+
+static const U64 PASS_BITS = 4;
+static const U64 PROGRAM_BITS = 12;
+static const U64 TEXTURE_BITS = 16;
+static const U64 VAO_BITS = 16;
+static const U64 DEPTH_BITS = 16;
+static const U64 BLENDED_DEPTH_BITS = 24;
+static const U64 BLENDED_STATE_BITS = 12;
+
+static_assert(PASS_BITS + PROGRAM_BITS + TEXTURE_BITS + VAO_BITS + DEPTH_BITS == 64,
+              "Assumption failed: Fields of sort key do not fill 64 bits");
+static_assert(PASS_BITS + BLENDED_DEPTH_BITS + 3 * BLENDED_STATE_BITS == 64,
+              "Assumption failed: Fields of depth sort key do not fill 64 bits");
+
+static U64 field(const U64 value, const U64 bits)
+{
+    return value & ((static_cast<U64>(1) << bits) - 1);
+}
+
+static U64 quantizeDepth(const float depth, const U64 bits)
+{
+    const U64 largest = (static_cast<U64>(1) << bits) - 1;
+    const float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+    return static_cast<U64>(clamped * static_cast<float>(largest));
+}
+
+U64 stb::makeSortKey(const U pass, const GL_U program, const GL_U texture, const GL_U vao, const float depth)
+{
+    U64 key = field(pass, PASS_BITS);
+    key = (key << PROGRAM_BITS) | field(program, PROGRAM_BITS);
+    key = (key << TEXTURE_BITS) | field(texture, TEXTURE_BITS);
+    key = (key << VAO_BITS) | field(vao, VAO_BITS);
+    key = (key << DEPTH_BITS) | quantizeDepth(depth, DEPTH_BITS);
+    return key;
+}
+
+U64 stb::makeDepthSortKey(const U pass, const float depth, const GL_U program, const GL_U texture, const GL_U vao)
+{
+    const U64 farthestFirst = field(~quantizeDepth(depth, BLENDED_DEPTH_BITS), BLENDED_DEPTH_BITS);
+    U64 key = field(pass, PASS_BITS);
+    key = (key << BLENDED_DEPTH_BITS) | farthestFirst;
+    key = (key << BLENDED_STATE_BITS) | field(program, BLENDED_STATE_BITS);
+    key = (key << BLENDED_STATE_BITS) | field(texture, BLENDED_STATE_BITS);
+    key = (key << BLENDED_STATE_BITS) | field(vao, BLENDED_STATE_BITS);
+    return key;
+}
+
+stb::RenderCommand::RenderCommand()
+    : key(0),
+      program(0),
+      vao(0),
+      texture(0),
+      textureUnit(0),
+      typeOfData(GL_TRIANGLES),
+      indiceElementSizeGlEnum(GL_UNSIGNED_INT),
+      numberOfIndices(0),
+      firstIndex(0),
+      baseVertex(0),
+      numberOfInstances(0),
+      matrixLocation(-1)
+{
+    std::fill(matrix, matrix + 16, 0.0f);
+}
+
+RenderCommand stb::makeRenderCommand(const U64 key, const GL_U program, VertexArrayObject & vao)
+{
+    const VaoDrawInfo info = drawInfo(vao);
+    RenderCommand command;
+    command.key = key;
+    command.program = program;
+    command.vao = info.vao;
+    command.typeOfData = info.typeOfData;
+    command.indiceElementSizeGlEnum = info.indiceElementSizeGlEnum;
+    command.numberOfIndices = info.numberOfIndices;
+    command.numberOfInstances = info.numberOfInstances;
+    return command;
+}
+
+RenderQueue::RenderQueue(const size_t numberOfBuffers)
+: m_buffers(std::max<size_t>(numberOfBuffers, 1))
+{}
+
+void RenderQueue::setNumberOfBuffers(const size_t numberOfBuffers)
+{
+    m_buffers.resize(std::max<size_t>(numberOfBuffers, 1));
+}
+
+void RenderQueue::clear()
+{
+    for (RenderCommands & commands : m_buffers) {
+        commands.clear();
+    }
+    m_firstOfBuffer.clear();
+    m_keys.clear();
+    m_order.clear();
+}
+
+size_t RenderQueue::sort()
+{
+    m_firstOfBuffer.resize(m_buffers.size() + 1);
+    size_t numberOfCommands = 0;
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        m_firstOfBuffer[i] = numberOfCommands;
+        numberOfCommands += m_buffers[i].size();
+    }
+    m_firstOfBuffer.back() = numberOfCommands;
+
+    // Only keys and indices of commands move while sorting, commands stay in their buffers
+    m_keys.resize(numberOfCommands);
+    m_order.resize(numberOfCommands);
+    size_t index = 0;
+    for (const RenderCommands & commands : m_buffers) {
+        for (const RenderCommand & command : commands) {
+            m_keys[index] = command.key;
+            m_order[index] = static_cast<U32>(index);
+            ++index;
+        }
+    }
+    radixSort(m_keys, m_order, m_scratchKeys, m_scratchOrder);
+    return numberOfCommands;
+}
+
+const RenderCommand & RenderQueue::sortedCommand(const size_t index) const
+{
+    assert(index < m_order.size());
+    const size_t command = m_order[index];
+    const size_t buffer = std::upper_bound(m_firstOfBuffer.begin(), m_firstOfBuffer.end() - 1, command)
+        - m_firstOfBuffer.begin() - 1;
+    return m_buffers[buffer][command - m_firstOfBuffer[buffer]];
+}
+
+void RenderQueue::execute()
+{
+    const size_t numberOfCommands = sort();
+    for (size_t i = 0; i < numberOfCommands; ++i) {
+        const RenderCommand & command = sortedCommand(i);
+        glstate::useProgram(command.program);
+        if (command.texture != 0) {
+            glstate::bindTexture(command.textureUnit, GL_TEXTURE_2D, command.texture);
+        }
+        glstate::bindVertexArray(command.vao);
+        if (command.matrixLocation != -1) {
+            glUniformMatrix4fv(command.matrixLocation, 1, GL_FALSE, command.matrix);
+        }
+
+        const size_t sizeOfIndice = (command.indiceElementSizeGlEnum == GL_UNSIGNED_SHORT) ? 2 : 4;
+        const void * firstIndex = (const void *)(command.firstIndex * sizeOfIndice);
+        if (command.numberOfInstances != 0) {
+            glDrawElementsInstancedBaseVertex(command.typeOfData, command.numberOfIndices,
+                                              command.indiceElementSizeGlEnum, firstIndex,
+                                              command.numberOfInstances, command.baseVertex);
+        } else {
+            glDrawElementsBaseVertex(command.typeOfData, command.numberOfIndices, command.indiceElementSizeGlEnum,
+                                     firstIndex, command.baseVertex);
+        }
+    }
+}
@@ -0,0 +1,394 @@
+#include "stb_terrain.hh"
+
+#include "stb_simd.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace stb
+{
+    extern void setError(const char * format, ...);
+}
+
+using namespace stb;
+
+typedef std::unique_lock<std::mutex> Lock;
+
+static const size_t VALUES_PER_ELEMENT = 8;
+static const U NUMBER_OF_SKIRTS = 4;
+
+float stb::sampleHeightmap(const float * heights, const U width, const U depth, const float spacing,
+    const float x, const float z)
+{
+    const float maxX = static_cast<float>(width - 1);
+    const float maxZ = static_cast<float>(depth - 1);
+    const float fx = std::min(std::max(x / spacing, 0.0f), maxX);
+    const float fz = std::min(std::max(z / spacing, 0.0f), maxZ);
+    const U x0 = std::min(static_cast<U>(fx), width - 1);
+    const U z0 = std::min(static_cast<U>(fz), depth - 1);
+    const U x1 = std::min(x0 + 1, width - 1);
+    const U z1 = std::min(z0 + 1, depth - 1);
+    const float tx = fx - static_cast<float>(x0);
+    const float tz = fz - static_cast<float>(z0);
+
+    const float top = heights[z0 * width + x0] + (heights[z0 * width + x1] - heights[z0 * width + x0]) * tx;
+    const float bottom = heights[z1 * width + x0] + (heights[z1 * width + x1] - heights[z1 * width + x0]) * tx;
+    return top + (bottom - top) * tz;
+}
+
+/*
+ * Pseudo random value in [-1, 1] for a lattice point
+ */
+static float latticeValue(const I x, const I z, const U32 seed)
+{
+    U32 h = static_cast<U32>(x) * 374761393u + static_cast<U32>(z) * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return static_cast<float>(h & 0xffffff) / static_cast<float>(0xffffff) * 2.0f - 1.0f;
+}
+
+static float valueNoise(const float x, const float z, const U32 seed)
+{
+    const float fx = std::floor(x);
+    const float fz = std::floor(z);
+    const I x0 = static_cast<I>(fx);
+    const I z0 = static_cast<I>(fz);
+    // Smoothstep hides the lattice
+    const float tx = (x - fx) * (x - fx) * (3.0f - 2.0f * (x - fx));
+    const float tz = (z - fz) * (z - fz) * (3.0f - 2.0f * (z - fz));
+
+    const float top = latticeValue(x0, z0, seed) + (latticeValue(x0 + 1, z0, seed) - latticeValue(x0, z0, seed)) * tx;
+    const float bottom = latticeValue(x0, z0 + 1, seed) + (latticeValue(x0 + 1, z0 + 1, seed) - latticeValue(x0, z0 + 1, seed)) * tx;
+    return top + (bottom - top) * tz;
+}
+
+float stb::fractalNoise(const float x, const float z, const U octaves, const U32 seed)
+{
+    float sum = 0.0f;
+    float amplitude = 0.5f;
+    float frequency = 1.0f;
+    for (U i = 0; i < octaves; ++i) {
+        sum += amplitude * valueNoise(x * frequency, z * frequency, seed + i);
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    return sum;
+}
+
+static bool validSettings(const TerrainSettings & settings)
+{
+    return (settings.resolution > 0)
+        && (settings.levelsOfDetail > 0)
+        && (settings.levelsOfDetail <= 16)
+        && ((settings.resolution % (1u << (settings.levelsOfDetail - 1))) == 0)
+        && (settings.chunkSize > 0.0f);
+}
+
+/*
+ * Normals of one row of vertices from central differences of heights around them,
+ * heights has one sample wide border around vertices. Four normals are calculated at once,
+ * remaining ones with same operations one at a time.
+ */
+static void calculateNormalRow(const float * heights, const size_t heightsPerRow, const U numberOfVertices,
+    const float spacing, float * attributes)
+{
+    const float * up = heights + 1;
+    const float * left = heights + heightsPerRow;
+    const float * right = heights + heightsPerRow + 2;
+    const float * down = heights + 2 * heightsPerRow + 1;
+
+    U i = 0;
+    const simd::Float4 ny = simd::set1(2.0f * spacing);
+    for (; (i + 4) <= numberOfVertices; i += 4) {
+        const simd::Float4 nx = simd::sub(simd::load(left + i), simd::load(right + i));
+        const simd::Float4 nz = simd::sub(simd::load(up + i), simd::load(down + i));
+        const simd::Float4 length = simd::sqrt(simd::add(simd::add(simd::mul(nx, nx), simd::mul(ny, ny)), simd::mul(nz, nz)));
+
+        float x[4], y[4], z[4];
+        simd::store(x, simd::div(nx, length));
+        simd::store(y, simd::div(ny, length));
+        simd::store(z, simd::div(nz, length));
+        for (U k = 0; k < 4; ++k) {
+            float * normal = attributes + (i + k) * VALUES_PER_ELEMENT + 3;
+            normal[0] = x[k];
+            normal[1] = y[k];
+            normal[2] = z[k];
+        }
+    }
+    for (; i < numberOfVertices; ++i) {
+        const float nx = left[i] - right[i];
+        const float nyScalar = 2.0f * spacing;
+        const float nz = up[i] - down[i];
+        const float length = std::sqrt(((nx * nx) + (nyScalar * nyScalar)) + (nz * nz));
+        float * normal = attributes + i * VALUES_PER_ELEMENT + 3;
+        normal[0] = nx / length;
+        normal[1] = nyScalar / length;
+        normal[2] = nz / length;
+    }
+}
+
+/*
+ * Two triangles between edge vertices e0, e1 and skirt vertices s0, s1 below them,
+ * flipped on sides where e0 to e1 runs the other way around the chunk
+ */
+static void addSkirtQuad(std::vector<U32> & indices, const U32 e0, const U32 e1, const U32 s0, const U32 s1, const bool flip)
+{
+    const U32 quad[6] = { e0, s0, e1, e1, s0, s1 };
+    const U32 flipped[6] = { e0, e1, s0, e1, s1, s0 };
+    indices.insert(indices.end(), flip ? flipped : quad, (flip ? flipped : quad) + 6);
+}
+
+static void addLodIndices(const U resolution, const U level, std::vector<U32> & indices)
+{
+    const U step = 1u << level;
+    const U32 verticesPerRow = resolution + 1;
+    const U32 firstSkirtVertex = verticesPerRow * verticesPerRow;
+
+    for (U row = 0; row < resolution; row += step) {
+        for (U column = 0; column < resolution; column += step) {
+            const U32 topLeft = row * verticesPerRow + column;
+            const U32 bottomLeft = topLeft + step * verticesPerRow;
+            const U32 quad[6] = { topLeft, bottomLeft, topLeft + step, topLeft + step, bottomLeft, bottomLeft + step };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    // Sides are z = 0, z = max, x = 0 and x = max, skirt vertices follow the side in the same order
+    for (U k = 0; k < resolution; k += step) {
+        const U32 skirt[NUMBER_OF_SKIRTS] = {
+            firstSkirtVertex + k,
+            firstSkirtVertex + verticesPerRow + k,
+            firstSkirtVertex + 2 * verticesPerRow + k,
+            firstSkirtVertex + 3 * verticesPerRow + k
+        };
+        addSkirtQuad(indices, k, k + step, skirt[0], skirt[0] + step, true);
+        addSkirtQuad(indices, resolution * verticesPerRow + k, resolution * verticesPerRow + k + step,
+            skirt[1], skirt[1] + step, false);
+        addSkirtQuad(indices, k * verticesPerRow, (k + step) * verticesPerRow, skirt[2], skirt[2] + step, false);
+        addSkirtQuad(indices, k * verticesPerRow + resolution, (k + step) * verticesPerRow + resolution,
+            skirt[3], skirt[3] + step, true);
+    }
+}
+
+ModelData stb::generateTerrainChunk(const TerrainSettings & settings, const HeightFunction & height,
+    const TerrainChunkCoordinate & coordinate, std::vector<TerrainLod> & lods)
+{
+    lods.clear();
+    if (!validSettings(settings)) {
+        stb::setError("%s: Invalid terrain settings, resolution %u, levels of detail %u",
+            __FUNCTION__, settings.resolution, settings.levelsOfDetail);
+        return ModelData();
+    }
+
+    const U resolution = settings.resolution;
+    const U verticesPerRow = resolution + 1;
+    const size_t heightsPerRow = resolution + 3;
+    const float spacing = settings.chunkSize / static_cast<float>(resolution);
+    // Positions come from global sample indices, so that neighbouring chunks get exactly the same border
+    const I64 firstSampleX = static_cast<I64>(coordinate.x) * resolution - 1;
+    const I64 firstSampleZ = static_cast<I64>(coordinate.z) * resolution - 1;
+
+    std::vector<float> heights(heightsPerRow * heightsPerRow);
+    for (size_t j = 0; j < heightsPerRow; ++j) {
+        for (size_t i = 0; i < heightsPerRow; ++i) {
+            heights[j * heightsPerRow + i] = height(static_cast<float>(firstSampleX + static_cast<I64>(i)) * spacing,
+                static_cast<float>(firstSampleZ + static_cast<I64>(j)) * spacing);
+        }
+    }
+
+    const size_t numberOfGridVertices = (size_t)verticesPerRow * verticesPerRow;
+    const std::shared_ptr<std::vector<float> > attributes = std::make_shared<std::vector<float> >(
+        (numberOfGridVertices + NUMBER_OF_SKIRTS * verticesPerRow) * VALUES_PER_ELEMENT);
+    float * grid = &(*attributes)[0];
+
+    for (U j = 0; j < verticesPerRow; ++j) {
+        for (U i = 0; i < verticesPerRow; ++i) {
+            float * element = grid + ((size_t)j * verticesPerRow + i) * VALUES_PER_ELEMENT;
+            element[0] = static_cast<float>(firstSampleX + 1 + i) * spacing;
+            element[1] = heights[(j + 1) * heightsPerRow + (i + 1)];
+            element[2] = static_cast<float>(firstSampleZ + 1 + j) * spacing;
+            element[6] = static_cast<float>(i) / static_cast<float>(resolution);
+            element[7] = static_cast<float>(j) / static_cast<float>(resolution);
+        }
+        calculateNormalRow(&heights[j * heightsPerRow], heightsPerRow, verticesPerRow, spacing,
+            grid + (size_t)j * verticesPerRow * VALUES_PER_ELEMENT);
+    }
+
+    float * skirt = grid + numberOfGridVertices * VALUES_PER_ELEMENT;
+    for (U side = 0; side < NUMBER_OF_SKIRTS; ++side) {
+        for (U k = 0; k < verticesPerRow; ++k, skirt += VALUES_PER_ELEMENT) {
+            const size_t edgeVertex = (side == 0) ? k
+                : ((side == 1) ? (size_t)resolution * verticesPerRow + k
+                : ((side == 2) ? (size_t)k * verticesPerRow : (size_t)k * verticesPerRow + resolution));
+            std::copy(grid + edgeVertex * VALUES_PER_ELEMENT, grid + (edgeVertex + 1) * VALUES_PER_ELEMENT, skirt);
+            skirt[1] -= settings.skirtDepth;
+        }
+    }
+
+    const std::shared_ptr<std::vector<U32> > indices = std::make_shared<std::vector<U32> >();
+    size_t numberOfIndices = 0;
+    for (U level = 0; level < settings.levelsOfDetail; ++level) {
+        const size_t quads = resolution >> level;
+        numberOfIndices += 6 * quads * quads + NUMBER_OF_SKIRTS * 6 * quads;
+    }
+    indices->reserve(numberOfIndices);
+    for (U level = 0; level < settings.levelsOfDetail; ++level) {
+        const TerrainLod lod = { indices->size(), 0 };
+        lods.push_back(lod);
+        addLodIndices(resolution, level, *indices);
+        lods.back().numberOfIndices = indices->size() - lods.back().firstIndex;
+    }
+
+    ModelData::AttributeData * element = new ModelData::AttributeData(
+        attributes,
+        (const char *)&(*attributes)[0],
+        sizeof(float) * attributes->size(),
+        { 3, 3, 2 },
+        sizeof(float) * VALUES_PER_ELEMENT,
+        ModelData::FLOAT
+        );
+
+    return ModelData(
+        { ModelData::AttributeElement(element) },
+        indices,
+        (const char *)&(*indices)[0],
+        sizeof(U32) * indices->size(),
+        sizeof(U32),
+        ModelData::TRIANGLE
+    );
+}
+
+TerrainChunkCoordinate stb::terrainChunkAt(const TerrainSettings & settings, const float x, const float z)
+{
+    const TerrainChunkCoordinate coordinate = {
+        static_cast<I>(std::floor(x / settings.chunkSize)),
+        static_cast<I>(std::floor(z / settings.chunkSize))
+    };
+    return coordinate;
+}
+
+static U chunkDistance(const TerrainChunkCoordinate & a, const TerrainChunkCoordinate & b)
+{
+    return static_cast<U>(std::max(std::abs(a.x - b.x), std::abs(a.z - b.z)));
+}
+
+U stb::selectTerrainLod(const TerrainSettings & settings, const TerrainChunkCoordinate & coordinate,
+    const float cameraX, const float cameraZ)
+{
+    // Level grows by one each time distance doubles
+    U level = 0;
+    for (U ring = chunkDistance(coordinate, terrainChunkAt(settings, cameraX, cameraZ)) + 1; ring > 1; ring >>= 1) {
+        ++level;
+    }
+    return std::min(level, settings.levelsOfDetail - 1);
+}
+
+TerrainStreamer::TerrainStreamer(const TerrainSettings & settings, const HeightFunction & height, const U radius)
+: m_settings(settings),
+m_height(height),
+m_radius(static_cast<I>(radius)),
+m_stop(false)
+{
+    m_thread = std::thread(&TerrainStreamer::run, this);
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+    {
+        Lock lock(m_lock);
+        m_stop = true;
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+void TerrainStreamer::update(const float cameraX, const float cameraZ, std::vector<TerrainChunkCoordinate> & evicted)
+{
+    const TerrainChunkCoordinate camera = terrainChunkAt(m_settings, cameraX, cameraZ);
+
+    std::vector<TerrainChunkCoordinate> wanted;
+    for (I z = camera.z - m_radius; z <= camera.z + m_radius; ++z) {
+        for (I x = camera.x - m_radius; x <= camera.x + m_radius; ++x) {
+            const TerrainChunkCoordinate coordinate = { x, z };
+            wanted.push_back(coordinate);
+        }
+    }
+    std::stable_sort(wanted.begin(), wanted.end(),
+        [&camera](const TerrainChunkCoordinate & a, const TerrainChunkCoordinate & b) {
+            return ((a.x - camera.x) * (a.x - camera.x) + (a.z - camera.z) * (a.z - camera.z))
+                < ((b.x - camera.x) * (b.x - camera.x) + (b.z - camera.z) * (b.z - camera.z));
+        });
+
+    {
+        Lock lock(m_lock);
+        // One chunk of slack keeps chunks from bouncing when camera moves along a border
+        for (auto it = m_chunks.begin(); it != m_chunks.end(); ) {
+            if (chunkDistance(it->first, camera) > static_cast<U>(m_radius + 1)) {
+                if (it->second == TAKEN) {
+                    evicted.push_back(it->first);
+                }
+                it = m_chunks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        m_requests.clear();
+        for (const TerrainChunkCoordinate & coordinate : wanted) {
+            const auto found = m_chunks.insert(std::make_pair(coordinate, QUEUED)).first;
+            if (found->second == QUEUED) {
+                m_requests.push_back(coordinate);
+            }
+        }
+    }
+    m_wakeUp.notify_one();
+}
+
+bool TerrainStreamer::takeReady(std::vector<TerrainChunk> & chunks)
+{
+    Lock lock(m_lock);
+    bool took = false;
+    for (const TerrainChunk & chunk : m_ready) {
+        // Chunks that went out of range while being generated are dropped
+        const auto found = m_chunks.find(chunk.coordinate);
+        if ((found != m_chunks.end()) && (found->second == READY)) {
+            found->second = TAKEN;
+            chunks.push_back(chunk);
+            took = true;
+        }
+    }
+    m_ready.clear();
+    return took;
+}
+
+void TerrainStreamer::run()
+{
+    Lock lock(m_lock);
+    while (!m_stop) {
+        if (m_requests.empty()) {
+            m_wakeUp.wait(lock);
+            continue;
+        }
+
+        const TerrainChunkCoordinate coordinate = m_requests.front();
+        m_requests.pop_front();
+        auto found = m_chunks.find(coordinate);
+        if ((found == m_chunks.end()) || (found->second != QUEUED)) {
+            continue;
+        }
+        found->second = GENERATING;
+
+        lock.unlock();
+        std::vector<TerrainLod> lods;
+        const ModelData model = generateTerrainChunk(m_settings, m_height, coordinate, lods);
+        lock.lock();
+
+        found = m_chunks.find(coordinate);
+        if (model.valid() && (found != m_chunks.end()) && (found->second == GENERATING)) {
+            found->second = READY;
+            const TerrainChunk chunk = { coordinate, model, lods };
+            m_ready.push_back(chunk);
+        }
+    }
+}
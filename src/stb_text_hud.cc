@@ -5,10 +5,13 @@
 #include "stb_buffer.hh"
 #include "stb_model.hh"
 #include "stb_gl.hh"
+#include "stb_gl_state.hh"
+#include "stb_gl_profiler.hh"
 #include "stb_util.hh"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cassert>
+#include <cstring>
 
 using namespace stb;
 
@@ -226,7 +229,7 @@ void stb::initTextHud(
     }
 
     glGenTextures(1, &hud.textureTarget);
-    glBindTexture(GL_TEXTURE_2D, hud.textureTarget);
+    glstate::bindTexture(GL_TEXTURE_2D, hud.textureTarget);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -247,7 +250,7 @@ void stb::initTextHud(
 
     STB_GL_DEBUG_ERROR;
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glstate::bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void stb::renderText(
@@ -258,8 +261,9 @@ void stb::renderText(
     const glm::vec2 & cursorStartPosition
     )
 {
-    glActiveTexture(GL_TEXTURE0 + hud.textureUnit);
-    glBindTexture(GL_TEXTURE_2D, hud.textureTarget);
+    const GpuScope scope(stb::activeGpuProfiler(), "renderText");
+    glstate::activeTexture(hud.textureUnit);
+    glstate::bindTexture(GL_TEXTURE_2D, hud.textureTarget);
     stb::activateShader(hud.shader);
 
     glm::vec2 cursorPostion(cursorStartPosition);
@@ -0,0 +1,128 @@
+#include "stb_watch.hh"
+
+#if defined(STB_LINUX)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace stb;
+
+typedef std::lock_guard<std::mutex> Guard;
+
+#if defined(STB_LINUX)
+
+// How often stop request is checked
+static const I STOP_CHECK_INTERVAL_MS = 100;
+// One save often generates several events, wait until they have settled
+static const I SETTLE_TIME_MS = 50;
+
+ModelWatcher::ModelWatcher(const std::string & pathToFile, const Loader & loader)
+: m_path(pathToFile),
+m_loader(loader),
+m_inotify(-1),
+m_ready(false),
+m_stop(false)
+{
+    const size_t separator = m_path.find_last_of('/');
+    const std::string directory = (separator == std::string::npos) ? std::string(".")
+        : ((separator == 0) ? std::string("/") : m_path.substr(0, separator));
+    m_fileName = (separator == std::string::npos) ? m_path : m_path.substr(separator + 1);
+
+    if ((m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+        return;
+    }
+    if (inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+        close(m_inotify);
+        m_inotify = -1;
+        return;
+    }
+
+    m_ready = true;
+    m_thread = std::thread(&ModelWatcher::run, this);
+}
+
+ModelWatcher::~ModelWatcher()
+{
+    m_stop = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_inotify != -1) {
+        close(m_inotify);
+    }
+}
+
+/*
+ * Reads all pending events, returns true if any of them concerned watched file
+ */
+static bool readEvents(const I fd, const std::string & fileName)
+{
+    alignas(struct inotify_event) char events[4096];
+    bool changed = false;
+    ssize_t length = 0;
+
+    while ((length = read(fd, events, sizeof(events))) > 0) {
+        for (const char * p = events; p < (events + length); ) {
+            const struct inotify_event * event = reinterpret_cast<const struct inotify_event *>(p);
+            if ((event->len > 0) && (fileName == event->name)) {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+void ModelWatcher::run()
+{
+    struct pollfd pollInfo;
+    pollInfo.fd = m_inotify;
+    pollInfo.events = POLLIN;
+
+    while (!m_stop) {
+        pollInfo.revents = 0;
+        if ((poll(&pollInfo, 1, STOP_CHECK_INTERVAL_MS) <= 0) || !readEvents(m_inotify, m_fileName)) {
+            continue;
+        }
+        while (!m_stop && (poll(&pollInfo, 1, SETTLE_TIME_MS) > 0)) {
+            readEvents(m_inotify, m_fileName);
+        }
+
+        const ModelData model = m_loader(m_path);
+        if (model.valid()) {
+            Guard guard(m_lock);
+            m_reloaded.clear();
+            m_reloaded.push_back(model);
+        }
+    }
+}
+
+#else
+
+ModelWatcher::ModelWatcher(const std::string & pathToFile, const Loader & loader)
+: m_path(pathToFile),
+m_loader(loader),
+m_inotify(-1),
+m_ready(false),
+m_stop(false)
+{}
+
+ModelWatcher::~ModelWatcher()
+{}
+
+void ModelWatcher::run()
+{}
+
+#endif
+
+bool ModelWatcher::takeReloaded(std::vector<ModelData> & models)
+{
+    Guard guard(m_lock);
+    if (m_reloaded.empty()) {
+        return false;
+    }
+    models.swap(m_reloaded);
+    m_reloaded.clear();
+    return true;
+}
@@ -0,0 +1,108 @@
+#define BOOST_TEST_MODULE unit_test_allocator
+#include <boost/test/unit_test.hpp>
+
+#include "stb_allocator.hh"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace stb;
+
+BOOST_AUTO_TEST_CASE(test_allocate_and_free)
+{
+    FreeListAllocator allocator(100);
+    BOOST_CHECK_EQUAL(allocator.capacity(), (size_t)100);
+    BOOST_CHECK_EQUAL(allocator.freeUnits(), (size_t)100);
+
+    const size_t a = allocator.allocate(30);
+    const size_t b = allocator.allocate(30);
+    const size_t c = allocator.allocate(30);
+    BOOST_CHECK_EQUAL(a, (size_t)0);
+    BOOST_CHECK_EQUAL(b, (size_t)30);
+    BOOST_CHECK_EQUAL(c, (size_t)60);
+    BOOST_CHECK_EQUAL(allocator.freeUnits(), (size_t)10);
+    BOOST_CHECK_EQUAL(allocator.allocate(11), FreeListAllocator::INVALID_OFFSET);
+    BOOST_CHECK_EQUAL(allocator.allocate(0), FreeListAllocator::INVALID_OFFSET);
+
+    // Freed neighbours are merged back into one range
+    allocator.free(a, 30);
+    allocator.free(c, 30);
+    BOOST_CHECK_EQUAL(allocator.numberOfFreeRanges(), (size_t)2);
+    BOOST_CHECK_EQUAL(allocator.largestFreeRange(), (size_t)40);
+    allocator.free(b, 30);
+    BOOST_CHECK_EQUAL(allocator.numberOfFreeRanges(), (size_t)1);
+    BOOST_CHECK_EQUAL(allocator.largestFreeRange(), (size_t)100);
+    BOOST_CHECK_EQUAL(allocator.freeUnits(), (size_t)100);
+}
+
+BOOST_AUTO_TEST_CASE(test_best_fit)
+{
+    FreeListAllocator allocator(100);
+    const size_t a = allocator.allocate(20);
+    allocator.allocate(10);
+    const size_t b = allocator.allocate(5);
+    allocator.allocate(10);
+    allocator.free(a, 20);
+    allocator.free(b, 5);
+
+    // Smallest range that fits is used, larger ones are left for larger requests
+    BOOST_CHECK_EQUAL(allocator.allocate(4), b);
+    BOOST_CHECK_EQUAL(allocator.allocate(15), a);
+    BOOST_CHECK_EQUAL(allocator.allocate(50), (size_t)45);
+}
+
+BOOST_AUTO_TEST_CASE(test_grow)
+{
+    FreeListAllocator empty(0);
+    BOOST_CHECK_EQUAL(empty.allocate(1), FreeListAllocator::INVALID_OFFSET);
+    empty.grow(8);
+    BOOST_CHECK_EQUAL(empty.allocate(8), (size_t)0);
+
+    FreeListAllocator allocator(10);
+    allocator.allocate(6);
+    BOOST_CHECK_EQUAL(allocator.allocate(8), FreeListAllocator::INVALID_OFFSET);
+    allocator.grow(20);
+    BOOST_CHECK_EQUAL(allocator.numberOfFreeRanges(), (size_t)1);
+    BOOST_CHECK_EQUAL(allocator.allocate(14), (size_t)6);
+    BOOST_CHECK_EQUAL(allocator.freeUnits(), (size_t)0);
+}
+
+BOOST_AUTO_TEST_CASE(test_random_use)
+{
+    const size_t capacity = 4096;
+    FreeListAllocator allocator(capacity);
+    std::vector<char> used(capacity, 0);
+    std::vector<std::pair<size_t, size_t> > live;
+    srand(7);
+
+    for (int i = 0; i < 20000; ++i) {
+        if (live.empty() || (rand() % 3 != 0)) {
+            const size_t size = 1 + rand() % 64;
+            const size_t offset = allocator.allocate(size);
+            if (offset == FreeListAllocator::INVALID_OFFSET) {
+                BOOST_REQUIRE(allocator.largestFreeRange() < size);
+                continue;
+            }
+            BOOST_REQUIRE(offset + size <= capacity);
+            for (size_t u = offset; u < offset + size; ++u) {
+                BOOST_REQUIRE(!used[u]);
+                used[u] = 1;
+            }
+            live.push_back(std::make_pair(offset, size));
+        } else {
+            const size_t pick = rand() % live.size();
+            for (size_t u = live[pick].first; u < live[pick].first + live[pick].second; ++u) {
+                used[u] = 0;
+            }
+            allocator.free(live[pick].first, live[pick].second);
+            live[pick] = live.back();
+            live.pop_back();
+        }
+    }
+
+    for (const auto & range : live) {
+        allocator.free(range.first, range.second);
+    }
+    BOOST_CHECK_EQUAL(allocator.freeUnits(), capacity);
+    BOOST_CHECK_EQUAL(allocator.numberOfFreeRanges(), (size_t)1);
+}
@@ -3,6 +3,9 @@
 
 #include "stb_buffer.hh"
 
+#include <fstream>
+#include <cstdio>
+
 const std::string expectedData("data123456789");
 
 BOOST_AUTO_TEST_CASE(test_buffer_with_static_memory)
@@ -31,4 +34,30 @@ BOOST_AUTO_TEST_CASE(test_buffer_with_file_access)
     buffer->read(&output[0]);
     BOOST_CHECK(output == expectedData);
 }
-*/
\ No newline at end of file
+*/
+
+BOOST_AUTO_TEST_CASE(test_buffer_with_mapped_file)
+{
+    const char * path = "unit_test_buffer_mapped_file.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << expectedData;
+    }
+
+    {
+        stb::buffer::MappedFile mapped(path);
+        stb::buffer::Buffer * buffer = &mapped;
+
+        BOOST_CHECK_EQUAL(buffer->ready(), true);
+        BOOST_CHECK_EQUAL(buffer->size(), expectedData.size());
+        BOOST_CHECK(std::string(mapped.data(), mapped.size()) == expectedData);
+
+        std::string output(buffer->size(), ' ');
+        buffer->read(&output[0]);
+        BOOST_CHECK(output == expectedData);
+    }
+    std::remove(path);
+
+    stb::buffer::MappedFile missing("unit_test_buffer_missing_file.txt");
+    BOOST_CHECK_EQUAL(missing.ready(), false);
+}
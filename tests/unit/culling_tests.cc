@@ -0,0 +1,249 @@
+#define BOOST_TEST_MODULE unit_test_culling
+#include <boost/test/unit_test.hpp>
+
+#include "stb_culling.hh"
+#include "stb_model.hh"
+#include "stb_error.hh"
+#include "stb_types.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace stb;
+
+static const float IDENTITY[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+static float randomFloat(const float min, const float max)
+{
+    return min + (max - min) * static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+}
+
+static void multiply(const float * a, const float * b, float * result)
+{
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            result[column * 4 + row] = 0.0f;
+            for (int i = 0; i < 4; ++i) {
+                result[column * 4 + row] += a[i * 4 + row] * b[column * 4 + i];
+            }
+        }
+    }
+}
+
+/*
+ * Perspective projection of camera at eye looking along yaw around y and pitch, as glm::perspective
+ * and glm::lookAt would make it
+ */
+static void makeViewProjection(const float * eye, const float yaw, const float pitch, float * viewProjection)
+{
+    const float forward[3] = { std::cos(pitch) * std::sin(yaw), std::sin(pitch), -std::cos(pitch) * std::cos(yaw) };
+    const float right[3] = { std::cos(yaw), 0.0f, std::sin(yaw) };
+    const float up[3] = {
+        right[1] * forward[2] - right[2] * forward[1],
+        right[2] * forward[0] - right[0] * forward[2],
+        right[0] * forward[1] - right[1] * forward[0]
+    };
+    float view[16] = { 0 };
+    for (int i = 0; i < 3; ++i) {
+        view[i * 4 + 0] = right[i];
+        view[i * 4 + 1] = up[i];
+        view[i * 4 + 2] = -forward[i];
+    }
+    view[12] = -(right[0] * eye[0] + right[1] * eye[1] + right[2] * eye[2]);
+    view[13] = -(up[0] * eye[0] + up[1] * eye[1] + up[2] * eye[2]);
+    view[14] = forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+    view[15] = 1.0f;
+
+    const float nearPlane = 0.5f;
+    const float farPlane = 150.0f;
+    const float f = 1.0f / std::tan(0.5f);
+    float projection[16] = { 0 };
+    projection[0] = f / 1.5f;
+    projection[5] = f;
+    projection[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+    projection[11] = -1.0f;
+    projection[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+    multiply(projection, view, viewProjection);
+}
+
+static void makeTransform(const float x, const float y, const float z, const float angle, float * transform)
+{
+    std::copy(IDENTITY, IDENTITY + 16, transform);
+    transform[0] = std::cos(angle);
+    transform[1] = std::sin(angle);
+    transform[4] = -std::sin(angle);
+    transform[5] = std::cos(angle);
+    transform[12] = x;
+    transform[13] = y;
+    transform[14] = z;
+}
+
+static Aabb randomBounds()
+{
+    const float size = randomFloat(0.1f, 2.0f);
+    return Aabb(-size, -0.5f * size, -size, size, 0.5f * size, size);
+}
+
+static void randomTransform(float * transform)
+{
+    makeTransform(randomFloat(-100.0f, 100.0f), randomFloat(-20.0f, 20.0f), randomFloat(-100.0f, 100.0f),
+        randomFloat(0.0f, 6.0f), transform);
+}
+
+static void checkAgainstBruteForce(InstanceRegistry & registry, std::vector<InstanceRegistry::Instance> all)
+{
+    // Indices of removed instances may be in all twice after being reused
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+    for (int camera = 0; camera < 8; ++camera) {
+        const float eye[3] = { randomFloat(-50.0f, 50.0f), randomFloat(-5.0f, 5.0f), randomFloat(-50.0f, 50.0f) };
+        float viewProjection[16];
+        makeViewProjection(eye, randomFloat(0.0f, 6.0f), randomFloat(-0.5f, 0.5f), viewProjection);
+        const Frustum frustum = frustumFromMatrix(viewProjection);
+
+        std::vector<InstanceRegistry::Instance> expected;
+        for (const InstanceRegistry::Instance instance : all) {
+            if (registry.contains(instance) && visible(frustum, registry.worldBounds(instance))) {
+                expected.push_back(instance);
+            }
+        }
+        std::vector<InstanceRegistry::Instance> culled;
+        registry.cull(frustum, culled);
+        std::sort(culled.begin(), culled.end());
+        std::sort(expected.begin(), expected.end());
+        BOOST_CHECK(!expected.empty());
+        BOOST_CHECK_EQUAL_COLLECTIONS(culled.begin(), culled.end(), expected.begin(), expected.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_model_bounds)
+{
+    const float attributes[] = {
+        -1.0f, 0.0f, 2.0f, 0.0f, 0.0f,
+        3.0f, -4.0f, 0.5f, 1.0f, 0.0f,
+        0.0f, 5.0f, -6.0f, 1.0f, 1.0f
+    };
+    const U16 indices[] = { 0, 1, 2 };
+    const ModelData::AttributeElement attr(new ModelData::AttributeData(
+        (const char *)attributes, sizeof(attributes), { 3, 2 }, sizeof(float) * 5, ModelData::FLOAT));
+    const ModelData triangle({ attr }, (const char *)indices, sizeof(indices), sizeof(U16), ModelData::TRIANGLE);
+
+    const Aabb bounds = modelBounds(triangle);
+    BOOST_CHECK_EQUAL(bounds.min[0], -1.0f);
+    BOOST_CHECK_EQUAL(bounds.min[1], -4.0f);
+    BOOST_CHECK_EQUAL(bounds.min[2], -6.0f);
+    BOOST_CHECK_EQUAL(bounds.max[0], 3.0f);
+    BOOST_CHECK_EQUAL(bounds.max[1], 5.0f);
+    BOOST_CHECK_EQUAL(bounds.max[2], 2.0f);
+
+    stb::clearError();
+    BOOST_CHECK(modelBounds(ModelData()).empty());
+    BOOST_CHECK(stb::isError());
+    stb::clearError();
+}
+
+BOOST_AUTO_TEST_CASE(test_transform_bounds)
+{
+    // Quarter turn around z swaps x and y extents
+    float transform[16];
+    makeTransform(10.0f, 0.0f, -1.0f, 0.5f * 3.14159265f, transform);
+    const Aabb bounds = transformBounds(Aabb(-1.0f, -2.0f, -3.0f, 1.0f, 2.0f, 3.0f), transform);
+    BOOST_CHECK_CLOSE(bounds.min[0], 8.0f, 0.001f);
+    BOOST_CHECK_CLOSE(bounds.max[0], 12.0f, 0.001f);
+    BOOST_CHECK_CLOSE(bounds.min[1], -1.0f, 0.001f);
+    BOOST_CHECK_CLOSE(bounds.max[1], 1.0f, 0.001f);
+    BOOST_CHECK_CLOSE(bounds.min[2], -4.0f, 0.001f);
+    BOOST_CHECK_CLOSE(bounds.max[2], 2.0f, 0.001f);
+    BOOST_CHECK(transformBounds(Aabb(), transform).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_frustum_of_identity_is_clip_cube)
+{
+    const Frustum frustum = frustumFromMatrix(IDENTITY);
+    BOOST_CHECK(visible(frustum, Aabb(-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f)));
+    BOOST_CHECK(visible(frustum, Aabb(0.9f, 0.9f, 0.9f, 2.0f, 2.0f, 2.0f)));
+    BOOST_CHECK(!visible(frustum, Aabb(1.1f, -0.5f, -0.5f, 2.0f, 0.5f, 0.5f)));
+    BOOST_CHECK(!visible(frustum, Aabb(-0.5f, -0.5f, -3.0f, 0.5f, 0.5f, -1.5f)));
+    BOOST_CHECK(!visible(frustum, Aabb()));
+}
+
+BOOST_AUTO_TEST_CASE(test_cull_matches_brute_force)
+{
+    std::srand(1);
+    InstanceRegistry registry;
+    std::vector<InstanceRegistry::Instance> all;
+    float transform[16];
+    for (int i = 0; i < 20000; ++i) {
+        randomTransform(transform);
+        all.push_back(registry.add(randomBounds(), transform));
+    }
+    BOOST_CHECK_EQUAL(registry.numberOfInstances(), all.size());
+    checkAgainstBruteForce(registry, all);
+    BOOST_CHECK_EQUAL(registry.numberOfRebuilds(), (size_t)1);
+
+    // Moving a few instances a little refits the hierarchy without rebuilding it
+    for (size_t i = 0; i < all.size(); i += 7) {
+        const Aabb & world = registry.worldBounds(all[i]);
+        makeTransform(0.5f * (world.min[0] + world.max[0]) + randomFloat(-1.0f, 1.0f),
+            0.5f * (world.min[1] + world.max[1]), 0.5f * (world.min[2] + world.max[2]) + randomFloat(-1.0f, 1.0f),
+            randomFloat(0.0f, 6.0f), transform);
+        registry.move(all[i], transform);
+    }
+    checkAgainstBruteForce(registry, all);
+    BOOST_CHECK_EQUAL(registry.numberOfRebuilds(), (size_t)1);
+
+    // Moving them anywhere grows leaves enough to rebuild
+    for (size_t i = 0; i < all.size(); ++i) {
+        randomTransform(transform);
+        registry.move(all[i], transform);
+    }
+    checkAgainstBruteForce(registry, all);
+    BOOST_CHECK_EQUAL(registry.numberOfRebuilds(), (size_t)2);
+}
+
+BOOST_AUTO_TEST_CASE(test_add_and_remove)
+{
+    std::srand(2);
+    InstanceRegistry registry;
+    std::vector<InstanceRegistry::Instance> culled;
+    registry.cull(frustumFromMatrix(IDENTITY), culled);
+    BOOST_CHECK(culled.empty());
+
+    std::vector<InstanceRegistry::Instance> all;
+    float transform[16];
+    for (int i = 0; i < 5000; ++i) {
+        randomTransform(transform);
+        all.push_back(registry.add(randomBounds(), transform));
+    }
+    checkAgainstBruteForce(registry, all);
+
+    // Removed instances are no longer visible and their indices are reused
+    for (size_t i = 0; i < all.size(); i += 3) {
+        registry.remove(all[i]);
+    }
+    BOOST_CHECK(!registry.contains(all[0]));
+    checkAgainstBruteForce(registry, all);
+    for (int i = 0; i < 100; ++i) {
+        randomTransform(transform);
+        const InstanceRegistry::Instance instance = registry.add(randomBounds(), transform);
+        BOOST_CHECK(instance < all.size());
+    }
+    checkAgainstBruteForce(registry, all);
+
+    // Enough added instances are moved into the hierarchy
+    const size_t rebuilds = registry.numberOfRebuilds();
+    for (int i = 0; i < 5000; ++i) {
+        randomTransform(transform);
+        all.push_back(registry.add(randomBounds(), transform));
+    }
+    checkAgainstBruteForce(registry, all);
+    BOOST_CHECK_EQUAL(registry.numberOfRebuilds(), rebuilds + 1);
+    BOOST_CHECK_EQUAL(registry.numberOfInstances(), (size_t)(5000 - 1667 + 100 + 5000));
+
+    stb::clearError();
+    registry.remove(20000);
+    BOOST_CHECK(stb::isError());
+    stb::clearError();
+}
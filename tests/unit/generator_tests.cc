@@ -0,0 +1,212 @@
+#define BOOST_TEST_MODULE unit_test_generator
+#include <boost/test/unit_test.hpp>
+
+#include "stb_generator.hh"
+#include "stb_baked.hh"
+#include "stb_generator_cache.hh"
+#include "stb_model.hh"
+#include "stb_types.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace stb;
+
+static const size_t VALUES_PER_ELEMENT = 8;
+
+static void checkLayoutAndIndices(const ModelData & model)
+{
+    BOOST_REQUIRE(model.valid());
+    BOOST_REQUIRE_EQUAL(model.numberOfAttrBuffers(), (size_t)1);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 0), (size_t)3);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 1), (size_t)3);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 2), (size_t)2);
+    BOOST_REQUIRE_EQUAL(model.attrBufferSizeOfElement(0), VALUES_PER_ELEMENT * sizeof(float));
+    BOOST_REQUIRE_EQUAL(model.sizeOfIndiceElement(), sizeof(U32));
+    BOOST_CHECK_EQUAL(model.attributeDataMode(), ModelData::TRIANGLE);
+
+    const size_t numberOfElements = model.attrBufferSize(0) / model.attrBufferSizeOfElement(0);
+    const size_t numberOfIndices = model.indicesDataSize() / sizeof(U32);
+    const U32 * indices = (const U32 *)model.indicesData();
+    BOOST_REQUIRE_EQUAL(numberOfIndices % 3, (size_t)0);
+
+    for (size_t i = 0; i < numberOfIndices; ++i) {
+        BOOST_REQUIRE(indices[i] < numberOfElements);
+    }
+}
+
+static size_t numberOfElements(const ModelData & model)
+{
+    return model.attrBufferSize(0) / model.attrBufferSizeOfElement(0);
+}
+
+static size_t numberOfTriangles(const ModelData & model)
+{
+    return model.indicesDataSize() / sizeof(U32) / 3;
+}
+
+BOOST_AUTO_TEST_CASE(test_cube)
+{
+    for (U subdivides = 0; subdivides < 6; ++subdivides) {
+        const ModelData cube = generateCube(subdivides);
+        checkLayoutAndIndices(cube);
+        BOOST_CHECK_EQUAL(numberOfTriangles(cube), (size_t)(12 * (subdivides + 1) * (subdivides + 1)));
+
+        // Every vertex is on the surface of unit cube and normal points out of it
+        const float * element = (const float *)cube.attrBuffer(0);
+        for (size_t i = 0; i < numberOfElements(cube); ++i, element += VALUES_PER_ELEMENT) {
+            const float maxCoordinate = std::max(std::abs(element[0]), std::max(std::abs(element[1]), std::abs(element[2])));
+            BOOST_REQUIRE_CLOSE(maxCoordinate, 0.5f, 0.001f);
+            const float dot = element[0] * element[3] + element[1] * element[4] + element[2] * element[5];
+            BOOST_REQUIRE_CLOSE(dot, 0.5f, 0.001f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_cube_has_no_duplicate_vertices)
+{
+    for (U subdivides = 0; subdivides < 8; subdivides += 7) {
+        const ModelData cube = generateCube(subdivides);
+        BOOST_CHECK_EQUAL(numberOfElements(cube), (size_t)(6 * (subdivides + 2) * (subdivides + 2)));
+
+        std::set<std::string> elements;
+        for (size_t i = 0; i < numberOfElements(cube); ++i) {
+            elements.insert(std::string(cube.attrBuffer(0) + i * cube.attrBufferSizeOfElement(0), cube.attrBufferSizeOfElement(0)));
+        }
+        BOOST_CHECK_EQUAL(elements.size(), numberOfElements(cube));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_sphere)
+{
+    const float radius = 2.0f;
+    for (U subdivides = 0; subdivides < 5; ++subdivides) {
+        const ModelData sphere = generateSphere(subdivides, radius);
+        checkLayoutAndIndices(sphere);
+        BOOST_CHECK_EQUAL(numberOfTriangles(sphere), (size_t)(8 * std::pow(4, subdivides)));
+        BOOST_CHECK_EQUAL(numberOfElements(sphere), (size_t)(4 * std::pow(4, subdivides) + 2));
+
+        const float * element = (const float *)sphere.attrBuffer(0);
+        for (size_t i = 0; i < numberOfElements(sphere); ++i, element += VALUES_PER_ELEMENT) {
+            const float length = std::sqrt(element[0] * element[0] + element[1] * element[1] + element[2] * element[2]);
+            BOOST_REQUIRE_CLOSE(length, radius, 0.001f);
+            BOOST_REQUIRE_SMALL(element[0] - element[3] * radius, 0.0001f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_generating_into_memory)
+{
+    const U32 baseVertex = 5;
+    for (U subdivides = 0; subdivides < 4; ++subdivides) {
+        const ModelData models[] = { generateCube(subdivides), generateSphere(subdivides, 3.0f) };
+        const GeneratedSize sizes[] = { queryCubeSize(subdivides), querySphereSize(subdivides) };
+
+        for (U shape = 0; shape < 2; ++shape) {
+            const ModelData & model = models[shape];
+            const GeneratedSize & size = sizes[shape];
+            BOOST_REQUIRE_EQUAL(size.attributeBytes(), model.attrBufferSize(0));
+            BOOST_REQUIRE_EQUAL(size.indiceBytes(), model.indicesDataSize());
+
+            std::vector<float> attributes(size.numberOfElements * VALUES_PER_ELEMENT);
+            std::vector<U32> indices(size.numberOfIndices);
+            if (shape == 0) {
+                generateCubeInto(subdivides, &attributes[0], &indices[0], baseVertex);
+            } else {
+                generateSphereInto(subdivides, 3.0f, &attributes[0], &indices[0], baseVertex);
+            }
+
+            BOOST_CHECK(memcmp(&attributes[0], model.attrBuffer(0), size.attributeBytes()) == 0);
+            const U32 * expected = (const U32 *)model.indicesData();
+            for (size_t i = 0; i < size.numberOfIndices; ++i) {
+                BOOST_REQUIRE_EQUAL(indices[i], expected[i] + baseVertex);
+            }
+        }
+    }
+}
+
+static_assert(baked::Cube<0>::attributes[0] == -0.5f, "Baked cube is a constant expression");
+static_assert(baked::Cube<0>::indices[5] == 3, "Baked cube is a constant expression");
+
+static void checkSameModel(const ModelData & baked, const ModelData & generated)
+{
+    checkLayoutAndIndices(baked);
+    BOOST_REQUIRE_EQUAL(baked.attrBufferSize(0), generated.attrBufferSize(0));
+    BOOST_REQUIRE_EQUAL(baked.indicesDataSize(), generated.indicesDataSize());
+    BOOST_CHECK(memcmp(baked.attrBuffer(0), generated.attrBuffer(0), baked.attrBufferSize(0)) == 0);
+    BOOST_CHECK(memcmp(baked.indicesData(), generated.indicesData(), baked.indicesDataSize()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_baked_models)
+{
+    checkSameModel(baked::cubeModel<0>(), generateCube(0));
+    checkSameModel(baked::cubeModel<2>(), generateCube(2));
+    checkSameModel(baked::cubeModel<5>(), generateCube(5));
+    checkSameModel(baked::sphereModel<0>(), generateSphere(0));
+    checkSameModel(baked::sphereModel<3>(), generateSphere(3));
+
+    // Storage is shared, not rebuilt
+    BOOST_CHECK(baked::cubeModel<2>().attrBuffer(0) == baked::cubeModel<2>().attrBuffer(0));
+    BOOST_CHECK(baked::sphereModel<3>().indicesData() == baked::sphereModel<3>().indicesData());
+    BOOST_CHECK_EQUAL(baked::Cube<2>::numberOfElements, queryCubeSize(2).numberOfElements);
+    BOOST_CHECK_EQUAL(baked::Sphere<3>::numberOfIndices, querySphereSize(3).numberOfIndices);
+}
+
+BOOST_AUTO_TEST_CASE(test_generating_in_parallel)
+{
+    // Output must not depend on number of threads, cube of 130 subdivides splits each face into several tasks
+    checkSameModel(generateCube(130, 4), generateCube(130, 1));
+    checkSameModel(generateSphere(5, 2.0f, 4), generateSphere(5, 2.0f, 1));
+    checkSameModel(generateSphere(1, 2.0f, 0), generateSphere(1, 2.0f, 1));
+}
+
+BOOST_AUTO_TEST_CASE(test_cache_keeps_recently_used_models)
+{
+    const size_t sphereSize = querySphereSize(3).attributeBytes() + querySphereSize(3).indiceBytes();
+    GeneratorCache cache(2 * sphereSize);
+
+    const ModelData first = cache.get(GeneratedShape::Sphere, 3, 1.0f);
+    checkSameModel(first, generateSphere(3, 1.0f));
+    BOOST_CHECK(cache.get(GeneratedShape::Sphere, 3, 1.0f).attrBuffer(0) == first.attrBuffer(0));
+    BOOST_CHECK(cache.get(GeneratedShape::Sphere, 3, 2.0f).attrBuffer(0) != first.attrBuffer(0));
+    BOOST_CHECK_EQUAL(cache.numberOfModels(), (size_t)2);
+    BOOST_CHECK_EQUAL(cache.sizeInBytes(), 2 * sphereSize);
+
+    // Radius 1 was used more recently than radius 2, so radius 2 makes room for the third
+    BOOST_CHECK(cache.get(GeneratedShape::Sphere, 3, 1.0f).attrBuffer(0) == first.attrBuffer(0));
+    cache.get(GeneratedShape::Sphere, 3, 3.0f);
+    BOOST_CHECK_EQUAL(cache.numberOfModels(), (size_t)2);
+    BOOST_CHECK(cache.get(GeneratedShape::Sphere, 3, 1.0f).attrBuffer(0) == first.attrBuffer(0));
+
+    // Models larger than the whole budget are returned without caching them
+    checkSameModel(cache.get(GeneratedShape::Cube, 40), generateCube(40));
+    BOOST_CHECK_EQUAL(cache.numberOfModels(), (size_t)2);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.sizeInBytes(), (size_t)0);
+}
+
+BOOST_AUTO_TEST_CASE(test_cache_persists_models)
+{
+    const char * path = "./cube-2-00000000.sm";
+    remove(path);
+    {
+        GeneratorCache cache(1024 * 1024, ".");
+        checkSameModel(cache.get(GeneratedShape::Cube, 2), generateCube(2));
+    }
+    {
+        // Model comes from the file written by the first cache
+        GeneratorCache cache(1024 * 1024, ".");
+        checkSameModel(cache.get(GeneratedShape::Cube, 2), generateCube(2));
+        BOOST_REQUIRE(writeModel(generateCube(0), path));
+    }
+    {
+        GeneratorCache cache(1024 * 1024, ".");
+        checkSameModel(cache.get(GeneratedShape::Cube, 2), generateCube(0));
+    }
+    remove(path);
+}
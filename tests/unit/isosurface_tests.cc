@@ -0,0 +1,160 @@
+#define BOOST_TEST_MODULE unit_test_isosurface
+#include <boost/test/unit_test.hpp>
+
+#include "stb_isosurface.hh"
+#include "stb_error.hh"
+#include "stb_types.hh"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace stb;
+
+static const size_t VALUES_PER_ELEMENT = 6;
+static const float RADIUS = 0.8f;
+
+static IsosurfaceSettings makeSettings(const U samples)
+{
+    const float spacing = 2.0f / static_cast<float>(samples - 1);
+    const IsosurfaceSettings settings = { samples, samples, samples, -1.0f, -1.0f, -1.0f, spacing, 0.0f };
+    return settings;
+}
+
+static float sphereDistance(const float x, const float y, const float z)
+{
+    return std::sqrt(x * x + y * y + z * z) - RADIUS;
+}
+
+static size_t numberOfElements(const ModelData & model)
+{
+    return model.attrBufferSize(0) / model.attrBufferSizeOfElement(0);
+}
+
+static const float * element(const ModelData & model, const size_t i)
+{
+    return (const float *)model.attrBuffer(0) + i * VALUES_PER_ELEMENT;
+}
+
+static const U32 * indices(const ModelData & model)
+{
+    return (const U32 *)model.indicesData();
+}
+
+static size_t numberOfIndices(const ModelData & model)
+{
+    return model.indicesDataSize() / sizeof(U32);
+}
+
+static bool sameModel(const ModelData & a, const ModelData & b)
+{
+    return (a.attrBufferSize(0) == b.attrBufferSize(0))
+        && (a.indicesDataSize() == b.indicesDataSize())
+        && (memcmp(a.attrBuffer(0), b.attrBuffer(0), a.attrBufferSize(0)) == 0)
+        && (memcmp(a.indicesData(), b.indicesData(), a.indicesDataSize()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_closed_sphere)
+{
+    const IsosurfaceSettings settings = makeSettings(41);
+    const ModelData sphere = generateIsosurface(sphereDistance, settings, 4);
+    BOOST_REQUIRE(sphere.valid());
+    BOOST_REQUIRE_EQUAL(sphere.numberOfAttrInBuffer(0), (size_t)2);
+    BOOST_REQUIRE_EQUAL(sphere.sizeOfIndiceElement(), sizeof(U32));
+    BOOST_REQUIRE(numberOfIndices(sphere) > 0);
+    BOOST_REQUIRE_EQUAL(numberOfIndices(sphere) % 6, (size_t)0);
+
+    for (size_t i = 0; i < numberOfElements(sphere); ++i) {
+        const float * e = element(sphere, i);
+        const float length = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+        BOOST_REQUIRE_SMALL(length - RADIUS, settings.spacing);
+        BOOST_REQUIRE_CLOSE(e[3] * e[3] + e[4] * e[4] + e[5] * e[5], 1.0f, 0.001f);
+        BOOST_REQUIRE(e[0] * e[3] + e[1] * e[4] + e[2] * e[5] > 0.0f);
+    }
+
+    // Closed and consistently wound: every edge is used once in each direction
+    std::map<std::pair<U32, U32>, int> edges;
+    double volume = 0.0;
+    for (size_t t = 0; t < numberOfIndices(sphere); t += 3) {
+        const U32 * triangle = indices(sphere) + t;
+        for (U corner = 0; corner < 3; ++corner) {
+            BOOST_REQUIRE(triangle[corner] < numberOfElements(sphere));
+            ++edges[std::make_pair(triangle[corner], triangle[(corner + 1) % 3])];
+        }
+        const float * a = element(sphere, triangle[0]);
+        const float * b = element(sphere, triangle[1]);
+        const float * c = element(sphere, triangle[2]);
+        volume += (a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0])
+            + a[2] * (b[0] * c[1] - b[1] * c[0])) / 6.0;
+    }
+    for (const auto & edge : edges) {
+        BOOST_REQUIRE_EQUAL(edge.second, 1);
+        BOOST_REQUIRE(edges.count(std::make_pair(edge.first.second, edge.first.first)) == 1);
+    }
+
+    // Positive volume means triangles face outside
+    BOOST_CHECK_CLOSE(volume, 4.0 / 3.0 * M_PI * RADIUS * RADIUS * RADIUS, 5.0);
+}
+
+BOOST_AUTO_TEST_CASE(test_volume_and_number_of_threads)
+{
+    const IsosurfaceSettings settings = makeSettings(37);
+    std::vector<float> volume;
+    for (U z = 0; z < settings.samplesZ; ++z) {
+        for (U y = 0; y < settings.samplesY; ++y) {
+            for (U x = 0; x < settings.samplesX; ++x) {
+                volume.push_back(sphereDistance(settings.originX + static_cast<float>(x) * settings.spacing,
+                    settings.originY + static_cast<float>(y) * settings.spacing,
+                    settings.originZ + static_cast<float>(z) * settings.spacing));
+            }
+        }
+    }
+
+    const ModelData one = generateIsosurface(sphereDistance, settings, 1);
+    BOOST_REQUIRE(one.valid());
+    BOOST_CHECK(sameModel(one, generateIsosurface(sphereDistance, settings, 7)));
+    BOOST_CHECK(sameModel(one, generateIsosurface(volume.data(), settings, 1)));
+    BOOST_CHECK(sameModel(one, generateIsosurface(volume.data(), settings, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(test_open_surface)
+{
+    // Plane crossing the whole volume ends at the outermost samples
+    IsosurfaceSettings settings = makeSettings(20);
+    settings.isoLevel = 0.3f;
+    const ModelData plane = generateIsosurface([](const float, const float y, const float) { return y; }, settings);
+    BOOST_REQUIRE(plane.valid());
+
+    const size_t cells = settings.samplesX - 1;
+    BOOST_CHECK_EQUAL(numberOfElements(plane), cells * cells);
+    BOOST_CHECK_EQUAL(numberOfIndices(plane), (cells - 1) * (cells - 1) * 6);
+    for (size_t i = 0; i < numberOfElements(plane); ++i) {
+        const float * e = element(plane, i);
+        BOOST_REQUIRE_CLOSE(e[1], 0.3f, 0.001f);
+        BOOST_REQUIRE_CLOSE(e[4], 1.0f, 0.001f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_and_invalid)
+{
+    const ModelData empty = generateIsosurface(sphereDistance, makeSettings(2));
+    BOOST_CHECK(empty.valid());
+    BOOST_CHECK_EQUAL(empty.indicesDataSize(), (size_t)0);
+
+    clearError();
+    IsosurfaceSettings settings = makeSettings(8);
+    settings.samplesY = 1;
+    BOOST_CHECK(!generateIsosurface(sphereDistance, settings).valid());
+    BOOST_CHECK(isError());
+    clearError();
+
+    BOOST_CHECK(!generateIsosurface(DistanceFunction(), makeSettings(8)).valid());
+    BOOST_CHECK(isError());
+    clearError();
+
+    BOOST_CHECK(!generateIsosurface((const float *)0, makeSettings(8)).valid());
+    BOOST_CHECK(isError());
+    clearError();
+}
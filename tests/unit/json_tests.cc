@@ -0,0 +1,61 @@
+#define BOOST_TEST_MODULE unit_test_json
+#include <boost/test/unit_test.hpp>
+
+#include "stb_json.hh"
+#include "stb_error.hh"
+
+#include <cstring>
+
+using namespace stb;
+
+static bool parseText(const char * text, json::Document & document)
+{
+    return json::parse(text, strlen(text), document);
+}
+
+BOOST_AUTO_TEST_CASE(test_parsing_values)
+{
+    json::Document document;
+    BOOST_REQUIRE(parseText(" {\"a\": [1, -2.5, 3e2, true, false, null], \"b\": {\"c\": \"d\\\"e\"}, \"e\": []} ", document));
+
+    const json::Node & root = document.root();
+    BOOST_CHECK_EQUAL(root.type, json::OBJECT);
+    BOOST_CHECK_EQUAL(root.numberOfChildren, (U32)3);
+
+    const json::Node * a = json::member(document, root, "a");
+    BOOST_REQUIRE(a != 0);
+    BOOST_CHECK_EQUAL(a->type, json::ARRAY);
+    BOOST_CHECK_EQUAL(a->numberOfChildren, (U32)6);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 0)->number, 1.0);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 1)->number, -2.5);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 2)->number, 300.0);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 3)->type, json::BOOLEAN);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 3)->number, 1.0);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 4)->number, 0.0);
+    BOOST_CHECK_EQUAL(json::element(document, *a, 5)->type, json::NUL);
+    BOOST_CHECK(json::element(document, *a, 6) == 0);
+
+    const json::Node * b = json::member(document, root, "b");
+    BOOST_REQUIRE(b != 0);
+    const json::Node * c = json::member(document, *b, "c");
+    BOOST_REQUIRE(c != 0);
+    BOOST_CHECK_EQUAL(c->type, json::STRING);
+    BOOST_CHECK_EQUAL(c->textLength, (size_t)4); // Escapes are kept as they are
+    BOOST_CHECK(json::equals(c, "d\\\"e"));
+
+    BOOST_CHECK_EQUAL(json::member(document, root, "e")->numberOfChildren, (U32)0);
+    BOOST_CHECK(json::member(document, root, "f") == 0);
+    BOOST_CHECK_EQUAL(json::numberMember(document, root, "f", 7.0), 7.0);
+}
+
+BOOST_AUTO_TEST_CASE(test_parsing_invalid_text)
+{
+    const char * invalid[] = { "", "{", "[1, 2", "{\"a\" 1}", "{\"a\": 1,}", "[1] 2", "tru", "\"abc", "-" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        clearError();
+        json::Document document;
+        BOOST_CHECK_MESSAGE(!parseText(invalid[i], document), invalid[i]);
+        BOOST_CHECK(isError());
+    }
+    clearError();
+}
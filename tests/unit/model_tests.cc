@@ -4,9 +4,69 @@
 #include "stb_model.hh"
 #include "stb_types.hh"
 #include "stb_util.hh"
+#include "stb_error.hh"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
 
 using namespace stb;
 
+static void appendU32(std::string & out, const U32 value)
+{
+    out.append((const char *)&value, sizeof(value));
+}
+
+/*
+ * Builds .glb with given JSON and binary chunk, chunks padded to 4 bytes
+ */
+static std::string makeGlb(std::string json, std::string bin)
+{
+    while (json.size() % 4) {
+        json += ' ';
+    }
+    while (bin.size() % 4) {
+        bin += '\0';
+    }
+    std::string glb("glTF");
+    appendU32(glb, 2);
+    appendU32(glb, (U32)(12 + 8 + json.size() + 8 + bin.size()));
+    appendU32(glb, (U32)json.size());
+    appendU32(glb, 0x4E4F534A);
+    glb += json;
+    appendU32(glb, (U32)bin.size());
+    appendU32(glb, 0x004E4942);
+    glb += bin;
+    return glb;
+}
+
+static const float glbPositionsAndNormals[] = {
+    // Interleaved position, normal
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+};
+static const U16 glbIndices[] = { 0, 1, 2, 2, 1, 3 };
+
+static std::string makeQuadGlb(const char * indicesComponentType)
+{
+    std::string bin((const char *)glbPositionsAndNormals, sizeof(glbPositionsAndNormals));
+    bin.append((const char *)glbIndices, sizeof(glbIndices));
+    const std::string json = std::string("{\"asset\": {\"version\": \"2.0\"},"
+        "\"buffers\": [{\"byteLength\": 108}],"
+        "\"bufferViews\": ["
+        "{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": 96, \"byteStride\": 24},"
+        "{\"buffer\": 0, \"byteOffset\": 96, \"byteLength\": 12}],"
+        "\"accessors\": ["
+        "{\"bufferView\": 0, \"componentType\": 5126, \"count\": 4, \"type\": \"VEC3\", \"min\": [0, 0, 0], \"max\": [1.0, 1.0, 0.0]},"
+        "{\"bufferView\": 0, \"byteOffset\": 12, \"componentType\": 5126, \"count\": 4, \"type\": \"VEC3\"},"
+        "{\"bufferView\": 1, \"componentType\": ") + indicesComponentType + ", \"count\": 6, \"type\": \"SCALAR\"}],"
+        "\"meshes\": [{\"primitives\": [{\"attributes\": {\"NORMAL\": 1, \"POSITION\": 0}, \"indices\": 2}]}]}";
+    return makeGlb(json, bin);
+}
+
 BOOST_AUTO_TEST_CASE(test_single_buffer_single_attribute)
 {
     const float attrData[] = {
@@ -170,6 +230,263 @@ BOOST_AUTO_TEST_CASE(test_allocating_invalid_model_and_copyconstructor_for_it)
     BOOST_CHECK_EQUAL(model2.valid(), false);
 }
 
+BOOST_AUTO_TEST_CASE(test_copied_model_shares_data)
+{
+    const float attrData[] = { 1.0f, 2.0f, 3.0f };
+    const U16 indicesData[] = { 0, 0, 0 };
+
+    const ModelData::AttributeElement attr(new ModelData::AttributeData(
+        (const char *)attrData, sizeof(attrData), { 3 }, sizeof(attrData), ModelData::FLOAT));
+    const ModelData model({ attr }, (const char *)indicesData, sizeof(indicesData), sizeof(U16), ModelData::TRIANGLE);
+    const ModelData copy(model);
+
+    BOOST_CHECK(model.attrBuffer(0) != (const char *)attrData);
+    BOOST_CHECK(model.indicesData() != (const char *)indicesData);
+    BOOST_CHECK_EQUAL(copy.attrBuffer(0), model.attrBuffer(0));
+    BOOST_CHECK_EQUAL(copy.indicesData(), model.indicesData());
+    BOOST_CHECK_EQUAL(((const float *)copy.attrBuffer(0))[2], 3.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_reading_glb_without_copying)
+{
+    const std::string glb = makeQuadGlb("5123");
+    const char * bin = glb.data() + glb.size() - 108;
+    const ModelData model = readGlbModel(glb.data(), glb.size());
+
+    BOOST_REQUIRE(model.valid());
+    BOOST_CHECK_EQUAL(model.numberOfAttrBuffers(), (size_t)2);
+    BOOST_CHECK_EQUAL(model.numberOfAttributes(), (size_t)2);
+    BOOST_CHECK_EQUAL(model.attributeDataMode(), ModelData::TRIANGLE);
+
+    // Position and normal interleaved in the same view, the view ends before stride of last
+    // normal does, so normals are copied next to each other
+    BOOST_CHECK_EQUAL(model.attrBuffer(0), bin);
+    BOOST_CHECK(model.attrBuffer(1) != bin + 12);
+    BOOST_CHECK_EQUAL(model.attrBufferSizeOfElement(0), (size_t)24);
+    BOOST_CHECK_EQUAL(model.attrBufferSizeOfElement(1), (size_t)12);
+    BOOST_CHECK_EQUAL(model.attrBufferSize(0), (size_t)(4 * 24));
+    BOOST_CHECK_EQUAL(model.attrBufferSize(1), (size_t)(4 * 12));
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 0), (size_t)3);
+    BOOST_CHECK_EQUAL(model.attrBufferDataType(1), ModelData::FLOAT);
+    BOOST_CHECK_EQUAL(((const float *)model.attrBuffer(1))[2], 1.0f);
+    BOOST_CHECK_EQUAL(((const float *)model.attrBuffer(1))[11], 1.0f);
+
+    BOOST_CHECK_EQUAL(model.indicesData(), bin + 96);
+    BOOST_CHECK_EQUAL(model.sizeOfIndiceElement(), (size_t)2);
+    BOOST_CHECK_EQUAL(model.indicesDataSize(), sizeof(glbIndices));
+    BOOST_CHECK_EQUAL(((const U16 *)model.indicesData())[5], (U16)3);
+}
+
+BOOST_AUTO_TEST_CASE(test_reading_glb_keeps_owner_alive)
+{
+    std::shared_ptr<std::string> glb(new std::string(makeQuadGlb("5123")));
+    std::weak_ptr<std::string> weak(glb);
+    {
+        const ModelData model = readGlbModel(glb->data(), glb->size(), glb);
+        glb.reset();
+        BOOST_REQUIRE(model.valid());
+        BOOST_CHECK(!weak.expired());
+        BOOST_CHECK_EQUAL(((const float *)model.attrBuffer(0))[6], 1.0f);
+    }
+    BOOST_CHECK(weak.expired());
+}
+
+BOOST_AUTO_TEST_CASE(test_reading_invalid_glb)
+{
+    const std::string glb = makeQuadGlb("5123");
+
+    clearError();
+    BOOST_CHECK(!readGlbModel(glb.data(), 16).valid());
+    BOOST_CHECK(isError());
+
+    clearError();
+    std::string truncated(glb, 0, glb.size() - 8);
+    BOOST_CHECK(!readGlbModel(truncated.data(), truncated.size()).valid());
+    BOOST_CHECK(isError());
+
+    // Length in header shorter than the headers themselves, JSON chunk claiming more than there is
+    clearError();
+    std::string shortLength(glb, 0, 20);
+    shortLength[8] = shortLength[9] = shortLength[10] = shortLength[11] = 0;
+    shortLength[12] = 100;
+    shortLength[13] = shortLength[14] = shortLength[15] = 0;
+    BOOST_CHECK(!readGlbModel(shortLength.data(), shortLength.size()).valid());
+    BOOST_CHECK(isError());
+
+    clearError();
+    const std::string floatIndices = makeQuadGlb("5126");
+    BOOST_CHECK(!readGlbModel(floatIndices.data(), floatIndices.size()).valid());
+    BOOST_CHECK(isError());
+
+    clearError();
+    const std::string noMesh = makeGlb("{\"asset\": {\"version\": \"2.0\"}}", "");
+    BOOST_CHECK(!readGlbModel(noMesh.data(), noMesh.size()).valid());
+    BOOST_CHECK(isError());
+    clearError();
+}
+
+static void checkEqualModels(const ModelData & a, const ModelData & b)
+{
+    BOOST_REQUIRE_EQUAL(a.valid(), b.valid());
+    BOOST_CHECK_EQUAL(a.attributeDataMode(), b.attributeDataMode());
+    BOOST_CHECK_EQUAL(a.sizeOfIndiceElement(), b.sizeOfIndiceElement());
+    BOOST_REQUIRE_EQUAL(a.indicesDataSize(), b.indicesDataSize());
+    BOOST_CHECK(memcmp(a.indicesData(), b.indicesData(), a.indicesDataSize()) == 0);
+    BOOST_CHECK_EQUAL(a.numberOfAttributes(), b.numberOfAttributes());
+    BOOST_REQUIRE_EQUAL(a.numberOfAttrBuffers(), b.numberOfAttrBuffers());
+    for (size_t i = 0; i < a.numberOfAttrBuffers(); ++i) {
+        BOOST_CHECK_EQUAL(a.attrBufferDataType(i), b.attrBufferDataType(i));
+        BOOST_CHECK_EQUAL(a.attrBufferSizeOfElement(i), b.attrBufferSizeOfElement(i));
+        BOOST_REQUIRE_EQUAL(a.numberOfAttrInBuffer(i), b.numberOfAttrInBuffer(i));
+        for (size_t v = 0; v < a.numberOfAttrInBuffer(i); ++v) {
+            BOOST_CHECK_EQUAL(a.valuesPerAttribute(i, v), b.valuesPerAttribute(i, v));
+        }
+        BOOST_REQUIRE_EQUAL(a.attrBufferSize(i), b.attrBufferSize(i));
+        BOOST_CHECK(memcmp(a.attrBuffer(i), b.attrBuffer(i), a.attrBufferSize(i)) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_writing_and_reading_model)
+{
+    const float attrData1[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f };
+    const U32 attrData2[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    const U16 indicesData[] = { 0, 1, 2 }; // Needs padding
+
+    const ModelData model(
+        {
+            ModelData::AttributeElement(new ModelData::AttributeData(
+                (const char *)attrData1, sizeof(attrData1), { 3 }, 3 * sizeof(float), ModelData::FLOAT)),
+            ModelData::AttributeElement(new ModelData::AttributeData(
+                (const char *)attrData2, sizeof(attrData2), { 3, 2 }, 5 * sizeof(U32), ModelData::UINT32))
+        },
+        (const char *)indicesData,
+        sizeof(indicesData),
+        sizeof(indicesData[0]),
+        ModelData::TRIANGE_STRIP
+        );
+
+    const size_t size = writtenModelSize(model);
+    BOOST_REQUIRE(size > 0);
+    BOOST_CHECK_EQUAL(size % 4, (size_t)0);
+
+    std::vector<char> output(size);
+    BOOST_CHECK(!writeModel(model, &output[0], size - 1));
+    clearError();
+    BOOST_REQUIRE(writeModel(model, &output[0], size));
+    checkEqualModels(model, readModel(&output[0], output.size()));
+
+    // File written through stream and through path must be equal to memory
+    const char * path = "stb_model_test.sm";
+    FILE * stream = fopen(path, "wb");
+    BOOST_REQUIRE(stream != 0);
+    BOOST_CHECK(writeModel(model, stream));
+    fclose(stream);
+    std::string fromStream(size, ' ');
+    stream = fopen(path, "rb");
+    BOOST_REQUIRE(stream != 0);
+    BOOST_CHECK_EQUAL(fread(&fromStream[0], 1, size + 1, stream), size);
+    fclose(stream);
+    BOOST_CHECK(memcmp(fromStream.data(), &output[0], size) == 0);
+
+    BOOST_REQUIRE(writeModel(model, path));
+    std::string fromPath(size, ' ');
+    stream = fopen(path, "rb");
+    BOOST_REQUIRE(stream != 0);
+    BOOST_CHECK_EQUAL(fread(&fromPath[0], 1, size + 1, stream), size);
+    fclose(stream);
+    BOOST_CHECK(memcmp(fromPath.data(), &output[0], size) == 0);
+    remove(path);
+
+    // Truncated data is rejected
+    clearError();
+    BOOST_CHECK(!readModel(&output[0], size - 4).valid());
+    BOOST_CHECK(isError());
+    clearError();
+}
+
+BOOST_AUTO_TEST_CASE(test_writing_and_reading_glb_model)
+{
+    const std::string glb = makeQuadGlb("5123");
+    const ModelData model = readGlbModel(glb.data(), glb.size());
+    BOOST_REQUIRE(model.valid());
+    for (size_t i = 0; i < model.numberOfAttrBuffers(); ++i) {
+        BOOST_CHECK_EQUAL(model.attrBufferSize(i) / model.attrBufferSizeOfElement(i), (size_t)4);
+    }
+
+    std::vector<char> output(writtenModelSize(model));
+    BOOST_REQUIRE(!output.empty());
+    BOOST_REQUIRE(writeModel(model, &output[0], output.size()));
+    checkEqualModels(model, readModel(&output[0], output.size()));
+}
+
+BOOST_AUTO_TEST_CASE(test_writing_invalid_model)
+{
+    const ModelData model;
+    clearError();
+    BOOST_CHECK_EQUAL(writtenModelSize(model), (size_t)0);
+    BOOST_CHECK(!writeModel(model, "stb_model_invalid_test.sm"));
+    BOOST_CHECK(isError());
+    clearError();
+}
+
+BOOST_AUTO_TEST_CASE(test_reading_model_with_corrupt_header)
+{
+    const float attrData[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f };
+    const U32 indicesData[] = { 0, 1, 2 };
+    const ModelData model(
+        {
+            ModelData::AttributeElement(new ModelData::AttributeData(
+                (const char *)attrData, sizeof(attrData), { 3 }, 3 * sizeof(float), ModelData::FLOAT))
+        },
+        (const char *)indicesData,
+        sizeof(indicesData),
+        sizeof(indicesData[0]),
+        ModelData::TRIANGLE
+        );
+    std::vector<char> output(writtenModelSize(model));
+    BOOST_REQUIRE(writeModel(model, &output[0], output.size()));
+    BOOST_REQUIRE(readModel(&output[0], output.size()).valid());
+
+    // Size of element follows the 8 byte header, type, number of attributes and its one value count
+    const size_t sizeOfElementAt = 8 + 2 + 1;
+    const U32 invalidSizes[] = {
+        0, // Would divide by zero
+        2 * sizeof(float), // Three floats do not fit
+        4 * sizeof(float) // Buffer is not whole elements
+    };
+    for (const U32 sizeOfElement : invalidSizes) {
+        std::vector<char> corrupt(output);
+        memcpy(&corrupt[sizeOfElementAt], &sizeOfElement, sizeof(sizeOfElement));
+        clearError();
+        BOOST_CHECK(!readModel(&corrupt[0], corrupt.size()).valid());
+        BOOST_CHECK(isError());
+    }
+    clearError();
+}
+
+BOOST_AUTO_TEST_CASE(test_reading_version_1_model)
+{
+    const float attrData[] = { 1.0f, 2.0f, 3.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+    const U16 indicesData[] = { 0, 0, 0 };
+    const U32 numberOfIndices = 3;
+    const U32 numberOfAttributes = 1;
+
+    std::string data(1, (char)1);
+    data += "vn  ";
+    data += (char)sizeof(U16);
+    data.append((const char *)&numberOfIndices, 4);
+    data.append((const char *)indicesData, sizeof(indicesData));
+    data.append((const char *)&numberOfAttributes, 4);
+    data.append((const char *)attrData, sizeof(attrData));
+
+    const ModelData model = readModel(data.data(), data.size());
+    BOOST_REQUIRE(model.valid());
+    BOOST_CHECK_EQUAL(model.numberOfAttributes(), (size_t)2);
+    BOOST_CHECK_EQUAL(model.attrBufferSizeOfElement(0), sizeof(attrData));
+    BOOST_CHECK_EQUAL(model.indicesDataSize(), sizeof(indicesData));
+    BOOST_CHECK_EQUAL(((const float *)model.attrBuffer(0))[6], 1.0f);
+}
+
 /*
 * This will cause a compile time error, uncomment to test
 */
@@ -0,0 +1,124 @@
+#define BOOST_TEST_MODULE unit_test_normals
+#include <boost/test/unit_test.hpp>
+
+#include "stb_normals.hh"
+#include "stb_generator.hh"
+#include "stb_model.hh"
+#include "stb_error.hh"
+#include "stb_types.hh"
+
+#include <cmath>
+
+using namespace stb;
+
+static const size_t VALUES_PER_ELEMENT = 12;
+
+static size_t numberOfElements(const ModelData & model)
+{
+    return model.attrBufferSize(0) / model.attrBufferSizeOfElement(0);
+}
+
+static const float * element(const ModelData & model, const size_t i)
+{
+    return (const float *)model.attrBuffer(0) + i * VALUES_PER_ELEMENT;
+}
+
+static void checkTangentSpace(const ModelData & model)
+{
+    BOOST_REQUIRE(model.valid());
+    BOOST_REQUIRE_EQUAL(model.numberOfAttrInBuffer(0), (size_t)4);
+    BOOST_REQUIRE_EQUAL(model.valuesPerAttribute(0, 3), (size_t)4);
+    BOOST_REQUIRE_EQUAL(model.attrBufferSizeOfElement(0), VALUES_PER_ELEMENT * sizeof(float));
+
+    for (size_t i = 0; i < numberOfElements(model); ++i) {
+        const float * e = element(model, i);
+        const float * n = e + 3;
+        const float * t = e + 8;
+        BOOST_REQUIRE_CLOSE(n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1.0f, 0.001f);
+        BOOST_REQUIRE_CLOSE(t[0] * t[0] + t[1] * t[1] + t[2] * t[2], 1.0f, 0.001f);
+        BOOST_REQUIRE_SMALL(n[0] * t[0] + n[1] * t[1] + n[2] * t[2], 0.0001f);
+        BOOST_REQUIRE(std::abs(t[3]) == 1.0f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_quad_with_mirrored_uv)
+{
+    // Two triangles in xy plane, u runs along -x, so bitangent is mirrored
+    const float attributes[] = {
+        0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+        1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+        0.0f, 1.0f, 0.0f, 1.0f, 1.0f
+    };
+    const U16 indices[] = { 0, 1, 2, 0, 2, 3 };
+    const ModelData::AttributeElement attr(new ModelData::AttributeData(
+        (const char *)attributes, sizeof(attributes), { 3, 2 }, sizeof(float) * 5, ModelData::FLOAT));
+    const ModelData quad({ attr }, (const char *)indices, sizeof(indices), sizeof(U16), ModelData::TRIANGLE);
+
+    const ModelData result = generateNormalsAndTangents(quad, 1);
+    checkTangentSpace(result);
+    BOOST_CHECK(result.indicesData() == quad.indicesData());
+    BOOST_CHECK_EQUAL(result.sizeOfIndiceElement(), sizeof(U16));
+
+    for (size_t i = 0; i < 4; ++i) {
+        const float * e = element(result, i);
+        BOOST_CHECK_EQUAL(e[0], attributes[i * 5]);
+        BOOST_CHECK_EQUAL(e[6], attributes[i * 5 + 3]);
+        BOOST_CHECK_CLOSE(e[5], 1.0f, 0.001f);
+        BOOST_CHECK_CLOSE(e[8], -1.0f, 0.001f);
+        BOOST_CHECK_EQUAL(e[11], -1.0f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_generated_shapes)
+{
+    // Flat faces of cube keep their normals
+    const ModelData cube = generateCube(3);
+    const ModelData cubeResult = generateNormalsAndTangents(cube, 1);
+    checkTangentSpace(cubeResult);
+    const float * cubeElement = (const float *)cube.attrBuffer(0);
+    for (size_t i = 0; i < numberOfElements(cube); ++i, cubeElement += 8) {
+        for (size_t c = 3; c < 8; ++c) {
+            BOOST_REQUIRE_CLOSE(element(cubeResult, i)[c] + 2.0f, cubeElement[c] + 2.0f, 0.001f);
+        }
+    }
+
+    // Smooth normals of sphere point away from its center
+    const ModelData sphere = generateSphere(4, 2.0f);
+    const ModelData sphereResult = generateNormalsAndTangents(sphere, 4);
+    checkTangentSpace(sphereResult);
+    for (size_t i = 0; i < numberOfElements(sphereResult); ++i) {
+        const float * e = element(sphereResult, i);
+        BOOST_REQUIRE_CLOSE(e[3] * e[0] + e[4] * e[1] + e[5] * e[2], 2.0f, 0.1f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_number_of_threads)
+{
+    const ModelData sphere = generateSphere(6);
+    const ModelData one = generateNormalsAndTangents(sphere, 1);
+    const ModelData many = generateNormalsAndTangents(sphere, 8);
+    BOOST_REQUIRE_EQUAL(one.attrBufferSize(0), many.attrBufferSize(0));
+    for (size_t i = 0; i < numberOfElements(one); ++i) {
+        for (size_t c = 0; c < VALUES_PER_ELEMENT; ++c) {
+            BOOST_REQUIRE_SMALL(element(one, i)[c] - element(many, i)[c], 0.0001f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_models)
+{
+    clearError();
+    BOOST_CHECK(!generateNormalsAndTangents(ModelData()).valid());
+    BOOST_CHECK(isError());
+    clearError();
+
+    const float attributes[] = { 0.0f, 0.0f, 0.0f };
+    const U16 indices[] = { 0, 0, 1 };
+    const ModelData::AttributeElement attr(new ModelData::AttributeData(
+        (const char *)attributes, sizeof(attributes), { 3 }, sizeof(attributes), ModelData::FLOAT));
+    const ModelData outOfRange({ attr }, (const char *)indices, sizeof(indices), sizeof(U16), ModelData::TRIANGLE);
+    BOOST_CHECK(!generateNormalsAndTangents(outOfRange).valid());
+    BOOST_CHECK(isError());
+    clearError();
+}
@@ -0,0 +1,207 @@
+#define BOOST_TEST_MODULE unit_test_obj
+#include <boost/test/unit_test.hpp>
+
+#include "stb_obj.hh"
+#include "stb_model.hh"
+#include "stb_error.hh"
+#include "stb_types.hh"
+
+#include <string>
+#include <cstring>
+
+using namespace stb;
+
+static const char * quadObj =
+"# Two triangles sharing an edge\n"
+"v -1.0 -1.0 0.0\n"
+"v 1.0 -1.0 0.0\n"
+"v 1.0 1.0 0.0\n"
+"v -1.0 1.0 0.0 0.5\n"
+"vt 0.0 0.0\n"
+"vn 0.0 0.0 1.0\n"
+"f 1//1 2//1 3//1\r\n"
+"f 1/1/1 3/1/1 -1/1/-1\n";
+
+BOOST_AUTO_TEST_CASE(test_parse_float)
+{
+    const char * values[] = { "1", "-2.5", "+0.125", ".5", "3.", "1e3", "-1.5E-2", "0.000001" };
+    const float expected[] = { 1.0f, -2.5f, 0.125f, 0.5f, 3.0f, 1000.0f, -0.015f, 0.000001f };
+
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+        float value = 0.0f;
+        const char * end = values[i] + strlen(values[i]);
+        BOOST_CHECK(stb::parseFloat(values[i], end, value) == end);
+        BOOST_CHECK_EQUAL(value, expected[i]);
+    }
+
+    float value = 0.0f;
+    const char * notNumber = "abc";
+    BOOST_CHECK(stb::parseFloat(notNumber, notNumber + 3, value) == 0);
+
+    const char * exponentWithoutDigits = "2e";
+    BOOST_CHECK(stb::parseFloat(exponentWithoutDigits, exponentWithoutDigits + 2, value) == exponentWithoutDigits + 1);
+    BOOST_CHECK_EQUAL(value, 2.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_obj_welds_equal_vertices)
+{
+    const ModelData model = stb::convertObj(quadObj, strlen(quadObj), 2);
+    BOOST_CHECK_EQUAL(stb::isError(), false);
+    BOOST_CHECK_EQUAL(model.valid(), true);
+
+    BOOST_CHECK_EQUAL(model.numberOfAttrBuffers(), (size_t)1);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 0), (size_t)4);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 1), (size_t)3);
+    BOOST_CHECK_EQUAL(model.attrBufferSizeOfElement(0), 7 * sizeof(float));
+    BOOST_CHECK_EQUAL(model.attrBufferSize(0), 4 * 7 * sizeof(float));
+
+    BOOST_CHECK_EQUAL(model.sizeOfIndiceElement(), sizeof(U16));
+    BOOST_CHECK_EQUAL(model.indicesDataSize(), 6 * sizeof(U16));
+    const U16 * indices = (const U16 *)model.indicesData();
+    const U16 expectedIndices[] = { 0, 1, 2, 0, 2, 3 };
+    for (size_t i = 0; i < 6; ++i) {
+        BOOST_CHECK_EQUAL(indices[i], expectedIndices[i]);
+    }
+
+    const float * attributes = (const float *)model.attrBuffer(0);
+    BOOST_CHECK_EQUAL(attributes[3], 1.0f); // Default w
+    BOOST_CHECK_EQUAL(attributes[3 * 7 + 3], 0.5f);
+    BOOST_CHECK_EQUAL(attributes[3 * 7 + 6], 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_obj_triangulates_polygons)
+{
+    const char * obj =
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 1 0\n"
+        "vn 0 0 1\n"
+        "f 1//1 2//1 3//1 4//1 5//1\n";
+
+    const ModelData model = stb::convertObj(obj, strlen(obj), 1);
+    BOOST_CHECK_EQUAL(stb::isError(), false);
+    BOOST_CHECK_EQUAL(model.indicesDataSize() / model.sizeOfIndiceElement(), (size_t)9);
+    BOOST_CHECK_EQUAL(model.attrBufferSize(0) / model.attrBufferSizeOfElement(0), (size_t)5);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_obj_result_does_not_depend_on_threads)
+{
+    std::string obj;
+    for (size_t i = 0; i < 100000; ++i) {
+        obj += "v 0.5 " + std::to_string(i % 1000) + ".25 -1\n";
+    }
+    obj += "vn 0 1 0\n";
+    for (size_t i = 1; i + 2 <= 100000; i += 3) {
+        obj += "f " + std::to_string(i) + "//1 " + std::to_string(i + 1) + "//1 " + std::to_string(i + 2) + "//1\n";
+    }
+
+    const ModelData single = stb::convertObj(obj.c_str(), obj.size(), 1);
+    const ModelData multiple = stb::convertObj(obj.c_str(), obj.size(), 8);
+    BOOST_CHECK_EQUAL(stb::isError(), false);
+    BOOST_CHECK_EQUAL(single.attrBufferSize(0), (size_t)1000 * 7 * sizeof(float));
+    BOOST_CHECK_EQUAL(single.attrBufferSize(0), multiple.attrBufferSize(0));
+    BOOST_CHECK_EQUAL(single.indicesDataSize(), multiple.indicesDataSize());
+    BOOST_CHECK(memcmp(single.indicesData(), multiple.indicesData(), single.indicesDataSize()) == 0);
+    BOOST_CHECK(memcmp(single.attrBuffer(0), multiple.attrBuffer(0), single.attrBufferSize(0)) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_obj_invalid_input)
+{
+    const char * missingNormal = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nf 1 2 3\n";
+    const ModelData model = stb::convertObj(missingNormal, strlen(missingNormal), 1);
+    BOOST_CHECK_EQUAL(stb::isError(), true);
+    BOOST_CHECK_EQUAL(model.valid(), false);
+    stb::clearError();
+
+    const char * undefinedVertex = "v 0 0 0\nvn 0 0 1\nf 1//1 2//1 3//1\n";
+    stb::convertObj(undefinedVertex, strlen(undefinedVertex), 1);
+    BOOST_CHECK_EQUAL(stb::isError(), true);
+    stb::clearError();
+}
+
+static FILE * streamOf(const std::string & content)
+{
+    FILE * stream = tmpfile();
+    fwrite(content.c_str(), 1, content.size(), stream);
+    rewind(stream);
+    return stream;
+}
+
+BOOST_AUTO_TEST_CASE(test_read_obj_model_with_uv_and_normals)
+{
+    FILE * stream = streamOf(
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+        "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+        "f 1/1/1 3/3/1 4/4/1\n");
+    const ModelData model = stb::readObjModel(stream);
+    fclose(stream);
+
+    BOOST_CHECK_EQUAL(stb::isError(), false);
+    BOOST_CHECK_EQUAL(model.numberOfAttrInBuffer(0), (size_t)3);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 0), (size_t)3);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 1), (size_t)3);
+    BOOST_CHECK_EQUAL(model.valuesPerAttribute(0, 2), (size_t)2);
+    BOOST_CHECK_EQUAL(model.attrBufferSize(0) / model.attrBufferSizeOfElement(0), (size_t)4);
+    BOOST_CHECK_EQUAL(model.indicesDataSize() / model.sizeOfIndiceElement(), (size_t)9);
+
+    const float * attributes = (const float *)model.attrBuffer(0);
+    BOOST_CHECK_EQUAL(attributes[2 * 8 + 0], 1.0f);
+    BOOST_CHECK_EQUAL(attributes[2 * 8 + 5], 1.0f);
+    BOOST_CHECK_EQUAL(attributes[2 * 8 + 6], 1.0f);
+    BOOST_CHECK_EQUAL(attributes[2 * 8 + 7], 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_read_obj_model_calculates_missing_normals)
+{
+    FILE * stream = streamOf("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+    const ModelData model = stb::readObjModel(stream);
+    fclose(stream);
+
+    BOOST_CHECK_EQUAL(stb::isError(), false);
+    const float * attributes = (const float *)model.attrBuffer(0);
+    for (size_t i = 0; i < 3; ++i) {
+        BOOST_CHECK_EQUAL(attributes[i * 8 + 3], 0.0f);
+        BOOST_CHECK_EQUAL(attributes[i * 8 + 4], 0.0f);
+        BOOST_CHECK_EQUAL(attributes[i * 8 + 5], 1.0f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_read_obj_model_across_read_blocks)
+{
+    std::string obj;
+    const size_t numberOfVertices = 150000;
+    for (size_t i = 0; i < numberOfVertices; ++i) {
+        obj += "v " + std::to_string(i) + " 0.125 -0.5\n";
+    }
+    for (size_t i = 1; i + 2 <= numberOfVertices; i += 3) {
+        obj += "f " + std::to_string(i) + " " + std::to_string(i + 1) + " -1\n";
+    }
+
+    FILE * stream = streamOf(obj);
+    const ModelData model = stb::readObjModel(stream);
+    fclose(stream);
+
+    BOOST_CHECK_EQUAL(stb::isError(), false);
+    BOOST_CHECK_EQUAL(model.sizeOfIndiceElement(), sizeof(U32));
+    // Last vertex is shared by all faces
+    BOOST_CHECK_EQUAL(model.attrBufferSize(0) / model.attrBufferSizeOfElement(0), (size_t)100001);
+    BOOST_CHECK_EQUAL(model.indicesDataSize() / model.sizeOfIndiceElement(), numberOfVertices);
+
+    const float * attributes = (const float *)model.attrBuffer(0);
+    BOOST_CHECK_EQUAL(attributes[0], 0.0f);
+    BOOST_CHECK_EQUAL(attributes[8], 1.0f);
+    BOOST_CHECK_EQUAL(attributes[16], (float)(numberOfVertices - 1));
+    BOOST_CHECK_EQUAL(attributes[1], 0.125f);
+    BOOST_CHECK_EQUAL(attributes[2], -0.5f);
+}
+
+BOOST_AUTO_TEST_CASE(test_read_obj_model_invalid_input)
+{
+    FILE * stream = streamOf("v 0 0 0\nv 1 0 0\nf 1 2 3\n");
+    const ModelData model = stb::readObjModel(stream);
+    fclose(stream);
+
+    BOOST_CHECK_EQUAL(stb::isError(), true);
+    BOOST_CHECK_EQUAL(model.valid(), false);
+    stb::clearError();
+}
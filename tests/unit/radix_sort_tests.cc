@@ -0,0 +1,82 @@
+#define BOOST_TEST_MODULE unit_test_radix_sort
+#include <boost/test/unit_test.hpp>
+
+#include "stb_radix_sort.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using namespace stb;
+
+static void checkAgainstStableSort(const std::vector<U64> & input)
+{
+    std::vector<std::pair<U64, U32> > expected;
+    for (size_t i = 0; i < input.size(); ++i) {
+        expected.push_back(std::make_pair(input[i], static_cast<U32>(i)));
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+        [](const std::pair<U64, U32> & a, const std::pair<U64, U32> & b) { return a.first < b.first; });
+
+    std::vector<U64> keys(input);
+    std::vector<U32> values;
+    for (size_t i = 0; i < input.size(); ++i) {
+        values.push_back(static_cast<U32>(i));
+    }
+    std::vector<U64> scratchKeys;
+    std::vector<U32> scratchValues;
+    radixSort(keys, values, scratchKeys, scratchValues);
+
+    BOOST_REQUIRE_EQUAL(keys.size(), expected.size());
+    BOOST_REQUIRE_EQUAL(values.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(keys[i], expected[i].first);
+        BOOST_REQUIRE_EQUAL(values[i], expected[i].second);
+    }
+}
+
+static U64 randomKey()
+{
+    U64 key = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        key = (key << 16) | static_cast<U64>(rand() & 0xffff);
+    }
+    return key;
+}
+
+BOOST_AUTO_TEST_CASE(test_random_keys)
+{
+    srand(1);
+    std::vector<U64> keys;
+    for (size_t i = 0; i < 10000; ++i) {
+        keys.push_back(randomKey());
+    }
+    checkAgainstStableSort(keys);
+}
+
+BOOST_AUTO_TEST_CASE(test_equal_keys_keep_order)
+{
+    srand(2);
+    // Few distinct keys differing only in high and low bytes, most passes are skipped
+    std::vector<U64> keys;
+    for (size_t i = 0; i < 1000; ++i) {
+        keys.push_back((static_cast<U64>(rand() % 3) << 60) | static_cast<U64>(rand() % 2));
+    }
+    checkAgainstStableSort(keys);
+
+    checkAgainstStableSort(std::vector<U64>(100, 42));
+}
+
+BOOST_AUTO_TEST_CASE(test_small_inputs)
+{
+    checkAgainstStableSort(std::vector<U64>());
+    checkAgainstStableSort(std::vector<U64>(1, 7));
+
+    std::vector<U64> keys;
+    keys.push_back(~static_cast<U64>(0));
+    keys.push_back(0);
+    keys.push_back(static_cast<U64>(1) << 63);
+    keys.push_back(1);
+    checkAgainstStableSort(keys);
+}
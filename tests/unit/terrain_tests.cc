@@ -0,0 +1,174 @@
+#define BOOST_TEST_MODULE unit_test_terrain
+#include <boost/test/unit_test.hpp>
+
+#include "stb_terrain.hh"
+#include "stb_error.hh"
+#include "stb_types.hh"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace stb;
+
+static const size_t VALUES_PER_ELEMENT = 8;
+
+static TerrainSettings makeSettings(const U resolution, const U levelsOfDetail)
+{
+    const TerrainSettings settings = { resolution, 16.0f, levelsOfDetail, 1.0f };
+    return settings;
+}
+
+static float noiseHeight(const float x, const float z)
+{
+    return 4.0f * fractalNoise(x * 0.05f, z * 0.05f, 4, 7);
+}
+
+static const float * element(const ModelData & model, const size_t i)
+{
+    return (const float *)model.attrBuffer(0) + i * VALUES_PER_ELEMENT;
+}
+
+BOOST_AUTO_TEST_CASE(test_chunk_levels_of_detail)
+{
+    const TerrainSettings settings = makeSettings(16, 3);
+    const TerrainChunkCoordinate coordinate = { -2, 3 };
+    std::vector<TerrainLod> lods;
+    const ModelData chunk = generateTerrainChunk(settings, noiseHeight, coordinate, lods);
+
+    BOOST_REQUIRE(chunk.valid());
+    BOOST_REQUIRE_EQUAL(chunk.attrBufferSizeOfElement(0), VALUES_PER_ELEMENT * sizeof(float));
+    BOOST_REQUIRE_EQUAL(chunk.sizeOfIndiceElement(), sizeof(U32));
+    const size_t numberOfElements = chunk.attrBufferSize(0) / chunk.attrBufferSizeOfElement(0);
+    BOOST_CHECK_EQUAL(numberOfElements, (size_t)(17 * 17 + 4 * 17));
+
+    // Every level shares vertices and follows the previous one in index buffer
+    BOOST_REQUIRE_EQUAL(lods.size(), (size_t)3);
+    const U32 * indices = (const U32 *)chunk.indicesData();
+    size_t expectedFirst = 0;
+    for (size_t level = 0; level < lods.size(); ++level) {
+        const size_t quads = 16 >> level;
+        BOOST_CHECK_EQUAL(lods[level].firstIndex, expectedFirst);
+        BOOST_CHECK_EQUAL(lods[level].numberOfIndices, 6 * quads * quads + 4 * 6 * quads);
+        expectedFirst += lods[level].numberOfIndices;
+    }
+    BOOST_REQUIRE_EQUAL(expectedFirst * sizeof(U32), chunk.indicesDataSize());
+    for (size_t i = 0; i < expectedFirst; ++i) {
+        BOOST_REQUIRE(indices[i] < numberOfElements);
+    }
+
+    // Vertices cover the chunk, skirts hang below the edges
+    BOOST_CHECK_EQUAL(element(chunk, 0)[0], -32.0f);
+    BOOST_CHECK_EQUAL(element(chunk, 0)[2], 48.0f);
+    BOOST_CHECK_EQUAL(element(chunk, 17 * 17 - 1)[0], -16.0f);
+    BOOST_CHECK_EQUAL(element(chunk, 17 * 17 - 1)[2], 64.0f);
+    BOOST_CHECK_EQUAL(element(chunk, 17 * 17)[1], element(chunk, 0)[1] - 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_chunk_normals)
+{
+    // Plane rising along x, normal is the same everywhere
+    const TerrainSettings settings = makeSettings(8, 1);
+    const TerrainChunkCoordinate coordinate = { 0, 0 };
+    std::vector<TerrainLod> lods;
+    const ModelData chunk = generateTerrainChunk(settings, [](const float x, const float) { return 0.5f * x; },
+        coordinate, lods);
+    BOOST_REQUIRE(chunk.valid());
+
+    const float length = std::sqrt(0.5f * 0.5f + 1.0f);
+    for (size_t i = 0; i < 9 * 9; ++i) {
+        BOOST_REQUIRE_CLOSE(element(chunk, i)[3], -0.5f / length, 0.001f);
+        BOOST_REQUIRE_CLOSE(element(chunk, i)[4], 1.0f / length, 0.001f);
+        BOOST_REQUIRE_SMALL(element(chunk, i)[5], 0.00001f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_neighbouring_chunks_are_seamless)
+{
+    const TerrainSettings settings = makeSettings(32, 2);
+    const TerrainChunkCoordinate left = { 4, -1 };
+    const TerrainChunkCoordinate right = { 5, -1 };
+    std::vector<TerrainLod> lods;
+    const ModelData leftChunk = generateTerrainChunk(settings, noiseHeight, left, lods);
+    const ModelData rightChunk = generateTerrainChunk(settings, noiseHeight, right, lods);
+
+    for (size_t row = 0; row <= 32; ++row) {
+        const float * a = element(leftChunk, row * 33 + 32);
+        const float * b = element(rightChunk, row * 33);
+        BOOST_REQUIRE(memcmp(a, b, 6 * sizeof(float)) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_settings)
+{
+    const TerrainSettings settings = makeSettings(12, 4);
+    const TerrainChunkCoordinate coordinate = { 0, 0 };
+    std::vector<TerrainLod> lods;
+    clearError();
+    BOOST_CHECK(!generateTerrainChunk(settings, noiseHeight, coordinate, lods).valid());
+    BOOST_CHECK(isError());
+    clearError();
+}
+
+BOOST_AUTO_TEST_CASE(test_height_sources)
+{
+    const float heights[] = {
+        0.0f, 1.0f,
+        2.0f, 3.0f
+    };
+    BOOST_CHECK_CLOSE(sampleHeightmap(heights, 2, 2, 2.0f, 1.0f, 1.0f), 1.5f, 0.001f);
+    BOOST_CHECK_CLOSE(sampleHeightmap(heights, 2, 2, 2.0f, 2.0f, 0.0f), 1.0f, 0.001f);
+    BOOST_CHECK_CLOSE(sampleHeightmap(heights, 2, 2, 2.0f, 10.0f, 10.0f), 3.0f, 0.001f);
+    BOOST_CHECK_EQUAL(sampleHeightmap(heights, 2, 2, 2.0f, -5.0f, -5.0f), 0.0f);
+
+    for (float x = -10.0f; x < 10.0f; x += 0.37f) {
+        const float value = fractalNoise(x, 0.5f * x, 5, 1);
+        BOOST_REQUIRE(std::abs(value) <= 1.0f);
+        BOOST_REQUIRE_EQUAL(value, fractalNoise(x, 0.5f * x, 5, 1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_lod_selection)
+{
+    const TerrainSettings settings = makeSettings(16, 3);
+    const TerrainChunkCoordinate near = { 0, 0 };
+    const TerrainChunkCoordinate next = { 1, -1 };
+    const TerrainChunkCoordinate far = { 0, 9 };
+    BOOST_CHECK_EQUAL(selectTerrainLod(settings, near, 8.0f, 8.0f), (U)0);
+    BOOST_CHECK_EQUAL(selectTerrainLod(settings, next, 8.0f, 8.0f), (U)1);
+    BOOST_CHECK_EQUAL(selectTerrainLod(settings, far, 8.0f, 8.0f), (U)2);
+}
+
+static size_t waitChunks(TerrainStreamer & streamer, std::vector<TerrainChunk> & chunks, const size_t expected)
+{
+    for (U i = 0; (i < 500) && (chunks.size() < expected); ++i) {
+        if (!streamer.takeReady(chunks)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    return chunks.size();
+}
+
+BOOST_AUTO_TEST_CASE(test_streaming_around_camera)
+{
+    TerrainStreamer streamer(makeSettings(8, 2), noiseHeight, 1);
+    std::vector<TerrainChunkCoordinate> evicted;
+    std::vector<TerrainChunk> chunks;
+
+    streamer.update(8.0f, 8.0f, evicted);
+    BOOST_REQUIRE_EQUAL(waitChunks(streamer, chunks, 9), (size_t)9);
+    BOOST_CHECK(evicted.empty());
+    BOOST_CHECK(chunks[0].coordinate == terrainChunkAt(makeSettings(8, 2), 8.0f, 8.0f));
+    BOOST_CHECK_EQUAL(chunks[0].lods.size(), (size_t)2);
+
+    // Moving one chunk keeps everything within slack, nothing is generated twice
+    streamer.update(24.0f, 8.0f, evicted);
+    chunks.clear();
+    BOOST_CHECK_EQUAL(waitChunks(streamer, chunks, 3), (size_t)3);
+    BOOST_CHECK(evicted.empty());
+
+    streamer.update(1000.0f, 8.0f, evicted);
+    BOOST_CHECK_EQUAL(evicted.size(), (size_t)12);
+}
@@ -0,0 +1,77 @@
+#define BOOST_TEST_MODULE unit_test_watch
+#include <boost/test/unit_test.hpp>
+
+#include "stb_watch.hh"
+#include "stb_buffer.hh"
+#include "stb_types.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace stb;
+
+/*
+ * Loads file as a model that has one float attribute holding size of the file
+ */
+static ModelData loadSizeOfFile(const std::string & path)
+{
+    buffer::InputFile file(path.c_str());
+    if (!file.ready()) {
+        return ModelData();
+    }
+    const float size = static_cast<float>(file.size());
+    const U16 indices[] = { 0, 0, 0 };
+    const ModelData::AttributeElement attr(new ModelData::AttributeData(
+        (const char *)&size, sizeof(size), { 1 }, sizeof(size), ModelData::FLOAT));
+    return ModelData({ attr }, (const char *)indices, sizeof(indices), sizeof(U16), ModelData::TRIANGLE);
+}
+
+static void writeFile(const char * path, const std::string & content)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+}
+
+static float waitReloaded(ModelWatcher & watcher)
+{
+    std::vector<ModelData> models;
+    for (U i = 0; i < 500; ++i) {
+        if (watcher.takeReloaded(models)) {
+            BOOST_REQUIRE_EQUAL(models.size(), (size_t)1);
+            return *(const float *)models[0].attrBuffer(0);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1.0f;
+}
+
+BOOST_AUTO_TEST_CASE(test_reloading_written_and_replaced_file)
+{
+    const char * path = "stb_watch_test.sm";
+    const char * temporaryPath = "stb_watch_test.sm.tmp";
+    writeFile(path, "1");
+
+    ModelWatcher watcher(path, loadSizeOfFile);
+    BOOST_REQUIRE(watcher.ready());
+
+    std::vector<ModelData> models;
+    BOOST_CHECK(!watcher.takeReloaded(models));
+
+    // Written in place
+    writeFile(path, "12");
+    BOOST_CHECK_EQUAL(waitReloaded(watcher), 2.0f);
+
+    // Other files in the same directory do not trigger reloading
+    writeFile(temporaryPath, "123");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    BOOST_CHECK(!watcher.takeReloaded(models));
+
+    // Replaced through rename, like many editors save
+    BOOST_REQUIRE_EQUAL(rename(temporaryPath, path), 0);
+    BOOST_CHECK_EQUAL(waitReloaded(watcher), 3.0f);
+
+    remove(path);
+}
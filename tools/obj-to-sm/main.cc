@@ -0,0 +1,94 @@
+#include "stb_obj.hh"
+#include "stb_model.hh"
+#include "stb_buffer.hh"
+#include "stb_error.hh"
+#include "stb_types.hh"
+
+#include <boost/program_options.hpp>
+
+#include <string>
+#include <iostream>
+#include <chrono>
+
+class Parameters
+{
+public:
+    Parameters(void) : numberOfThreads(0), verbose(false) {}
+
+    std::string inputFile;
+    std::string outputFile;
+    U numberOfThreads;
+    bool verbose;
+};
+
+bool parseParameters(int argc, char * argv[], Parameters & params)
+{
+    namespace po = boost::program_options;
+
+    po::options_description options("Converts .obj into SToolbox .sm format");
+
+    options.add_options()
+        ("help", "Show help, this print")
+        ("i", po::value<std::string>(&params.inputFile)->required(), "Input file")
+        ("o", po::value<std::string>(&params.outputFile)->required(), "Output file")
+        ("t", po::value<U>(&params.numberOfThreads), "Number of threads, 0 for all hardware threads")
+        ("v", po::bool_switch(&params.verbose), "Verbose output")
+        ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(options).run(), vm);
+        if (vm.count("help")) {
+            std::cout << options << "\n";
+            return false;
+        }
+        po::notify(vm);
+    } catch (std::exception & e) {
+        std::cout << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    typedef std::chrono::steady_clock Clock;
+    Parameters params;
+
+    if (!parseParameters(argc, argv, params)) {
+        return 1;
+    }
+
+    const Clock::time_point start = Clock::now();
+
+    stb::buffer::MappedFile input(params.inputFile.c_str());
+    if (!input.ready()) {
+        std::cerr << "Unable to open input file " << params.inputFile << "\n";
+        return 1;
+    }
+
+    const stb::ModelData model = stb::convertObj(input.data(), input.size(), params.numberOfThreads);
+    if (stb::isError()) {
+        std::cerr << "Conversion failed: " << stb::getErrorDescription() << "\n";
+        return 1;
+    }
+
+    const Clock::time_point converted = Clock::now();
+
+    if (!stb::writeModel(model, params.outputFile.c_str())) {
+        std::cerr << "Writing output file failed: " << stb::getErrorDescription() << "\n";
+        return 1;
+    }
+
+    if (params.verbose) {
+        const Clock::time_point end = Clock::now();
+        std::cout << "Size of indice: " << model.sizeOfIndiceElement() << "B"
+            << ", number of indices: " << model.indicesDataSize() / model.sizeOfIndiceElement()
+            << ", number of attribute elements: " << model.attrBufferSize(0) / model.attrBufferSizeOfElement(0)
+            << "\nConversion took " << std::chrono::duration_cast<std::chrono::milliseconds>(converted - start).count()
+            << "ms, writing " << std::chrono::duration_cast<std::chrono::milliseconds>(end - converted).count() << "ms\n";
+    }
+
+    return 0;
+}